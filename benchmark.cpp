@@ -0,0 +1,548 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Benchmarks for the gimbaledCamera library (Google Benchmark).
+ *
+ * Each stage of a frame is timed separately on synthetic fleets of 10 to 10M
+ * vessels: RelativeVessel construction (libm, Poly and Table precision), batch
+ * geodesy (computeRelativeBatch and the ObserverFrame tangent plane), sorting
+ * by bearing, makePictures (also of 24-byte CompactVessels, and into a kept
+ * plan with a FrameArena),
+ * makeMinimalPictures, the budgeted BudgetedPlanner, the two-axis
+ * makePanTiltPictures, the multi-zoom makeZoomPictures and output
+ * formatting (the report and the quiet CSV output).  BM_PlanBatch plans 16 observers over a
+ * shared fleet on 1 to 16 threads, BM_ParallelPlanner converts and plans one
+ * large fleet on 1 to 16 threads, BM_PlanIndexed plans one observer over a
+ * world-wide feed with and without a SpatialIndex, BM_ContactIngest feeds
+ * updates from 1 to 8 sensor threads through a ContactQueue, and
+ * BM_PlanWithMotion replans a moving fleet from a moving drone.  Run with
+ *
+ *   make bench
+ *
+ * to write the results to bench_output.json, or run ./benchmark with the
+ * usual Google Benchmark flags (e.g. --benchmark_filter=Uniform).
+ */
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "gimbaledCamera.h"
+#include "budgetedPlanner.h"
+#include "compactVessel.h"
+#include "contactQueue.h"
+#include "frameArena.h"
+#include "geodesy.h"
+#include "motionPlanner.h"
+#include "observerFrame.h"
+#include "panTiltPlanner.h"
+#include "parallelPlanner.h"
+#include "planBatch.h"
+#include "scheduleWriter.h"
+#include "slewScheduler.h"
+#include "spatialIndex.h"
+#include "zoomPlanner.h"
+
+namespace {
+
+  const double droneLat = 37.760132, droneLon = -122.3264815; // as in test1.dat
+  const double FOV = 80.;
+  const double earthRadius = 6371000;
+
+  /// The synthetic fleet layouts.
+  enum Layout {
+    Uniform,    ///< bearings uniform on the circle, 0.5 to 20 km away
+    Clustered,  ///< a few tight clusters of bearings
+    SingleFOV,  ///< every vessel within one 60 degree sector
+    WrapAround, ///< a 40 degree sector straddling the -180/+180 bearing cut
+    Antipodal   ///< near the drone's antipode, where bearings are ill-conditioned
+  };
+
+  /// A fleet in structure-of-arrays layout, positions in degrees.
+  struct Fleet {
+    std::vector<std::string> name;
+    std::vector<double> lat;
+    std::vector<double> lon;
+  };
+
+  // Position at the given bearing (counterclockwise from East) and distance from the drone
+  void destination(double bearing, double dist, double &lat, double &lon) {
+    const double lat1 = droneLat*M_PI/180, lon1 = droneLon*M_PI/180;
+    const double theta = M_PI/2 - bearing, delta = dist/earthRadius; // clockwise from North
+    const double lat2 = asin(sin(lat1)*cos(delta) + cos(lat1)*sin(delta)*cos(theta));
+    const double lon2 = lon1 + atan2(sin(theta)*sin(delta)*cos(lat1), cos(delta) - sin(lat1)*sin(lat2));
+    lat = lat2*180/M_PI;
+    lon = remainder(lon2*180/M_PI, 360.);
+  }
+
+  // Generate a fleet of n vessels (deterministic for a given layout and n)
+  Fleet makeFleet(Layout layout, std::size_t n) {
+    std::mt19937_64 gen(1000*layout + n);
+    std::uniform_real_distribution<double> uniform(0., 1.);
+    std::normal_distribution<double> normal(0., 1.);
+    const double clusters[] = {-2.5, -.4, 1.1, 2.};
+
+    Fleet fleet;
+    fleet.name.reserve(n);
+    fleet.lat.resize(n);
+    fleet.lon.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      double bearing, dist = 500 + 19500*uniform(gen);
+      switch (layout) {
+        case Uniform:    bearing = 2*M_PI*uniform(gen) - M_PI;                  break;
+        case Clustered:  bearing = clusters[i%4] + 2*M_PI/180*normal(gen);       break;
+        case SingleFOV:  bearing = 1. + 60*M_PI/180*uniform(gen);                break;
+        case WrapAround: bearing = M_PI + 40*M_PI/180*(uniform(gen) - .5);       break;
+        default:         bearing = 2*M_PI*uniform(gen) - M_PI;
+                         dist    = M_PI*earthRadius - 1000 - 49000*uniform(gen); break;
+      }
+      destination(bearing, dist, fleet.lat[i], fleet.lon[i]);
+      fleet.name.push_back("V" + std::to_string(i));
+    }
+    return fleet;
+  }
+
+  // Fleets are cached: the largest ones take a while to generate
+  const Fleet &getFleet(Layout layout, std::size_t n) {
+    static std::map<std::pair<int, std::size_t>, Fleet> cache;
+    auto key = std::make_pair(int(layout), n);
+    auto ptr = cache.find(key);
+    if (ptr == cache.end()) {
+      cache.clear();   // keep at most one fleet in memory
+      ptr = cache.insert(std::make_pair(key, makeFleet(layout, n))).first;
+    }
+    return ptr->second;
+  }
+
+  std::vector<gimbaledCamera::RelativeVessel> makeVessels(const Fleet &fleet) {
+    gimbaledCamera::Vessel drone(droneLat, droneLon, "drone");
+    std::vector<gimbaledCamera::RelativeVessel> vessels;
+    vessels.reserve(fleet.lat.size());
+    for (std::size_t i = 0; i < fleet.lat.size(); ++i)
+      vessels.emplace_back(fleet.lat[i], fleet.lon[i], fleet.name[i], drone);
+    return vessels;
+  }
+
+  /* RelativeVessel construction, one vessel at a time */
+  void BM_RelativeVessel(benchmark::State &state, Layout layout) {
+    const Fleet &fleet = getFleet(layout, state.range(0));
+    for (auto _ : state) {
+      std::vector<gimbaledCamera::RelativeVessel> vessels = makeVessels(fleet);
+      benchmark::DoNotOptimize(vessels.data());
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+  }
+
+  /* RelativeVessel construction with a fast precision policy (margins inflated) */
+  template<class P> void BM_RelativeVesselPolicy(benchmark::State &state, Layout layout) {
+    const Fleet &fleet = getFleet(layout, state.range(0));
+    gimbaledCamera::Vessel drone(droneLat, droneLon, "drone");
+    for (auto _ : state) {
+      std::vector<gimbaledCamera::RelativeVessel> vessels;
+      vessels.reserve(fleet.lat.size());
+      for (std::size_t i = 0; i < fleet.lat.size(); ++i)
+        vessels.emplace_back(fleet.lat[i], fleet.lon[i], fleet.name[i], drone, 100, P());
+      benchmark::DoNotOptimize(vessels.data());
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+  }
+
+  /* computeRelativeBatch with the best kernel for this CPU */
+  void BM_ComputeRelativeBatch(benchmark::State &state, Layout layout) {
+    const Fleet &fleet = getFleet(layout, state.range(0));
+    gimbaledCamera::Vessel drone(droneLat, droneLon, "drone");
+    const std::size_t n = state.range(0);
+    std::vector<double> bearing(n), dist(n), margin(n);
+    for (auto _ : state) {
+      gimbaledCamera::computeRelativeBatch(drone, n, fleet.lat.data(), fleet.lon.data(),
+          bearing.data(), dist.data(), margin.data());
+      benchmark::DoNotOptimize(bearing.data());
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+  }
+
+  /* ObserverFrame::computeBatch: planar within 20 km, spherical beyond (all of Antipodal) */
+  void BM_ObserverFrame(benchmark::State &state, Layout layout) {
+    const Fleet &fleet = getFleet(layout, state.range(0));
+    const gimbaledCamera::ObserverFrame frame(gimbaledCamera::Vessel(droneLat, droneLon, "drone"));
+    const std::size_t n = state.range(0);
+    std::vector<double> bearing(n), dist(n), margin(n);
+    for (auto _ : state) {
+      frame.computeBatch(n, fleet.lat.data(), fleet.lon.data(), bearing.data(), dist.data(), margin.data());
+      benchmark::DoNotOptimize(bearing.data());
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+  }
+
+  /* Sorting by bearing, as done at the start of makePictures */
+  void BM_SortByBearing(benchmark::State &state, Layout layout) {
+    const std::vector<gimbaledCamera::RelativeVessel> vessels = makeVessels(getFleet(layout, state.range(0)));
+    for (auto _ : state) {
+      state.PauseTiming();
+      std::vector<gimbaledCamera::RelativeVessel> copy = vessels;
+      state.ResumeTiming();
+      std::stable_sort(copy.begin(), copy.end(), gimbaledCamera::sortByBearing);
+      benchmark::DoNotOptimize(copy.data());
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+  }
+
+  /* makePictures, sort included (the vessels are copied outside the timing) */
+  void BM_MakePictures(benchmark::State &state, Layout layout) {
+    const std::vector<gimbaledCamera::RelativeVessel> vessels = makeVessels(getFleet(layout, state.range(0)));
+    std::size_t pictures = 0;
+    for (auto _ : state) {
+      state.PauseTiming();
+      std::vector<gimbaledCamera::RelativeVessel> copy = vessels;
+      state.ResumeTiming();
+      gimbaledCamera::Plan plan = makePictures(FOV, std::move(copy));
+      pictures = plan.size();
+      benchmark::DoNotOptimize(pictures);
+    }
+    state.counters["pictures"] = pictures;
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+  }
+
+  /* makePictures of compact vessels, sort and expansion included */
+  void BM_MakeCompactPictures(benchmark::State &state, Layout layout) {
+    const std::vector<gimbaledCamera::RelativeVessel> vessels = makeVessels(getFleet(layout, state.range(0)));
+    const std::vector<gimbaledCamera::CompactVessel> compact(vessels.begin(), vessels.end());
+    std::size_t pictures = 0;
+    for (auto _ : state) {
+      state.PauseTiming();
+      std::vector<gimbaledCamera::CompactVessel> copy = compact;
+      state.ResumeTiming();
+      gimbaledCamera::Plan plan = makePictures(FOV, std::move(copy));
+      pictures = plan.size();
+      benchmark::DoNotOptimize(pictures);
+    }
+    state.counters["pictures"] = pictures;
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+  }
+
+  /* makeMinimalPictures, sort included */
+  void BM_MakeMinimalPictures(benchmark::State &state, Layout layout) {
+    const std::vector<gimbaledCamera::RelativeVessel> vessels = makeVessels(getFleet(layout, state.range(0)));
+    std::size_t pictures = 0;
+    for (auto _ : state) {
+      state.PauseTiming();
+      std::vector<gimbaledCamera::RelativeVessel> copy = vessels;
+      state.ResumeTiming();
+      gimbaledCamera::Plan plan = makeMinimalPictures(FOV, std::move(copy));
+      pictures = plan.size();
+      benchmark::DoNotOptimize(pictures);
+    }
+    state.counters["pictures"] = pictures;
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+  }
+
+  /* makePictures into a kept plan, with the scratch memory from a FrameArena: no allocation */
+  void BM_MakePicturesArena(benchmark::State &state, Layout layout) {
+    const std::vector<gimbaledCamera::RelativeVessel> vessels = makeVessels(getFleet(layout, state.range(0)));
+    gimbaledCamera::FrameArena arena;
+    gimbaledCamera::Plan plan;
+    for (auto _ : state) {
+      arena.reset();
+      makePictures(FOV, vessels, plan, arena);
+      benchmark::DoNotOptimize(plan.size());
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+  }
+
+  /* BudgetedPlanner: the best 2 pictures, vessels weighted by distance (the planner is reused) */
+  void BM_MakeBudgetedPictures(benchmark::State &state, Layout layout) {
+    const std::vector<gimbaledCamera::RelativeVessel> vessels = makeVessels(getFleet(layout, state.range(0)));
+    gimbaledCamera::BudgetedPlanner planner(FOV);
+    const gimbaledCamera::BudgetedPlanner::Weight weight = 
+      [](const gimbaledCamera::RelativeVessel &v) { return 1/v.getDistance(); };
+    for (auto _ : state) {
+      state.PauseTiming();
+      std::vector<gimbaledCamera::RelativeVessel> copy = vessels;
+      state.ResumeTiming();
+      gimbaledCamera::Plan plan = planner.plan(std::move(copy), 2, weight);
+      benchmark::DoNotOptimize(plan.size());
+    }
+    state.counters["cuts"] = planner.getReport().cuts;
+    state.counters["held"] = planner.getReport().weight/planner.getReport().totalWeight;
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+  }
+
+  /* makePanTiltPictures: a 40 degrees VFOV, 20 m above the sea */
+  void BM_MakePanTiltPictures(benchmark::State &state, Layout layout) {
+    const std::vector<gimbaledCamera::RelativeVessel> vessels = makeVessels(getFleet(layout, state.range(0)));
+    for (auto _ : state) {
+      state.PauseTiming();
+      std::vector<gimbaledCamera::RelativeVessel> copy = vessels;
+      state.ResumeTiming();
+      gimbaledCamera::PanTiltPlan plan = makePanTiltPictures(FOV, 40, 20, std::move(copy));
+      benchmark::DoNotOptimize(plan.plan.size());
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+  }
+
+  /* makeZoomPictures: three zoom levels, for 10 m vessels seen with 40 of 4000 pixels */
+  void BM_MakeZoomPictures(benchmark::State &state, Layout layout) {
+    const std::vector<gimbaledCamera::RelativeVessel> vessels = makeVessels(getFleet(layout, state.range(0)));
+    const std::vector<gimbaledCamera::ZoomLevel> levels = {
+      {FOV, .5, gimbaledCamera::resolvedRange(FOV, 4000, 10, 40)},
+      {20,  .8, gimbaledCamera::resolvedRange(20,  4000, 10, 40)},
+      {5,   1., gimbaledCamera::resolvedRange(5,   4000, 10, 40)} };
+    std::size_t pictures = 0;
+    for (auto _ : state) {
+      state.PauseTiming();
+      std::vector<gimbaledCamera::RelativeVessel> copy = vessels;
+      state.ResumeTiming();
+      gimbaledCamera::ZoomPlan plan = makeZoomPictures(levels, std::move(copy));
+      pictures = plan.plan.size();
+      benchmark::DoNotOptimize(pictures);
+    }
+    state.counters["pictures"] = pictures;
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+  }
+
+  /* The report printed by main: every picture with its vessels, then the trigger angles */
+  void BM_FormatOutput(benchmark::State &state, Layout layout) {
+    const gimbaledCamera::Plan plan = makePictures(FOV, makeVessels(getFleet(layout, state.range(0))));
+    std::ostringstream output;
+    for (auto _ : state) {
+      output.str("");
+      for (auto & picture : plan)
+        output << std::endl << picture;
+      output << std::setprecision(0) << std::fixed;
+      for (auto & picture : plan)
+        output << picture.getCameraAngleDeg<gimbaledCamera::Frame::Camera>() << ", ";
+      benchmark::DoNotOptimize(output.tellp());
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+  }
+
+  /* The quiet output of main: the schedule as CSV through a BufferedWriter, to /dev/null */
+  void BM_WriteSchedule(benchmark::State &state, Layout layout) {
+    const gimbaledCamera::Plan plan = makePictures(FOV, makeVessels(getFleet(layout, state.range(0))));
+    const gimbaledCamera::Schedule schedule = gimbaledCamera::schedulePictures(plan, 0);
+    const int fd = open("/dev/null", O_WRONLY);
+    for (auto _ : state) {
+      gimbaledCamera::BufferedWriter output(fd);
+      gimbaledCamera::writeSchedule(output, plan, schedule, gimbaledCamera::OutputFormat::CSV);
+      output.flush();
+    }
+    close(fd);
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+  }
+
+  /* planBatch: 16 observers spread around the drone, over one shared snapshot */
+  void BM_PlanBatch(benchmark::State &state) {
+    const Fleet &fleet = getFleet(Uniform, state.range(0));
+    gimbaledCamera::VesselSnapshot snapshot;
+    snapshot.reserve(fleet.lat.size(), 8*fleet.lat.size());
+    for (std::size_t i = 0; i < fleet.lat.size(); ++i)
+      snapshot.push_back(fleet.name[i], fleet.lat[i], fleet.lon[i]);
+
+    std::vector<gimbaledCamera::Observer> observers;
+    for (int i = 0; i < 16; ++i) {
+      double lat, lon;
+      destination(2*M_PI*i/16, 5000, lat, lon);
+      observers.push_back({gimbaledCamera::Vessel(lat, lon, "observer"), FOV, 100});
+    }
+
+    gimbaledCamera::ThreadPool pool(state.range(1));
+    for (auto _ : state) {
+      std::vector<gimbaledCamera::Plan> plans = gimbaledCamera::planBatch(observers, snapshot, pool);
+      benchmark::DoNotOptimize(plans.data());
+    }
+    state.SetItemsProcessed(state.iterations()*observers.size()*state.range(0));
+  }
+
+  /* makeRelativeVessels and makePictures of one fleet on a thread pool */
+  void BM_ParallelPlanner(benchmark::State &state) {
+    const Fleet &fleet = getFleet(Uniform, state.range(0));
+    gimbaledCamera::VesselSnapshot snapshot;
+    snapshot.reserve(fleet.lat.size(), 8*fleet.lat.size());
+    for (std::size_t i = 0; i < fleet.lat.size(); ++i)
+      snapshot.push_back(fleet.name[i], fleet.lat[i], fleet.lon[i]);
+    std::vector<std::uint32_t> ids(snapshot.size());
+    for (std::size_t i = 0; i < ids.size(); ++i)
+      ids[i] = i;
+    const gimbaledCamera::Vessel drone(droneLat, droneLon, "drone");
+
+    gimbaledCamera::ThreadPool pool(state.range(1));
+    for (auto _ : state) {
+      gimbaledCamera::Plan plan = makePictures(FOV, gimbaledCamera::makeRelativeVessels(drone, snapshot, ids, pool), pool);
+      benchmark::DoNotOptimize(plan.size());
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+  }
+
+  /* planObserver over a world-wide feed (plus 1000 vessels around the drone), 
+   * within 20 km: every contact converted, or only those the index finds */
+  void BM_PlanIndexed(benchmark::State &state) {
+    const std::size_t n = state.range(0);
+    std::mt19937_64 gen(n);
+    std::uniform_real_distribution<double> uniform(0., 1.);
+    gimbaledCamera::VesselSnapshot snapshot;
+    snapshot.reserve(n + 1000, 8*(n + 1000));
+    for (std::size_t i = 0; i < n; ++i)
+      snapshot.push_back("V" + std::to_string(i), asin(2*uniform(gen) - 1)*180/M_PI, 360*uniform(gen) - 180);
+    for (std::size_t i = 0; i < 1000; ++i) {
+      double lat, lon;
+      destination(2*M_PI*uniform(gen), 500 + 19500*uniform(gen), lat, lon);
+      snapshot.push_back("N" + std::to_string(i), lat, lon);
+    }
+    const gimbaledCamera::Observer observer = {gimbaledCamera::Vessel(droneLat, droneLon, "drone"), FOV, 100};
+    const double range = 20000;
+    gimbaledCamera::SpatialIndex index;
+    index.build(snapshot);
+
+    for (auto _ : state) {
+      if (state.range(1)) {
+        gimbaledCamera::Plan plan = gimbaledCamera::planObserver(observer, snapshot, index, range);
+        benchmark::DoNotOptimize(plan.size());
+      } else {
+        gimbaledCamera::Plan plan = gimbaledCamera::planObserver(observer, snapshot);
+        benchmark::DoNotOptimize(plan.size());
+      }
+    }
+    state.SetItemsProcessed(state.iterations()*snapshot.size());
+  }
+
+  /* ContactQueue and ContactTable: 1M updates of 10k vessels pushed by 1 to 8 sensor
+   * threads, ingested by this one, then planned */
+  void BM_ContactIngest(benchmark::State &state) {
+    const Fleet &fleet = getFleet(Uniform, 10000);
+    std::vector<std::uint32_t> ids;
+    for (auto & name : fleet.name)
+      ids.push_back(gimbaledCamera::NameTable::global().intern(name));
+    const gimbaledCamera::Vessel drone(droneLat, droneLon, "drone");
+    const std::size_t updates = 1000000, producers = state.range(0);
+
+    for (auto _ : state) {
+      gimbaledCamera::ContactQueue queue;
+      gimbaledCamera::ContactTable table;
+      std::vector<std::thread> threads;
+      for (std::size_t p = 0; p < producers; ++p)
+        threads.emplace_back([&, p]() {
+          for (std::size_t i = p; i < updates; i += producers)
+            queue.push(ids[i%ids.size()], fleet.lat[i%ids.size()], fleet.lon[i%ids.size()]);
+        });
+      std::size_t ingested = 0;
+      while (ingested < updates)
+        ingested += table.ingest(queue, 4096);
+      for (auto & thread : threads)
+        thread.join();
+      gimbaledCamera::Plan plan = makePictures(FOV, table.relativeVessels(drone));
+      table.planned();
+      benchmark::DoNotOptimize(plan.size());
+    }
+    state.SetItemsProcessed(state.iterations()*updates);
+  }
+
+  /* planWithMotion: every vessel with its own course and speed, default slew model */
+  void BM_PlanWithMotion(benchmark::State &state) {
+    const Fleet &fleet = getFleet(Uniform, state.range(0));
+    const std::size_t n = fleet.lat.size();
+    gimbaledCamera::VesselSnapshot snapshot;
+    snapshot.reserve(n, 8*n);
+    std::vector<double> course(n), speed(n);
+    std::mt19937_64 gen(n);
+    std::uniform_real_distribution<double> uniform(0., 1.);
+    for (std::size_t i = 0; i < n; ++i) {
+      snapshot.push_back(fleet.name[i], fleet.lat[i], fleet.lon[i]);
+      course[i] = 360*uniform(gen);
+      speed[i]  = 15*uniform(gen);
+    }
+    const gimbaledCamera::Vessel drone(droneLat, droneLon, "drone", 30, 10);
+
+    int iterations = 0;
+    for (auto _ : state) {
+      gimbaledCamera::MotionPlan plan = 
+        gimbaledCamera::planWithMotion(FOV, drone, snapshot, course.data(), speed.data(), 0);
+      iterations = plan.iterations;
+      benchmark::DoNotOptimize(plan.captureTime.data());
+    }
+    state.counters["plans"] = iterations;
+    state.SetItemsProcessed(state.iterations()*n);
+  }
+
+  // Register every stage for every layout, from 10 to 10M vessels
+  int registerAll() {
+    const std::pair<Layout, const char *> layouts[] = {
+      {Uniform, "Uniform"}, {Clustered, "Clustered"}, {SingleFOV, "SingleFOV"},
+      {WrapAround, "WrapAround"}, {Antipodal, "Antipodal"} };
+    const std::pair<void (*)(benchmark::State &, Layout), const char *> stages[] = {
+      {BM_RelativeVessel,       "BM_RelativeVessel"},
+      {BM_RelativeVesselPolicy<gimbaledCamera::precision::Poly>,  "BM_RelativeVesselPoly"},
+      {BM_RelativeVesselPolicy<gimbaledCamera::precision::Table>, "BM_RelativeVesselTable"},
+      {BM_ComputeRelativeBatch, "BM_ComputeRelativeBatch"},
+      {BM_ObserverFrame,        "BM_ObserverFrame"},
+      {BM_SortByBearing,        "BM_SortByBearing"},
+      {BM_MakePictures,         "BM_MakePictures"},
+      {BM_MakeCompactPictures,  "BM_MakeCompactPictures"},
+      {BM_MakePicturesArena,    "BM_MakePicturesArena"},
+      {BM_MakeMinimalPictures,  "BM_MakeMinimalPictures"},
+      {BM_MakeBudgetedPictures, "BM_MakeBudgetedPictures"},
+      {BM_MakePanTiltPictures,  "BM_MakePanTiltPictures"},
+      {BM_MakeZoomPictures,     "BM_MakeZoomPictures"},
+      {BM_FormatOutput,         "BM_FormatOutput"},
+      {BM_WriteSchedule,        "BM_WriteSchedule"} };
+
+    // grouped by layout and size, so that each fleet is generated once
+    for (auto & layout : layouts)
+      for (long n = 10; n <= 10000000; n *= 10)
+        for (auto & stage : stages)
+          benchmark::RegisterBenchmark((std::string(stage.second) + "/" + layout.second).c_str(), 
+              stage.first, layout.first)
+            ->Arg(n)->Unit(benchmark::kMicrosecond);
+
+    for (long n = 1000; n <= 100000; n *= 10)
+      benchmark::RegisterBenchmark("BM_PlanWithMotion", BM_PlanWithMotion)
+        ->Arg(n)->Unit(benchmark::kMillisecond);
+
+    for (long threads = 1; threads <= 8; threads *= 2)
+      benchmark::RegisterBenchmark("BM_ContactIngest", BM_ContactIngest)
+        ->Arg(threads)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+    for (long threads = 1; threads <= 16; threads *= 2)
+      benchmark::RegisterBenchmark("BM_ParallelPlanner", BM_ParallelPlanner)
+        ->Args({1000000, threads})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+    for (long n = 10000; n <= 1000000; n *= 10)
+      benchmark::RegisterBenchmark("BM_PlanIndexed", BM_PlanIndexed)
+        ->Args({n, 0})->Args({n, 1})->Unit(benchmark::kMillisecond);
+
+    for (long threads = 1; threads <= 16; threads *= 2)
+      benchmark::RegisterBenchmark("BM_PlanBatch", BM_PlanBatch)
+        ->Args({100000, threads})->Unit(benchmark::kMillisecond)->UseRealTime();
+    return 0;
+  }
+
+  const int registered = registerAll();
+
+}
+
+BENCHMARK_MAIN();
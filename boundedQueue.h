@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+/** @file */
+
+namespace gimbaledCamera {
+
+  /** A blocking queue of bounded capacity between two pipeline stages.
+   *
+   *  push waits while the queue is full, so a fast stage cannot run ahead of
+   *  a slow one by more than the capacity; pop waits while it is empty.
+   *  The producer calls close when it is done: pop then returns false once
+   *  the queue is drained.  A consumer that fails calls close too, so that
+   *  the producer's push returns false instead of waiting forever.
+   */
+  template<class T> class BoundedQueue {
+
+    public:
+
+      /// Class constructor.
+      explicit BoundedQueue(
+          std::size_t capacityin=4 /** the most items waiting in the queue (at least 1) */
+          ) : capacity(capacityin ? capacityin : 1), closed(false) {};
+
+      BoundedQueue(const BoundedQueue &) = delete;
+      BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+      /// Appends an item, waiting for room.  Returns false (and drops the item) if the queue is closed.
+      bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this]() { return closed || items.size() < capacity; });
+        if (closed)
+          return false;
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+        return true;
+      };
+
+      /// Takes the oldest item, waiting for one.  Returns false once the queue is closed and empty.
+      bool pop(T &item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this]() { return closed || !items.empty(); });
+        if (items.empty())
+          return false;
+        item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+      };
+
+      /// Refuses further items, and wakes every waiting thread.
+      void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+      };
+
+    private:
+
+      const std::size_t capacity;         ///< Most items waiting
+      std::deque<T> items;                ///< The items, oldest first
+      bool closed;                        ///< True once close was called
+      std::mutex mutex;                   ///< Guards items and closed
+      std::condition_variable notFull;    ///< Signals room for an item, or close
+      std::condition_variable notEmpty;   ///< Signals an item, or close
+
+  };
+
+}
+
+#endif
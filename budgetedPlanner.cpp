@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "budgetedPlanner.h"
+#include "stats.h"
+
+namespace gimbaledCamera {
+
+  BudgetedPlanner::BudgetedPlanner(const double FOVin, const std::size_t maxCutsin) 
+    : FOV(FOVin), maxCuts(std::max<std::size_t>(1, maxCutsin)), n(0) {
+  }
+
+  // The best weight of K pictures on the circle cut at position cut (in [n, 2n)),
+  // recording the decisions if asked
+  double BudgetedPlanner::bestOnLine(std::size_t cut, std::size_t K, bool record) {
+    prefix.resize(n+1);
+    prefix[0] = 0;
+    for (std::size_t p = 0; p < n; ++p)
+      prefix[p+1] = prefix[p] + weights[(cut + p)%n];
+    if (record)
+      taken.assign(((K+1)*(n+1) + 63)/64, 0);
+
+    // best[p] is the best weight of k pictures among the first p vessels of
+    // the line: either vessel p-1 is left out, or the widest picture ending
+    // at it is taken
+    previous.assign(n+1, 0.);
+    best.resize(n+1);
+    for (std::size_t k = 1; k <= K; ++k) {
+      best[0] = 0;
+      for (std::size_t p = 0; p < n; ++p) {
+        const std::size_t s = std::max(start[cut + p], cut) - cut;
+        const double take = previous[s] + (prefix[p+1] - prefix[s]);
+        if (take > best[p]) {
+          best[p+1] = take;
+          if (record)
+            taken[(k*(n+1) + p+1) >> 6] |= std::uint64_t(1) << ((k*(n+1) + p+1) & 63);
+        } else {
+          best[p+1] = best[p];
+        }
+      }
+      best.swap(previous);
+    }
+    return previous[n];
+  }
+
+  // Take the K pictures that hold the most weight
+  Plan BudgetedPlanner::plan(std::vector<RelativeVessel> vessels, std::size_t K, const Weight &weight) {
+
+    // if K pictures are enough for every vessel, take them all
+    Plan plan = makeMinimalPictures(FOV, std::move(vessels));
+    n = plan.getVessels().size();
+    report = BudgetReport();
+
+    weights.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      weights[i] = weight ? weight(plan.getVessels()[i]) : 1.;
+      if (!(weights[i] >= 0) || !std::isfinite(weights[i]))
+        throw std::invalid_argument("BudgetedPlanner: vessel weights must be finite and non-negative");
+      report.totalWeight += weights[i];
+    }
+    if (plan.size() <= K) {
+      report.weight = report.upperBound = report.totalWeight;
+      return plan;
+    }
+
+    // otherwise start again from the vessels in bearing order (the buffer of
+    // the minimal plan is rotated)
+    Plan::Builder builder(std::move(plan));
+    const std::vector<RelativeVessel> &sorted = builder.getVessels();
+    const std::size_t first = std::is_sorted_until(sorted.begin(), sorted.end(), sortByBearing) - sorted.begin();
+    builder.rotate(first);
+    std::rotate(weights.begin(), weights.begin() + first, weights.end());
+
+    GIMBALEDCAMERA_TIME(Partition);
+
+    // start[q] is the first position of the widest picture ending at position
+    // q, on the circle unrolled three times (position q is vessel q%n, q/n
+    // turns later).  Pictures grow with two pointers; two monotonic queues
+    // keep the running min of left and max of right.
+    const std::size_t length = 3*n;
+    auto left  = [&](std::size_t q) { 
+      return sorted[q%n].getBearing() - sorted[q%n].getMargin() + 2*M_PI*(q/n); };
+    auto right = [&](std::size_t q) { 
+      return sorted[q%n].getBearing() + sorted[q%n].getMargin() + 2*M_PI*(q/n); };
+    start.resize(length);
+    queues.resize(2*length);
+    std::size_t *minLeft = queues.data(), *maxRight = queues.data() + length;
+    std::size_t minHead = 0, minTail = 0, maxHead = 0, maxTail = 0;
+    std::size_t i = 0;
+    for (std::size_t q = 0; q < length; ++q) {
+      while (minHead < minTail && left(minLeft[minTail-1])   >= left(q))  --minTail;
+      while (maxHead < maxTail && right(maxRight[maxTail-1]) <= right(q)) --maxTail;
+      minLeft[minTail++]  = q;
+      maxRight[maxTail++] = q;
+      if (q >= n && i < q+1-n)                   // a picture never holds more than n vessels
+        i = q+1-n;
+      while (true) {
+        while (minLeft[minHead]  < i) ++minHead;
+        while (maxRight[maxHead] < i) ++maxHead;
+        if (i == q || right(maxRight[maxHead]) - left(minLeft[minHead]) < builder.getFOV())
+          break;
+        ++i;
+      }
+      start[q] = i;
+    }
+
+    // cut the circle where the fewest widest pictures cross: those ending at
+    // positions [cut, end) start before it
+    std::size_t bestCut = n, bestEnd = 2*n;
+    for (std::size_t cut = n, end = n; cut < 2*n; ++cut) {
+      end = std::max(end, cut);
+      while (start[end] < cut)
+        ++end;
+      if (end - cut < bestEnd - bestCut) {
+        bestCut = cut;
+        bestEnd = end;
+      }
+    }
+
+    // the best plan crosses nothing at bestCut, or ends a picture at one of
+    // the crossing ones: cut there too.  Cuts are taken modulo n.
+    const std::size_t candidates = bestEnd - bestCut + 1;
+    const std::size_t tried = std::min(candidates, maxCuts);
+    double bestWeight = -1;
+    std::size_t cut = bestCut;
+    for (std::size_t k = 0; k < tried; ++k) {
+      const std::size_t candidate = n + (bestCut + k*(candidates-1)/std::max<std::size_t>(1, tried-1))%n;
+      const double value = bestOnLine(candidate, K, false);
+      if (value > bestWeight) {
+        bestWeight = value;
+        cut = candidate;
+      }
+    }
+    report.cuts = tried;
+    report.exact = tried == candidates;
+    report.weight = bestOnLine(cut, K, true);
+    report.upperBound = report.exact ? report.weight : std::max(report.weight, bestOnLine(bestCut, K+1, false));
+
+    // rebuild the pictures of the best cut, from the last one, and make the
+    // cut the start of the buffer
+    std::vector<std::pair<std::size_t, std::size_t>> runs;
+    for (std::size_t p = n, k = K; k > 0 && p > 0; ) {
+      if (taken[(k*(n+1) + p) >> 6] & (std::uint64_t(1) << ((k*(n+1) + p) & 63))) {
+        const std::size_t s = std::max(start[cut + p-1], cut) - cut;
+        runs.push_back(std::make_pair(s, p));
+        p = s;
+        --k;
+      } else {
+        --p;
+      }
+    }
+    builder.rotate(cut - n);
+    GIMBALEDCAMERA_COUNT(Pictures, runs.size());
+    builder.reserve(runs.size());
+    for (std::size_t k = runs.size(); k-- > 0; )
+      builder.addPicture(runs[k].first, runs[k].second);
+    return builder.build();
+  }
+
+}
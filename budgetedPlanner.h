@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "gimbaledCamera.h"
+
+#ifndef BUDGETEDPLANNER_H
+#define BUDGETEDPLANNER_H
+
+/** @file */
+
+namespace gimbaledCamera {
+
+  /// How good the last budgeted plan is.
+  struct BudgetReport {
+    double weight = 0;        ///< Weight of the vessels in the pictures
+    double totalWeight = 0;   ///< Weight of all vessels
+    double upperBound = 0;    ///< No K pictures hold more weight than this
+    std::size_t cuts = 0;     ///< Number of cuts of the circle tried
+    bool exact = true;        ///< True if weight is the best possible
+  };
+
+  /** Takes the K pictures that hold the most weight, when there is no time
+   *  to take them all.
+   *
+   *  Pictures are runs of consecutive vessels, sorted by bearing, whose
+   *  bearings span less than the FOV, margins included (as in
+   *  makeMinimalPictures).  The weight of a vessel is given by the caller,
+   *  e.g. from its priority, its distance or the age of its last photo.  If
+   *  K pictures are enough for all vessels, the plan of makeMinimalPictures
+   *  is returned.  Otherwise:
+   *
+   *  - Two sliding windows find the widest picture ending at each vessel.
+   *    Widening a picture to the left never loses weight, so some best plan
+   *    only uses such pictures (cut short where the circle is cut).
+   *  - On a line, a DP over (pictures used, last vessel) finds the best K
+   *    pictures in O(nK).
+   *  - On the circle, the line is cut where the fewest widest pictures
+   *    cross.  The best plan either crosses nothing there, or it ends a
+   *    picture at one of those crossing pictures.  One DP is run for each
+   *    case.
+   *
+   *  This costs O(n log n + nK) when some bearing gap is wider than the FOV,
+   *  and O(n log n + (1 + w)nK) in general, where w is the number of
+   *  pictures across the cut.  If 1 + w exceeds maxCuts, only maxCuts evenly
+   *  spaced cuts are tried.  The plan is then not guaranteed best, and the
+   *  report gives an upper bound: the best K+1 pictures on the line.
+   *
+   *  The scratch buffers are kept between calls, so planning frame after
+   *  frame does not allocate once the fleet stops growing.
+   */
+  class BudgetedPlanner {
+
+    public:
+
+      /// The weight of a vessel (non-negative).
+      typedef std::function<double(const RelativeVessel &)> Weight;
+
+      /// Class constructor.
+      explicit BudgetedPlanner(
+          const double FOV                /** the camera field of view, in degrees */,
+          const std::size_t maxCuts=16    /** most cuts of the circle tried (at least 1) */
+          );
+
+      /// Returns at most K pictures of the vessels that hold the most weight.
+      /// Throws std::invalid_argument if a weight is negative or not finite.
+      Plan plan(
+          std::vector<RelativeVessel> vessels /** the vessels to be photographed */,
+          std::size_t K                       /** the number of pictures there is time for */,
+          const Weight &weight=nullptr        /** the weight of a vessel; 1 for each vessel if empty */
+          );
+
+      /// Returns how good the last plan is.
+      inline const BudgetReport &getReport() const {
+        return report;
+      };
+
+    private:
+
+      double bestOnLine(std::size_t cut, std::size_t K, bool record); ///< The DP on the circle cut at a position
+
+      double FOV;                          ///< The picture field of view, in degrees (as makeMinimalPictures takes it)
+      std::size_t maxCuts;                 ///< Most cuts tried
+      BudgetReport report;                 ///< See getReport
+
+      std::size_t n;                       ///< Number of vessels planned
+      std::vector<double> weights;         ///< Weight of each vessel, in bearing order
+      std::vector<double> prefix;          ///< Prefix sums of the weights, from the cut
+      std::vector<std::size_t> start;      ///< First vessel of the widest picture ending at each position
+      std::vector<std::size_t> queues;     ///< The monotonic queues of the sliding windows
+      std::vector<double> best, previous;  ///< Two rows of the DP
+      std::vector<std::uint64_t> taken;    ///< The DP decisions, one bit each (recorded for the best cut)
+
+  };
+
+  /// Returns at most K pictures of the vessels that hold the most weight (see BudgetedPlanner).
+  inline Plan makeBudgetedPictures(
+      double FOV                          /** the camera field of view, in degrees */,
+      std::vector<RelativeVessel> vessels /** the vessels to be photographed */,
+      std::size_t K                       /** the number of pictures there is time for */,
+      const BudgetedPlanner::Weight &weight=nullptr /** the weight of a vessel; 1 for each vessel if empty */
+      ) {
+    return BudgetedPlanner(FOV).plan(std::move(vessels), K, weight);
+  }
+
+}
+
+#endif
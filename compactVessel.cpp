@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "compactVessel.h"
+#include "geodesy.h"
+#include "stats.h"
+
+namespace gimbaledCamera {
+
+  // Class constructor for CompactVessel: the margin is widened by the
+  // rounding error of the bearing, and rounded up
+  CompactVessel::CompactVessel(
+      const double latin, 
+      const double lonin, 
+      const std::uint32_t namein, 
+      const double bearingin, 
+      const double distin, 
+      const double bearingMarginin) :
+    bearing(bearingin), dist(distin), name(namein), 
+    lat(std::lround(latin*1e7)), lon(std::lround(lonin*1e7)) {
+    const double widened = bearingMarginin + std::fabs(double(bearing) - bearingin);
+    bearingMargin = std::nextafter(float(widened), std::numeric_limits<float>::infinity());
+  }
+
+  std::vector<CompactVessel> makeCompactVessels(const Vessel &drone, const VesselSnapshot &snapshot, const double margin) {
+    const std::size_t n = snapshot.size(), chunk = 1024;
+    std::vector<CompactVessel> vessels;
+    vessels.reserve(n);
+    double bearing[chunk], dist[chunk], bearingMargin[chunk];
+    for (std::size_t begin = 0; begin < n; begin += chunk) {
+      const std::size_t count = std::min(chunk, n - begin);
+      computeRelativeBatch(drone, count, snapshot.getLats() + begin, snapshot.getLons() + begin,
+          bearing, dist, bearingMargin, margin);
+      for (std::size_t i = 0; i < count; ++i)
+        vessels.emplace_back(snapshot.getLatDeg(begin+i), snapshot.getLonDeg(begin+i),
+            NameTable::global().intern(snapshot.getName(begin+i)), bearing[i], dist[i], bearingMargin[i]);
+    }
+    return vessels;
+  }
+
+  // Sort and partition the compact vessels, then expand them in bearing
+  // order into the plan buffer
+  Plan makePictures(double FOV, std::vector<CompactVessel> vessels) {
+
+    FOV *= M_PI/180;                                                         // convert field of view from degrees to radians
+    GIMBALEDCAMERA_COUNT(Vessels, vessels.size());
+    {
+      GIMBALEDCAMERA_TIME(Sort);
+      std::stable_sort(vessels.begin(), vessels.end(), 
+          [](const CompactVessel &a, const CompactVessel &b) { return a.getBearing() < b.getBearing(); });
+    }
+
+    // the expanded vessels hold the same bearings and margins, so the
+    // partition is the one makePictures makes of them
+    std::vector<std::size_t> starts;                                         // the first vessel of each picture
+    {
+      GIMBALEDCAMERA_TIME(Partition);
+      starts.resize(Plan::Builder::partition(FOV, vessels, nullptr));
+      Plan::Builder::partition(FOV, vessels, starts.data());
+    }
+
+    std::vector<RelativeVessel> sorted;
+    sorted.reserve(vessels.size());
+    for (auto & vessel : vessels)
+      sorted.push_back(vessel.expand());
+    Plan::Builder builder(FOV, std::move(sorted));
+    builder.addPictures(starts.data(), starts.size());
+    return builder.build();
+  }
+}
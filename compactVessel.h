@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "gimbaledCamera.h"
+#include "vesselIO.h"
+
+#ifndef COMPACTVESSEL_H
+#define COMPACTVESSEL_H
+
+/** @file */
+
+namespace gimbaledCamera {
+
+  /** A RelativeVessel in 24 bytes, to plan fleets of millions of vessels
+   *  within cache and a fraction of the memory.
+   *
+   *  Bearing, margin and distance are stored as float, the position in
+   *  fixed point (1e-7 degrees, about a centimeter), and the name as its id
+   *  in NameTable::global().  The margin is rounded up and widened by the
+   *  rounding error of the bearing, so the bearing range of a compact vessel
+   *  contains that of the vessel it was made from, and the pictures planned
+   *  from compact vessels still cover every vessel.
+   */
+  class CompactVessel {
+
+    public:
+
+      /// Class constructor, from a bearing, distance and margin computed elsewhere.
+      CompactVessel(
+          const double      /** vessel latitude, in degrees */, 
+          const double      /** vessel longitude, in degrees */, 
+          const std::uint32_t /** vessel name id */, 
+          const double      /** bearing, in radians */,
+          const double      /** distance, in meters */,
+          const double      /** bearing margin, in radians */
+          ); 
+
+      /// Class constructor, from a RelativeVessel.
+      explicit CompactVessel(const RelativeVessel &vessel) : CompactVessel(vessel.getLatDeg(), vessel.getLonDeg(),
+          vessel.getNameId(), vessel.getBearing(), vessel.getDistance(), vessel.getMargin()) {};
+
+      /// Returns the vessel latitude in degrees.
+      inline double getLatDeg() const { 
+        return lat*1e-7; 
+      };     
+
+      /// Returns the vessel longitude in degrees.
+      inline double getLonDeg() const { 
+        return lon*1e-7; 
+      };     
+
+      /// Returns bearing from reference vessels, in radians.
+      inline double getBearing() const { 
+        return bearing; 
+      };
+
+      /// Returns reference vessel margin, in radians.
+      inline double getMargin() const { 
+        return bearingMargin; 
+      };
+
+      /// Returns distance from reference vessel in meters.
+      inline double getDistance() const { 
+        return dist; 
+      };
+
+      /// Returns the id of the vessel name in NameTable::global().
+      inline std::uint32_t getNameId() const { 
+        return name; 
+      };
+
+      /// Returns the vessel name.
+      inline const std::string &getName() const { 
+        return NameTable::global().lookup(name); 
+      };
+
+      /// Returns the RelativeVessel with the stored values.
+      inline RelativeVessel expand() const {
+        return RelativeVessel(getLatDeg(), getLonDeg(), name, getBearing(), getDistance(), getMargin());
+      };
+
+    private:
+
+      float bearing;         ///< Bearing, in radians [-pi, +pi], zero is east
+      float bearingMargin;   ///< Bearing margin, in radians, rounded up
+      float dist;            ///< Distance, in meters
+      std::uint32_t name;    ///< Vessel name, as an id in NameTable::global()
+      std::int32_t lat;      ///< Vessel latitude, in 1e-7 degrees
+      std::int32_t lon;      ///< Vessel longitude, in 1e-7 degrees
+
+  };
+
+  static_assert(sizeof(CompactVessel) == 24, "CompactVessel should be 24 bytes");
+
+  /** Computes the compact vessels of a snapshot relative to the drone.  The
+   *  geometry is computed by computeRelativeBatch a thousand vessels at a
+   *  time, so the only storage proportional to the fleet is the result.
+   */
+  std::vector<CompactVessel> makeCompactVessels(
+      const Vessel &drone              /** drone instance */,
+      const VesselSnapshot &snapshot   /** the vessels */,
+      const double margin=100          /** the radius of the region around each vessel we want to capture, in meters */
+      );
+
+  /** Groups compact vessels into pictures, as makePictures does.  The sort
+   *  and the partition read the compact records only; the vessels are then
+   *  expanded, in bearing order, into the plan buffer, and the plan is the
+   *  one makePictures makes of them.  The peak memory is therefore the
+   *  compact records (24 bytes per vessel) plus the expanded buffer the plan
+   *  keeps.
+   */
+  Plan makePictures(
+      double FOV                          /** the camera field of view, in degrees */,
+      std::vector<CompactVessel> vessels  /** the vessels to be partitioned into pictures */
+      );
+
+}
+
+#endif
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include "contactQueue.h"
+#include "geodesy.h"
+#include "nameTable.h"
+#include "stats.h"
+
+namespace gimbaledCamera {
+
+  namespace {
+
+    inline std::int64_t now() {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+  }
+
+  ContactQueue::ContactQueue(std::size_t capacity, OverflowPolicy policyin) : 
+    policy(policyin), enqueuePos(0), dequeuePos(0), 
+    pushed(0), dropped(0), rejected(0), stalls(0), maxDepth(0) {
+    std::size_t size = 2;
+    while (size < capacity)
+      size *= 2;
+    mask = size - 1;
+    cells.reset(new Cell[size]);
+    for (std::size_t i = 0; i < size; ++i)
+      cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  bool ContactQueue::tryPush(const ContactUpdate &update) {
+    std::size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    while (true) {
+      Cell &cell = cells[pos & mask];
+      const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      const std::ptrdiff_t turn = std::ptrdiff_t(sequence - pos);
+      if (turn == 0) {
+        // the cell is free: claim it, then publish the update
+        if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          cell.update = update;
+          cell.sequence.store(pos + 1, std::memory_order_release);
+          pushed.fetch_add(1, std::memory_order_relaxed);
+          return true;
+        }
+      } else if (turn < 0) {
+        return false;   // the cell still holds an update from one lap ago: full
+      } else {
+        pos = enqueuePos.load(std::memory_order_relaxed);   // another producer took it
+      }
+    }
+  }
+
+  bool ContactQueue::pop(ContactUpdate &update) {
+    std::size_t pos = dequeuePos.load(std::memory_order_relaxed);
+    while (true) {
+      Cell &cell = cells[pos & mask];
+      const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      const std::ptrdiff_t turn = std::ptrdiff_t(sequence - (pos + 1));
+      if (turn == 0) {
+        // the cell is full: claim it, then hand it back to the producers of the next lap
+        if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          update = cell.update;
+          cell.sequence.store(pos + mask + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (turn < 0) {
+        return false;   // not pushed yet: empty
+      } else {
+        pos = dequeuePos.load(std::memory_order_relaxed);   // another consumer took it
+      }
+    }
+  }
+
+  bool ContactQueue::tryPush(std::uint32_t name, double lat, double lon) {
+    if (tryPush(ContactUpdate{name, lat, lon, now()}))
+      return true;
+    rejected.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  void ContactQueue::push(std::uint32_t name, double lat, double lon) {
+    const ContactUpdate update{name, lat, lon, now()};
+    if (tryPush(update))
+      return;
+
+    if (policy == OverflowPolicy::DropOldest) {
+      ContactUpdate oldest;
+      while (!tryPush(update))
+        if (pop(oldest)) {
+          dropped.fetch_add(1, std::memory_order_relaxed);
+          GIMBALEDCAMERA_COUNT(DroppedUpdates, 1);
+        }
+    } else {
+      stalls.fetch_add(1, std::memory_order_relaxed);
+      while (!tryPush(update))
+        std::this_thread::yield();
+    }
+  }
+
+  void ContactQueue::push(std::string_view name, double lat, double lon) {
+    push(NameTable::global().intern(name), lat, lon);
+  }
+
+  std::size_t ContactQueue::depth() const {
+    const std::size_t head = dequeuePos.load(std::memory_order_relaxed);
+    const std::size_t tail = enqueuePos.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+  }
+
+  std::size_t ContactQueue::drain(std::vector<ContactUpdate> &out, std::size_t max) {
+    const std::size_t current = depth();
+    if (current > maxDepth.load(std::memory_order_relaxed))
+      maxDepth.store(current, std::memory_order_relaxed);
+
+    const std::size_t begin = out.size();
+    ContactUpdate update;
+    while (out.size() - begin < max && pop(update))
+      out.push_back(update);
+    return out.size() - begin;
+  }
+
+  ContactQueue::Metrics ContactQueue::getMetrics() const {
+    return Metrics{pushed.load(std::memory_order_relaxed), dropped.load(std::memory_order_relaxed),
+      rejected.load(std::memory_order_relaxed), stalls.load(std::memory_order_relaxed), 
+      maxDepth.load(std::memory_order_relaxed)};
+  }
+
+  std::size_t ContactTable::ingest(ContactQueue &queue, std::size_t maxBatch) {
+    batch.clear();
+    queue.drain(batch, maxBatch);
+
+    for (auto & update : batch) {
+      if (update.name >= slotOf.size())
+        slotOf.resize(std::max<std::size_t>(update.name + 1, 2*slotOf.size()), UINT32_MAX);
+      std::uint32_t &slot = slotOf[update.name];
+      if (slot == UINT32_MAX) {
+        slot = names.size();
+        names.push_back(update.name);
+        lat.push_back(0);
+        lon.push_back(0);
+        firstPending.push_back(-1);
+      }
+
+      // the latest position replaces the others, the oldest push time is kept
+      lat[slot] = update.lat;
+      lon[slot] = update.lon;
+      if (firstPending[slot] < 0) {
+        firstPending[slot] = update.received;
+        pendingSlots.push_back(slot);
+      } else {
+        ++metrics.coalesced;
+      }
+    }
+    metrics.updates += batch.size();
+    return batch.size();
+  }
+
+  std::vector<RelativeVessel> ContactTable::relativeVessels(const Vessel &drone, const double margin) const {
+    const std::size_t n = names.size();
+    std::vector<double> bearing(n), dist(n), bearingMargin(n);
+    computeRelativeBatch(drone, n, lat.data(), lon.data(), bearing.data(), dist.data(), bearingMargin.data(), margin);
+
+    std::vector<RelativeVessel> vessels;
+    vessels.reserve(n);
+    for (std::size_t i = 0; i < n; ++i)
+      if (names[i] != drone.getNameId())   // the drone may report its own position
+        vessels.emplace_back(lat[i], lon[i], names[i], bearing[i], dist[i], bearingMargin[i]);
+    return vessels;
+  }
+
+  void ContactTable::planned() {
+    const std::int64_t time = now();
+    for (std::uint32_t slot : pendingSlots) {
+      const std::uint64_t latency = std::uint64_t(std::max<std::int64_t>(0, time - firstPending[slot]));
+      metrics.latencySum += latency;
+      metrics.latencyMax = std::max(metrics.latencyMax, latency);
+      if (stats::enabled)
+        stats::record(stats::Timer::UpdateToPlan, latency);
+      firstPending[slot] = -1;
+    }
+    metrics.planned += pendingSlots.size();
+    pendingSlots.clear();
+  }
+
+}
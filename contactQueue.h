@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "gimbaledCamera.h"
+
+#ifndef CONTACTQUEUE_H
+#define CONTACTQUEUE_H
+
+/** @file 
+ *  Ingestion of contact positions from several sensor threads.
+ *
+ *  Sensor threads (AIS, radar, optical tracker...) push position updates to
+ *  a ContactQueue, a bounded lock-free ring buffer.  The planner thread
+ *  drains it in batches into a ContactTable, which keeps the latest position
+ *  of each vessel (so that a vessel updated many times between two plans is
+ *  planned once) and gives the RelativeVessels to plan.
+ */
+
+namespace gimbaledCamera {
+
+  /// A position update.
+  struct ContactUpdate {
+    std::uint32_t name;     ///< Vessel name id, in NameTable::global()
+    double lat;             ///< Latitude, in degrees
+    double lon;             ///< Longitude, in degrees
+    std::int64_t received;  ///< Time of the push, in steady_clock nanoseconds
+  };
+
+  /// What ContactQueue::push does when the queue is full.
+  enum class OverflowPolicy {
+    Backpressure, ///< wait until the planner makes room
+    DropOldest    ///< discard the oldest update in the queue
+  };
+
+  /** A bounded multi-producer queue of position updates.
+   *
+   *  The ring buffer of D. Vyukov: each cell holds a sequence number that
+   *  tells producers and consumers whose turn it is, so pushing and popping
+   *  cost one compare-and-swap on the shared position and no lock.  Any
+   *  number of threads may push; drain is meant for one planner thread (it
+   *  is safe from several, but their updates interleave).
+   *
+   *  With DropOldest, a producer that finds the queue full pops the oldest
+   *  update itself and retries, so sensors never wait and the queue holds
+   *  the latest updates.
+   */
+  class ContactQueue {
+
+    public:
+
+      /// Counts of what happened to the updates.
+      struct Metrics {
+        std::uint64_t pushed;     ///< updates queued
+        std::uint64_t dropped;    ///< updates discarded by DropOldest
+        std::uint64_t rejected;   ///< tryPush calls that found the queue full
+        std::uint64_t stalls;     ///< push calls that waited for room (Backpressure)
+        std::size_t maxDepth;     ///< largest depth seen by drain
+      };
+
+      /// Class constructor.
+      explicit ContactQueue(
+          std::size_t capacity=1 << 16  /** number of updates held, rounded up to a power of two */,
+          OverflowPolicy policy=OverflowPolicy::Backpressure /** what push does when the queue is full */
+          );
+
+      ContactQueue(const ContactQueue &) = delete;
+      ContactQueue &operator=(const ContactQueue &) = delete;
+
+      /// Queues an update, applying the overflow policy if the queue is full.
+      void push(
+          std::uint32_t name  /** vessel name id, in NameTable::global() */,
+          double lat          /** latitude, in degrees */,
+          double lon          /** longitude, in degrees */
+          );
+
+      /// Same as above, interning the name.
+      void push(std::string_view name, double lat, double lon);
+
+      /// Queues an update if there is room; returns false (and queues nothing) otherwise.
+      bool tryPush(std::uint32_t name, double lat, double lon);
+
+      /// Moves up to max updates, oldest first, to the end of out; returns how many.
+      std::size_t drain(std::vector<ContactUpdate> &out, std::size_t max=SIZE_MAX);
+
+      /// Returns the number of updates in the queue (approximate while producers push).
+      std::size_t depth() const;
+
+      /// Returns the capacity.
+      inline std::size_t capacity() const {
+        return mask + 1;
+      };
+
+      /// Returns the counts of what happened to the updates.
+      Metrics getMetrics() const;
+
+    private:
+
+      /// A cell of the ring, and whose turn it is.
+      struct Cell {
+        std::atomic<std::size_t> sequence;
+        ContactUpdate update;
+      };
+
+      bool tryPush(const ContactUpdate &update);   ///< Queues an update if there is room
+      bool pop(ContactUpdate &update);             ///< Takes the oldest update, if any
+
+      std::unique_ptr<Cell[]> cells;     ///< The ring
+      std::size_t mask;                  ///< capacity - 1
+      OverflowPolicy policy;             ///< What push does when the queue is full
+
+      alignas(64) std::atomic<std::size_t> enqueuePos;  ///< Next cell to push to
+      alignas(64) std::atomic<std::size_t> dequeuePos;  ///< Next cell to pop from
+
+      alignas(64) std::atomic<std::uint64_t> pushed;    ///< See Metrics
+      std::atomic<std::uint64_t> dropped;               ///< See Metrics
+      std::atomic<std::uint64_t> rejected;              ///< See Metrics
+      std::atomic<std::uint64_t> stalls;                ///< See Metrics
+      std::atomic<std::size_t> maxDepth;                ///< See Metrics
+
+  };
+
+  /** The latest position of each vessel, fed by a ContactQueue (planner thread only).
+   *
+   *  Updates of a vessel replace each other, so a plan costs the number of
+   *  vessels rather than the number of updates.  The table also measures
+   *  the update-to-plan latency: from the push of the oldest update of each
+   *  vessel that no plan has used yet, to the call to planned.
+   */
+  class ContactTable {
+
+    public:
+
+      /// Counts of the updates ingested, and their latency.
+      struct Metrics {
+        std::uint64_t updates;        ///< updates ingested
+        std::uint64_t coalesced;      ///< updates that replaced one not planned yet
+        std::uint64_t planned;        ///< vessel updates planned (one per vessel and plan)
+        std::uint64_t latencySum;     ///< sum of the update-to-plan latencies, in nanoseconds
+        std::uint64_t latencyMax;     ///< largest update-to-plan latency, in nanoseconds
+      };
+
+      /// Class constructor (no vessels).
+      ContactTable() : metrics() {};
+
+      /// Drains up to maxBatch updates from the queue; returns how many.
+      std::size_t ingest(ContactQueue &queue, std::size_t maxBatch=SIZE_MAX);
+
+      /// Returns every vessel but the drone (by name), relative to the drone, for makePictures.
+      std::vector<RelativeVessel> relativeVessels(
+          const Vessel &drone        /** drone instance */,
+          const double margin=100    /** the radius of the region around each vessel we want to capture, in meters */
+          ) const;
+
+      /// Records the latency of the updates not planned yet: call when their plan is published.
+      void planned();
+
+      /// Returns the number of vessels.
+      inline std::size_t size() const {
+        return names.size();
+      };
+
+      /// Returns the number of vessels updated since the last call to planned.
+      inline std::size_t countPending() const {
+        return pendingSlots.size();
+      };
+
+      /// Returns the counts of the updates ingested, and their latency.
+      inline const Metrics &getMetrics() const {
+        return metrics;
+      };
+
+    private:
+
+      std::vector<std::uint32_t> slotOf;      ///< Slot of each name id (UINT32_MAX: none)
+      std::vector<std::uint32_t> names;       ///< Name id of each slot
+      std::vector<double> lat, lon;           ///< Position of each slot, in degrees
+      std::vector<std::int64_t> firstPending; ///< Push time of the oldest update not planned (-1: none)
+      std::vector<std::uint32_t> pendingSlots;///< Slots updated since the last plan
+      std::vector<ContactUpdate> batch;       ///< The updates being ingested
+      Metrics metrics;                        ///< See Metrics
+
+  };
+
+}
+
+#endif
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <iostream>
+#include <stdexcept>
+#include "vesselIO.h"
+
+// Converts a vessel snapshot between the text and the binary formats: a text
+// input is written as binary, a binary input as text.
+int main(int argc, char **argv) {
+
+  if (argc != 3) {
+    std::cerr << "usage: " << argv[0] << " INPUT OUTPUT\n"
+      "  converts a text snapshot (e.g. test1.dat) to binary, or a binary snapshot to text\n";
+    return 2;
+  }
+
+  try {
+    const gimbaledCamera::VesselSnapshot snapshot = gimbaledCamera::loadSnapshot(std::string(argv[1]));
+    if (snapshot.isMapped())
+      gimbaledCamera::saveSnapshotText(snapshot, argv[2]);
+    else
+      gimbaledCamera::saveSnapshotBinary(snapshot, argv[2]);
+    std::cout << snapshot.size() << " vessels written to " << argv[2] 
+      << (snapshot.isMapped() ? " (text)" : " (binary)") << std::endl;
+  } catch (const std::exception &e) {
+    std::cerr << argv[0] << ": " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <new>
+#include "frameArena.h"
+
+namespace gimbaledCamera {
+
+  // Class constructor for FrameArena
+  FrameArena::FrameArena(std::size_t bytes) 
+    : buffer(new std::byte[bytes ? bytes : 1]), size(bytes ? bytes : 1) {
+    arena.emplace(buffer.get(), size, &overflow);
+  }
+
+  // Release the frame; if it overflowed, grow the buffer to hold what it
+  // took (the overflow blocks are freed by release)
+  void FrameArena::reset() {
+    arena->release();
+    if (overflow.bytes > 0) {
+      size += overflow.bytes;
+      overflow.bytes = 0;
+      ++growths;
+      arena.reset();
+      buffer.reset(new std::byte[size]);
+      arena.emplace(buffer.get(), size, &overflow);
+    }
+  }
+
+  void *FrameArena::do_allocate(std::size_t bytes, std::size_t alignment) {
+    return arena->allocate(bytes, alignment);
+  }
+
+  // deallocation is a no-op until reset
+  void FrameArena::do_deallocate(void *p, std::size_t bytes, std::size_t alignment) {
+    arena->deallocate(p, bytes, alignment);
+  }
+
+  bool FrameArena::do_is_equal(const std::pmr::memory_resource &other) const noexcept {
+    return this == &other;
+  }
+
+  void *FrameArena::Overflow::do_allocate(std::size_t bytes, std::size_t alignment) {
+    this->bytes += bytes;
+    return ::operator new(bytes, std::align_val_t(alignment));
+  }
+
+  void FrameArena::Overflow::do_deallocate(void *p, std::size_t bytes, std::size_t alignment) {
+    ::operator delete(p, bytes, std::align_val_t(alignment));
+  }
+
+  bool FrameArena::Overflow::do_is_equal(const std::pmr::memory_resource &other) const noexcept {
+    return this == &other;
+  }
+
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+
+/** @file */
+
+namespace gimbaledCamera {
+
+  /** A per-frame arena: a monotonic memory resource over a buffer that is
+   *  kept from one frame to the next.
+   *
+   *  Allocations bump a pointer into the buffer and deallocations are free;
+   *  everything is released at once by reset, between two frames.  A frame
+   *  that needs more than the buffer gets the rest from the heap, and the
+   *  next reset grows the buffer to hold it, so a loop whose frames do not
+   *  grow soon makes no heap allocation at all.  Not thread-safe: use one
+   *  arena per planning thread.
+   */
+  class FrameArena : public std::pmr::memory_resource {
+
+    public:
+
+      /// Class constructor.
+      explicit FrameArena(
+          std::size_t bytes=65536 /** the initial size of the buffer */
+          );
+
+      FrameArena(const FrameArena &) = delete;
+      FrameArena &operator=(const FrameArena &) = delete;
+
+      /// Releases everything allocated since the last reset, growing the
+      /// buffer if the frame did not fit in it.
+      void reset();
+
+      /// Returns the size of the buffer, in bytes.
+      inline std::size_t capacity() const { return size; };
+
+      /// Returns the number of times the buffer has grown.
+      inline std::size_t countGrowths() const { return growths; };
+
+    private:
+
+      /// Counts the bytes that frames take from the heap when the buffer is full.
+      class Overflow : public std::pmr::memory_resource {
+        public:
+          std::size_t bytes = 0;  ///< Bytes taken since the last reset
+        private:
+          void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+          void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override;
+          bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+      };
+
+      void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+      void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override;
+      bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+      std::unique_ptr<std::byte[]> buffer;                  ///< The memory of a frame
+      std::size_t size;                                     ///< Size of buffer, in bytes
+      std::size_t growths = 0;                              ///< Times buffer has grown
+      Overflow overflow;                                    ///< Where a frame goes when buffer is full
+      std::optional<std::pmr::monotonic_buffer_resource> arena; ///< Bumps through buffer, then overflow
+
+  };
+
+}
+
+#endif
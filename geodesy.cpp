@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+#include "geodesy.h"
+#include "geodesyKernels.h"
+
+namespace gimbaledCamera {
+
+  namespace {
+
+    // Scalar kernel: the same expressions as RelativeVessel::computeBearing
+    // and RelativeVessel::computeDistance, with the drone trig terms hoisted
+    void scalarKernel(
+        double droneLat, double droneLon, std::size_t n,
+        const double *latDeg, const double *lonDeg,
+        double *bearing, double *dist, double *bearingMargin,
+        double margin) {
+
+      const double cosD = cos(droneLat),
+                   sinD = sin(droneLat);
+      const double rad  = 6371000;
+
+      for (std::size_t i = 0; i < n; ++i) {
+        const double lat  = latDeg[i]*M_PI/180.0;
+        const double lon  = lonDeg[i]*M_PI/180.0;
+        const double dLat = (lat - droneLat);
+        const double dLon = (lon - droneLon);
+        const double cosLat = cos(lat);
+
+        const double X = cosLat * sin(dLon);
+        const double Y = cosD*sin(lat) - sinD*cosLat*cos(dLon);
+        bearing[i] = atan2(Y, X);
+
+        const double a = pow(sin(dLat / 2), 2) + pow(sin(dLon / 2), 2) * cosD * cosLat;
+        const double c = 2 * asin(sqrt(a));
+        dist[i] = rad*c;
+
+        bearingMargin[i] = asin(margin/dist[i]);
+      }
+    }
+
+    // Returns the kernel for the given level, or nullptr if not available
+    detail::BatchKernel kernelFor(SimdLevel level) {
+      switch (level) {
+        case SimdLevel::Scalar:
+          return &scalarKernel;
+        case SimdLevel::AVX2:
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+          if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+            return detail::avx2BatchKernel();
+#endif
+          return nullptr;
+        case SimdLevel::AVX512:
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+          if (__builtin_cpu_supports("avx512f"))
+            return detail::avx512BatchKernel();
+#endif
+          return nullptr;
+        default:
+          return kernelFor(bestSimdLevel());
+      }
+    }
+
+  }
+
+  // Returns true if the given kernel was compiled in and is supported by the CPU
+  bool isSimdLevelAvailable(SimdLevel level) {
+    return level == SimdLevel::Auto || kernelFor(level) != nullptr;
+  }
+
+  // Returns the widest available kernel (checked once)
+  SimdLevel bestSimdLevel() {
+    static const SimdLevel best = 
+        kernelFor(SimdLevel::AVX512) ? SimdLevel::AVX512 :
+        kernelFor(SimdLevel::AVX2)   ? SimdLevel::AVX2   : 
+                                       SimdLevel::Scalar;
+    return best;
+  }
+
+  // Compute bearing, distance and margin of a batch of vessels
+  void computeRelativeBatch(
+      const Vessel &drone,
+      std::size_t n,
+      const double *lat,
+      const double *lon,
+      double *bearing,
+      double *dist,
+      double *bearingMargin,
+      const double margin,
+      SimdLevel level) {
+
+    detail::BatchKernel kernel = kernelFor(level);
+    if (kernel == nullptr)
+      kernel = &scalarKernel;
+
+    kernel(drone.getLat(), drone.getLon(), n, lat, lon, bearing, dist, bearingMargin, margin);
+  }
+
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstddef>
+#include "gimbaledCamera.h"
+
+#ifndef GEODESY_H
+#define GEODESY_H
+
+/** @file */
+
+namespace gimbaledCamera {
+
+  /** The instruction set used by computeRelativeBatch.
+   *  Auto picks the widest kernel supported by both the build and the CPU.
+   */
+  enum class SimdLevel {
+    Auto,   ///< widest available kernel
+    Scalar, ///< libm, identical to RelativeVessel::computeBearing/computeDistance
+    AVX2,   ///< 4 vessels per iteration (x86-64 with AVX2 and FMA)
+    AVX512  ///< 8 vessels per iteration (x86-64 with AVX-512F)
+  };
+
+  /// Returns true if the given kernel was compiled in and is supported by the CPU.
+  bool isSimdLevelAvailable(SimdLevel level);
+
+  /// Returns the kernel used by computeRelativeBatch when SimdLevel::Auto is requested.
+  SimdLevel bestSimdLevel();
+
+  /** Computes bearing, distance and bearing margin of n vessels relative to
+   *  the drone in a single pass.
+   *
+   *  Positions are passed in structure-of-arrays layout.  The drone trig terms
+   *  are computed once for the whole batch, and the vector kernels use
+   *  polynomial sin/cos/atan2/asin approximations accurate to a few ulp, so
+   *  results agree with a RelativeVessel built from the same position to
+   *  well below a millimeter.  Results do not depend on the position of a
+   *  vessel within the batch.
+   */
+  void computeRelativeBatch(
+      const Vessel &drone        /** drone instance */,
+      std::size_t   n            /** number of vessels */,
+      const double *lat          /** vessel latitudes, in degrees */,
+      const double *lon          /** vessel longitudes, in degrees */,
+      double       *bearing      /** output: bearings, in radians [-pi, +pi], zero is east */,
+      double       *dist         /** output: distances, in meters */,
+      double       *bearingMargin/** output: asin(margin/distance), in radians */,
+      const double  margin=100   /** the radius of the region around each vessel we want to capture, in meters */,
+      SimdLevel     level=SimdLevel::Auto /** the kernel to use; falls back to Scalar if not available */
+      );
+
+}
+
+#endif
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Compiled with -mavx512f (see makefile).  Only geodesyKernels.h may be
+// included here: inline functions from other headers would be emitted with
+// AVX-512 instructions and could be picked by the linker for other callers.
+
+#include "geodesyKernels.h"
+
+#if defined(__AVX512F__)
+
+// avx512fintrin.h from GCC 12 triggers a false positive on _mm512_undefined_pd at -O2
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+#include <immintrin.h>
+
+namespace {
+
+  // Eight doubles in an AVX-512 register.
+  struct Vec {
+    typedef __mmask8 Mask;
+    static const std::size_t width = 8;
+
+    __m512d v;
+
+    Vec() {}
+    Vec(const __m512d x) : v(x) {}
+    explicit Vec(const double x) : v(_mm512_set1_pd(x)) {}
+
+    static Vec load(const double *p) { return _mm512_loadu_pd(p); }
+    void store(double *p) const { _mm512_storeu_pd(p, v); }
+
+    friend Vec operator+(const Vec a, const Vec b) { return _mm512_add_pd(a.v, b.v); }
+    friend Vec operator-(const Vec a, const Vec b) { return _mm512_sub_pd(a.v, b.v); }
+    friend Vec operator*(const Vec a, const Vec b) { return _mm512_mul_pd(a.v, b.v); }
+    friend Vec operator/(const Vec a, const Vec b) { return _mm512_div_pd(a.v, b.v); }
+
+    static Vec fmadd (const Vec a, const Vec b, const Vec c) { return _mm512_fmadd_pd (a.v, b.v, c.v); }
+    static Vec fnmadd(const Vec a, const Vec b, const Vec c) { return _mm512_fnmadd_pd(a.v, b.v, c.v); }
+    static Vec sqrt (const Vec a) { return _mm512_sqrt_pd(a.v); }
+    static Vec abs  (const Vec a) { return _mm512_abs_pd(a.v); }
+    static Vec min  (const Vec a, const Vec b) { return _mm512_min_pd(a.v, b.v); }
+    static Vec max  (const Vec a, const Vec b) { return _mm512_max_pd(a.v, b.v); }
+    static Vec round(const Vec a) { return _mm512_roundscale_pd(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    static Vec floor(const Vec a) { return _mm512_roundscale_pd(a.v, _MM_FROUND_TO_NEG_INF     | _MM_FROUND_NO_EXC); }
+
+    static Mask lt   (const Vec a, const Vec b) { return _mm512_cmp_pd_mask(a.v, b.v, _CMP_LT_OQ); }
+    static Mask gt   (const Vec a, const Vec b) { return _mm512_cmp_pd_mask(a.v, b.v, _CMP_GT_OQ); }
+    static Mask eq   (const Vec a, const Vec b) { return _mm512_cmp_pd_mask(a.v, b.v, _CMP_EQ_OQ); }
+    static Mask unord(const Vec a, const Vec b) { return _mm512_cmp_pd_mask(a.v, b.v, _CMP_UNORD_Q); }
+    static Mask lor  (const Mask a, const Mask b) { return a | b; }
+
+    // a where m is set, b elsewhere
+    static Vec select(const Mask m, const Vec a, const Vec b) { return _mm512_mask_blend_pd(m, b.v, a.v); }
+  };
+
+  void kernel(
+      double droneLat, double droneLon, std::size_t n,
+      const double *lat, const double *lon,
+      double *bearing, double *dist, double *bearingMargin,
+      double margin) {
+    gimbaledCamera::detail::relativeBatch<Vec>(
+        droneLat, droneLon, n, lat, lon, bearing, dist, bearingMargin, margin);
+  }
+
+}
+
+namespace gimbaledCamera {
+  namespace detail {
+    BatchKernel avx512BatchKernel() { return &kernel; }
+  }
+}
+
+#else
+
+namespace gimbaledCamera {
+  namespace detail {
+    BatchKernel avx512BatchKernel() { return nullptr; }
+  }
+}
+
+#endif
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstddef>
+#include <cmath>
+
+#ifndef GEODESYKERNELS_H
+#define GEODESYKERNELS_H
+
+/** @file
+ *  Vector math kernels shared by the SIMD translation units of
+ *  computeRelativeBatch.
+ *
+ *  This header is internal: it is included by translation units compiled with
+ *  different instruction sets, so it must only contain templates over the
+ *  vector type V (which each translation unit defines in an anonymous
+ *  namespace) and plain declarations.  V provides the arithmetic operators and
+ *  the static members load, store, fmadd, fnmadd, sqrt, abs, min, max, round,
+ *  floor, lt, gt, eq, unord, lor and select.
+ */
+
+namespace gimbaledCamera {
+  namespace detail {
+
+    /// Signature shared by the scalar and vector batch kernels.
+    typedef void (*BatchKernel)(
+        double droneLat, double droneLon, std::size_t n,
+        const double *lat, const double *lon,
+        double *bearing, double *dist, double *bearingMargin,
+        double margin);
+
+    BatchKernel avx2BatchKernel();   ///< nullptr unless geodesyAvx2.cpp was built with AVX2 and FMA
+    BatchKernel avx512BatchKernel(); ///< nullptr unless geodesyAvx512.cpp was built with AVX-512F
+
+    /// Computes sin(x) and cos(x) (Cephes coefficients, reduced to [-pi/4, pi/4]).
+    template<class V> inline void vsincos(const V x, V &s, V &c) {
+      // Cody-Waite split of pi/2
+      const double PIO2_1 = 1.57079625129699707031e+00,
+                   PIO2_2 = 7.54978941586159635335e-08,
+                   PIO2_3 = 5.39030285815811905290e-15;
+
+      const V k = V::round(x * V(2/M_PI));                 // nearest multiple of pi/2
+      V r = V::fnmadd(k, V(PIO2_1), x);
+      r = V::fnmadd(k, V(PIO2_2), r);
+      r = V::fnmadd(k, V(PIO2_3), r);
+      const V z = r*r;
+
+      V ps = V(1.58962301576546568060e-10);
+      ps = V::fmadd(ps, z, V(-2.50507477628578072866e-8));
+      ps = V::fmadd(ps, z, V( 2.75573136213857245213e-6));
+      ps = V::fmadd(ps, z, V(-1.98412698295895385996e-4));
+      ps = V::fmadd(ps, z, V( 8.33333333332211858878e-3));
+      ps = V::fmadd(ps, z, V(-1.66666666666666307295e-1));
+      const V sr = V::fmadd(r*z, ps, r);
+
+      V pc = V(-1.13585365213876817300e-11);
+      pc = V::fmadd(pc, z, V( 2.08757008419747316778e-9));
+      pc = V::fmadd(pc, z, V(-2.75573141792967388112e-7));
+      pc = V::fmadd(pc, z, V( 2.48015872888517045348e-5));
+      pc = V::fmadd(pc, z, V(-1.38888888888730564116e-3));
+      pc = V::fmadd(pc, z, V( 4.16666666666665929218e-2));
+      const V cr = V::fmadd(z*z, pc, V::fnmadd(V(.5), z, V(1.)));
+
+      // quadrant q in {0,1,2,3}
+      const V q = k - V(4.)*V::floor(k*V(.25));
+      const typename V::Mask odd     = V::lor(V::eq(q, V(1.)), V::eq(q, V(3.)));
+      const typename V::Mask sinNeg  = V::gt(q, V(1.5));
+      const typename V::Mask cosNeg  = V::lor(V::eq(q, V(1.)), V::eq(q, V(2.)));
+      const V s0 = V::select(odd, cr, sr),
+              c0 = V::select(odd, sr, cr);
+      s = V::select(sinNeg, V(0.)-s0, s0);
+      c = V::select(cosNeg, V(0.)-c0, c0);
+    }
+
+    /// Computes atan2(y, x) (Cephes rational approximation on [0, 0.66]).
+    template<class V> inline V vatan2(const V y, const V x) {
+      const double MOREBITS = 6.123233995736765886130e-17;
+
+      const V ax = V::abs(x), ay = V::abs(y);
+      const V mx = V::max(ax, ay), mn = V::min(ax, ay);
+      const V t  = V::select(V::eq(mx, V(0.)), V(0.), mn/mx); // t in [0, 1]
+
+      const typename V::Mask big = V::gt(t, V(.66));
+      const V tt = V::select(big, (t-V(1.))/(t+V(1.)), t);
+      const V z  = tt*tt;
+
+      V p = V(-8.750608600031904122785e-1);
+      p = V::fmadd(p, z, V(-1.615753718733365076637e1));
+      p = V::fmadd(p, z, V(-7.500855792314704667340e1));
+      p = V::fmadd(p, z, V(-1.228866684490136173410e2));
+      p = V::fmadd(p, z, V(-6.485021904942025371773e1));
+      V q = z + V(2.485846490142306297962e1);
+      q = V::fmadd(q, z, V(1.650270098316988542046e2));
+      q = V::fmadd(q, z, V(4.328810604912902668951e2));
+      q = V::fmadd(q, z, V(4.853903996359136964868e2));
+      q = V::fmadd(q, z, V(1.945506571482613964425e2));
+
+      V a = V::fmadd(tt*z, p/q, tt);
+      a = a + V::select(big, V(M_PI/4 + .5*MOREBITS), V(0.));
+      a = V::select(V::gt(ay, ax), V(M_PI/2) - a, a);
+      a = V::select(V::lt(x, V(0.)), V(M_PI) - a, a);
+      a = V::select(V::lt(y, V(0.)), V(0.) - a, a);
+      return V::select(V::unord(x, y), x + y, a);          // propagate NaN
+    }
+
+    /// Computes asin(x) as atan2(x, sqrt(1-x^2)); NaN outside [-1, 1].
+    template<class V> inline V vasin(const V x) {
+      return vatan2(x, V::sqrt((V(1.)-x)*(V(1.)+x)));
+    }
+
+    /// Bearing, distance and margin of one vector of vessels.
+    template<class V> inline void relativeVector(
+        const V droneLat, const V droneLon, const V cosD, const V sinD,
+        const V latDeg, const V lonDeg, const V margin,
+        V &bearing, V &dist, V &bearingMargin) {
+
+      const V lat = latDeg*V(M_PI)/V(180.0),
+              lon = lonDeg*V(M_PI)/V(180.0);
+      const V dLat = lat - droneLat,
+              dLon = lon - droneLon;
+
+      V sinLat, cosLat, sinDLon, cosDLon, sinHalfDLat, sinHalfDLon, unused;
+      vsincos(lat,         sinLat,      cosLat);
+      vsincos(dLon,        sinDLon,     cosDLon);
+      vsincos(dLat*V(.5),  sinHalfDLat, unused);
+      vsincos(dLon*V(.5),  sinHalfDLon, unused);
+
+      // bearing, as in RelativeVessel::computeBearing
+      const V X = cosLat*sinDLon;
+      const V Y = cosD*sinLat - sinD*cosLat*cosDLon;
+      bearing = vatan2(Y, X);
+
+      // haversine distance, as in RelativeVessel::computeDistance
+      V a = sinHalfDLat*sinHalfDLat + sinHalfDLon*sinHalfDLon*cosD*cosLat;
+      a = V::min(a, V(1.));
+      const V c = V(2.)*vatan2(V::sqrt(a), V::sqrt(V(1.)-a));
+      dist = V(6371000.)*c;
+
+      bearingMargin = vasin(margin/dist);
+    }
+
+    /// Runs relativeVector over a whole batch, padding the tail to a full vector.
+    template<class V> void relativeBatch(
+        double droneLat, double droneLon, std::size_t n,
+        const double *lat, const double *lon,
+        double *bearing, double *dist, double *bearingMargin,
+        double margin) {
+
+      const V dLat0(droneLat), dLon0(droneLon), m(margin);
+      const V cosD(std::cos(droneLat)), sinD(std::sin(droneLat));
+      const std::size_t W = V::width;
+
+      std::size_t i = 0;
+      for (; i+W <= n; i += W) {
+        V b, d, bm;
+        relativeVector(dLat0, dLon0, cosD, sinD, V::load(lat+i), V::load(lon+i), m, b, d, bm);
+        b.store(bearing+i);
+        d.store(dist+i);
+        bm.store(bearingMargin+i);
+      }
+
+      if (i < n) {   // the tail goes through the same kernel, so results do not depend on i
+        double latT[V::width], lonT[V::width], bT[V::width], dT[V::width], bmT[V::width];
+        for (std::size_t j = 0; j < W; ++j) {
+          latT[j] = (i+j < n) ? lat[i+j] : lat[i];
+          lonT[j] = (i+j < n) ? lon[i+j] : lon[i];
+        }
+        V b, d, bm;
+        relativeVector(dLat0, dLon0, cosD, sinD, V::load(latT), V::load(lonT), m, b, d, bm);
+        b.store(bT);
+        d.store(dT);
+        bm.store(bmT);
+        for (std::size_t j = 0; i+j < n; ++j) {
+          bearing[i+j]       = bT[j];
+          dist[i+j]          = dT[j];
+          bearingMargin[i+j] = bmT[j];
+        }
+      }
+    }
+
+  }
+}
+
+#endif
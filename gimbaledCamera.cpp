@@ -22,7 +22,12 @@
 
 #include <iostream>
 #include <cmath>
+#include <algorithm>
+#include <memory_resource>
+#include <utility>
+#include <vector>
 #include "gimbaledCamera.h"
+#include "stats.h"
 
 namespace gimbaledCamera {
 
@@ -30,60 +35,82 @@ namespace gimbaledCamera {
   Vessel::Vessel(
       const double latin, 
       const double lonin, 
-      const std::string namein) {
+      const std::string &namein,
+      const double coursein,
+      const double speedin) {
     lat = latin*M_PI/180.0;
     lon = lonin*M_PI/180.0;
+    course = coursein*M_PI/180.0;
+    speed = speedin;
+    name = NameTable::global().intern(namein);
+    row = 0;
+  }
+
+  // Class constructor for Vessel, from an interned name
+  Vessel::Vessel(
+      const double latin, 
+      const double lonin, 
+      const std::uint32_t namein,
+      const double coursein,
+      const double speedin) {
+    lat = latin*M_PI/180.0;
+    lon = lonin*M_PI/180.0;
+    course = coursein*M_PI/180.0;
+    speed = speedin;
     name = namein;
+    row = 0;
   }
 
   // Class constructor for RelativeVessel 
   RelativeVessel::RelativeVessel(
       const double latin, 
       const double lonin, 
-      const std::string namein, 
-      const Vessel drone, 
+      const std::string &namein, 
+      const Vessel &drone, 
       const double margin
       ) : Vessel(latin, lonin, namein) 
   {
+    GIMBALEDCAMERA_TIME(RelativeVessel);
     bearing = computeBearing (drone);
     dist    = computeDistance(drone);
     bearingMargin = asin(margin/dist);
   }
 
-  // Compute vessel bearing relative to drone
-  double RelativeVessel::computeBearing(const Vessel drone) const {
-    const double dLon = (lon - drone.getLon()); 
-
-    const double X = cos(lat) * sin(dLon);
-    const double Y = cos(drone.getLat())*sin(lat) 
-                   - sin(drone.getLat())*cos(lat)*cos(dLon);
-    return atan2(Y, X);
+  // Class constructor for RelativeVessel, from precomputed values
+  RelativeVessel::RelativeVessel(
+      const double latin, 
+      const double lonin, 
+      const std::string &namein, 
+      const double bearingin, 
+      const double distin, 
+      const double bearingMarginin
+      ) : Vessel(latin, lonin, namein), 
+          bearing(bearingin), dist(distin), bearingMargin(bearingMarginin)
+  {
+    GIMBALEDCAMERA_TIME(RelativeVessel);
   }
 
-  // Compute vessel distance relative to drone using Haversine distance 
-  double RelativeVessel::computeDistance(const Vessel drone) const {
-    const double dLat = (lat - drone.getLat());
-    const double dLon = (lon - drone.getLon()); 
-    
-    const double a = pow(sin(dLat / 2), 2) + pow(sin(dLon / 2), 2) * cos(drone.getLat()) * cos(lat);
-    const double rad = 6371000;
-    const double c = 2 * asin(sqrt(a));
-    return rad*c;
+  // Class constructor for RelativeVessel, from precomputed values and an interned name
+  RelativeVessel::RelativeVessel(
+      const double latin, 
+      const double lonin, 
+      const std::uint32_t namein, 
+      const double bearingin, 
+      const double distin, 
+      const double bearingMarginin
+      ) : Vessel(latin, lonin, namein), 
+          bearing(bearingin), dist(distin), bearingMargin(bearingMarginin)
+  {
+    GIMBALEDCAMERA_TIME(RelativeVessel);
   }
 
-  // Class constructor for Picture
+  // Class constructor for Picture: the camera angles and the extent are
+  // computed here, once
   Picture::Picture(
-      double FOVin,
-      std::list<RelativeVessel>::iterator begin,
-      std::list<RelativeVessel>::iterator end
-      ) {
-    FOV = FOVin;
-    vessels.assign(begin,end);
-  }
-
-  // Compute the camera angle (in degrees) as the average point between
-  // the leftmost and rightmost vessel in the picture.
-  double Picture::getCameraAngleDeg(char referenceSystem) const { 
+      double FOV,
+      const RelativeVessel *begin,
+      const RelativeVessel *end
+      ) : vessels(begin, end) {
     const double bearing1 = vessels.front().getBearing(),
                  bearing2 = vessels.back().getBearing();
 
@@ -92,62 +119,260 @@ namespace gimbaledCamera {
 	                       b = std::polar(1., bearing2);
     const std::complex<double> mean = (a+b)/2.;
 
-    if (referenceSystem == 'N')
-      return fmod(450-std::arg(mean)*180/M_PI, 360.);
-    else if (referenceSystem == 'C')
-      return fmod(450-(std::arg(mean)+FOV/2.)*180/M_PI, 360.);
-    else // defaults to E
-      return std::arg(mean)*180/M_PI; 
+    angle[int(Frame::East)]   = std::arg(mean)*180/M_PI;
+    angle[int(Frame::North)]  = fmod(450-std::arg(mean)*180/M_PI, 360.);
+    angle[int(Frame::Camera)] = fmod(450-(std::arg(mean)+FOV/2.)*180/M_PI, 360.);
+    maxAngularDistance        = std::arg(b/a)*180/M_PI;
   }
 
-  // Compute the maximum angular distance (in degrees) between the
-  // leftmost and rightmost vessel in the picture.
-  double Picture::getMaxAngularDistanceDeg() const {
-    const double bearing1 = vessels.front().getBearing(),
-	         bearing2 = vessels.back().getBearing();
+  // Copy a plan, pointing the pictures to the new buffer (their angles are
+  // kept, as pictures may have been taken with another FOV than the plan's)
+  Plan::Plan(const Plan &other) : FOV(other.FOV), vessels(other.vessels), pictures(other.pictures) {
+    const RelativeVessel *base = other.vessels.data();
+    for (auto & picture : pictures)
+      picture.vessels = VesselSpan(vessels.data() + (picture.vessels.begin() - base), 
+                                   vessels.data() + (picture.vessels.end()   - base));
+  }
 
-    // we use complex numbers to take into account how angles wrap around
-    const std::complex<double> a = std::polar(1., bearing1),
-               	               b = std::polar(1., bearing2);
-    const std::complex<double> maxAngularDistance = b/a;
+  // Copy-assign a plan, pointing the pictures to the new buffer
+  Plan &Plan::operator=(const Plan &other) {
+    if (this != &other) {
+      Plan copy(other);
+      *this = std::move(copy);
+    }
+    return *this;
+  }
+
+  // Class constructor for Plan::Builder: takes ownership of the sorted vessels
+  Plan::Builder::Builder(double FOV, std::vector<RelativeVessel> &&sorted) {
+    plan.FOV = FOV;
+    plan.vessels = std::move(sorted);
+  }
 
-    return std::arg(maxAngularDistance)*180/M_PI; 
+  // Class constructor for Plan::Builder: keeps the vessels of the plan
+  Plan::Builder::Builder(Plan &&old) : plan(std::move(old)) {
+    plan.pictures.clear();
+  }
+
+  // Class constructor for Plan::Builder: keeps the buffers of the plan only
+  Plan::Builder::Builder(double FOV, Plan &&recycled) : plan(std::move(recycled)) {
+    plan.FOV = FOV;
+    plan.vessels.clear();
+    plan.pictures.clear();
+  }
+
+  // Rotate the buffer so that vessel first comes first.  Only valid before
+  // pictures are added.
+  void Plan::Builder::rotate(std::size_t first) {
+    std::rotate(plan.vessels.begin(), plan.vessels.begin() + first, plan.vessels.end());
+  }
+
+  void Plan::Builder::reserve(std::size_t count) {
+    plan.pictures.reserve(count);
+  }
+
+  // Add the picture made of vessels [begin, end) of the buffer
+  void Plan::Builder::addPicture(std::size_t begin, std::size_t end) {
+    addPicture(begin, end, plan.FOV);
+  }
+
+  // Add the picture made of vessels [begin, end) of the buffer, taken with
+  // its own FOV
+  void Plan::Builder::addPicture(std::size_t begin, std::size_t end, double pictureFOV) {
+    plan.pictures.push_back(Picture(pictureFOV, plan.vessels.data() + begin, plan.vessels.data() + end));
+  }
+
+  // Add the pictures starting at the given offsets into the sorted buffer,
+  // merging the first and last picture if they fit in the FOV
+  void Plan::Builder::addPictures(const std::size_t *starts, std::size_t count) {
+
+    const std::vector<RelativeVessel> &vessels = plan.vessels;
+    const std::size_t n = vessels.size();
+    if (count == 0)
+      return;
+
+    bool merge = false;
+    std::size_t shift = 0;
+    {
+      GIMBALEDCAMERA_TIME(Merge);
+
+      // check if the first and last picture can be merged
+      if (count > 1) {
+        const RelativeVessel &vessel1 = vessels[starts[1]-1];       // last bearing of first picture
+        const RelativeVessel &vessel2 = vessels[starts[count-1]];   // first bearing of last picture
+        double dBearing =  vessel1.getBearing() + vessel1.getMargin() + (2*M_PI-vessel2.getBearing()) + vessel2.getMargin();
+        merge = dBearing < plan.FOV;
+      }
+
+      // if so, rotate the buffer so that the merged picture is contiguous
+      shift = merge ? n - starts[count-1] : 0;
+      if (merge)
+        rotate(starts[count-1]);
+    }
+    GIMBALEDCAMERA_COUNT(Merges, merge);
+    GIMBALEDCAMERA_COUNT(Pictures, merge ? count-1 : count);
+
+    reserve(merge ? count-1 : count);
+    for (std::size_t k = 0; k < (merge ? count-1 : count); ++k) {
+      const std::size_t begin = (k == 0) ? 0 : starts[k] + shift;
+      const std::size_t end   = (k+1 < count) ? starts[k+1] + shift : n;
+      addPicture(begin, end);
+    }
+  }
+
+  // Bin the sorted vessels in FOV-wide bins
+  void Plan::Builder::addBins() {
+
+    // count the pictures first, so that starts is allocated once
+    std::vector<std::size_t> starts;                                         // the first vessel of each picture
+    {
+      GIMBALEDCAMERA_TIME(Partition);
+      starts.resize(partition(plan.FOV, plan.vessels, nullptr));
+      partition(plan.FOV, plan.vessels, starts.data());
+    }
+    addPictures(starts.data(), starts.size());
   }
 
   // Produce a list of pictures by binning the vessels if FOV-wide bins 
-  std::list<Picture> makePictures(double FOV, std::list<RelativeVessel> vessels) {
+  Plan makePictures(double FOV, std::vector<RelativeVessel> vessels) {
+
+    FOV *= M_PI/180;                                                         // convert field of view from degrees to radians
+    GIMBALEDCAMERA_COUNT(Vessels, vessels.size());
+    {
+      GIMBALEDCAMERA_TIME(Sort);
+      std::stable_sort(vessels.begin(), vessels.end(), gimbaledCamera::sortByBearing); // sort the vessels by bearing
+    }
+    Plan::Builder builder(FOV, std::move(vessels));
+    builder.addBins();
+    return builder.build();
+  }
 
-    FOV *= M_PI/180;                             // convert field of view from degrees to radians
-    vessels.sort(gimbaledCamera::sortByBearing); // sort the vessels by bearing
+  // Produce the pictures of makePictures into an existing plan, reusing its
+  // buffers, with the scratch memory taken from the given resource
+  void makePictures(double FOV, const std::vector<RelativeVessel> &vessels, Plan &plan, std::pmr::memory_resource &scratch) {
 
-    std::list<gimbaledCamera::Picture> pictures;                                     // create list of pictures
-    std::list<gimbaledCamera::RelativeVessel>::iterator refVessel = vessels.begin(); // the first reference vessel
+    FOV *= M_PI/180;                                                         // convert field of view from degrees to radians
+    GIMBALEDCAMERA_COUNT(Vessels, vessels.size());
+    const std::size_t n = vessels.size();
+    Plan::Builder builder(FOV, std::move(plan));
+    std::vector<RelativeVessel> &sorted = builder.getVessels();
+    sorted.reserve(n);
+    {
+      // sort (bearing, index) pairs, the index breaking ties as stable_sort
+      // does, and copy the vessels into the plan in that order
+      GIMBALEDCAMERA_TIME(Sort);
+      std::pmr::vector<std::pair<double, std::size_t>> order(&scratch);
+      order.reserve(n);
+      for (std::size_t i = 0; i < n; ++i)
+        order.push_back(std::make_pair(vessels[i].getBearing(), i));
+      std::sort(order.begin(), order.end());
+      for (auto & entry : order)
+        sorted.push_back(vessels[entry.second]);
+    }
 
-    for (auto ptr = vessels.begin(); ptr!=vessels.end(); ++ptr) {
+    std::pmr::vector<std::size_t> starts(&scratch);                          // the first vessel of each picture
+    {
+      GIMBALEDCAMERA_TIME(Partition);
+      starts.resize(Plan::Builder::partition(FOV, sorted, nullptr));
+      Plan::Builder::partition(FOV, sorted, starts.data());
+    }
+    builder.addPictures(starts.data(), starts.size());
+    plan = builder.build();
+  }
 
-      // compute the delta in bearing, including the marings
-      double dBearing = ( ptr->getBearing()       + ptr->getMargin()       ) 
-                      - ( refVessel->getBearing() - refVessel->getMargin() ); 
+  // Produce the minimum number of pictures by trying every starting vessel
+  Plan makeMinimalPictures(double FOV, std::vector<RelativeVessel> vessels) {
 
-      if (dBearing >= FOV) {                                  // if bearings' difference is greater than FOV
-        gimbaledCamera::Picture picture(FOV,refVessel,ptr--); // ... create a new picture and assign vessels between refVessels and ptr--
-        ++ptr;                                                // ... restore ptr
-        pictures.push_back(picture);                          // ... add the picture to the picture list
-        refVessel = ptr;                                      // ... and update the reference Vessel
+    FOV *= M_PI/180;                                                         // convert field of view from degrees to radians
+    GIMBALEDCAMERA_COUNT(Vessels, vessels.size());
+    {
+      GIMBALEDCAMERA_TIME(Sort);
+      std::stable_sort(vessels.begin(), vessels.end(), gimbaledCamera::sortByBearing); // sort the vessels by bearing
+    }
+
+    const std::size_t n = vessels.size();
+    if (n == 0)
+      return Plan::Builder(FOV, std::move(vessels)).build();
+
+    GIMBALEDCAMERA_TIME(Partition);
+
+    // the left and right edges of the vessels on the circle unrolled twice
+    // (index i+n is vessel i, one turn later)
+    std::vector<double> left(2*n), right(2*n);
+    for (std::size_t i = 0; i < 2*n; ++i) {
+      const double turn = (i < n) ? 0 : 2*M_PI;
+      left[i]  = vessels[i%n].getBearing() - vessels[i%n].getMargin() + turn;
+      right[i] = vessels[i%n].getBearing() + vessels[i%n].getMargin() + turn;
+    }
+
+    // next[i] is the first vessel left out of the widest picture starting at
+    // vessel i (a picture never holds more than n vessels).  Pictures grow
+    // with two pointers; two monotonic queues (each vessel enters once, so a
+    // flat buffer with head and tail suffices) keep the running min of left
+    // and max of right.
+    std::vector<std::size_t> next(2*n+1, 2*n), queues(4*n);
+    std::size_t *minLeft = queues.data(), *maxRight = queues.data() + 2*n;
+    std::size_t minHead = 0, minTail = 0, maxHead = 0, maxTail = 0;
+    std::size_t j = 0;
+    for (std::size_t i = 0; i < 2*n; ++i) {
+      if (j <= i) {                               // a vessel wider than the FOV gets its own picture
+        j = i;
+        minHead = minTail;
+        maxHead = maxTail;
+      }
+      while (minHead < minTail && minLeft[minHead]  < i) ++minHead;
+      while (maxHead < maxTail && maxRight[maxHead] < i) ++maxHead;
+
+      for (; j < std::min(2*n, i+n); ++j) {
+        const double lo = (minHead < minTail) ? std::min(left[minLeft[minHead]],    left[j])  : left[j];
+        const double hi = (maxHead < maxTail) ? std::max(right[maxRight[maxHead]], right[j]) : right[j];
+        if (j > i && hi - lo >= FOV)
+          break;
+        while (minHead < minTail && left[minLeft[minTail-1]]   >= left[j])  --minTail;
+        while (maxHead < maxTail && right[maxRight[maxTail-1]] <= right[j]) --maxTail;
+        minLeft[minTail++]  = j;
+        maxRight[maxTail++] = j;
       }
+      next[i] = j;
+    }
+
+    // jump[k*(2n+1) + i] is the start of the picture 2^k pictures after the one starting at i
+    std::size_t levels = 1;
+    while ((std::size_t(1) << levels) < n)
+      ++levels;
+    std::vector<std::size_t> jump(levels*(2*n+1));
+    std::copy(next.begin(), next.end(), jump.begin());
+    for (std::size_t k = 1; k < levels; ++k) {
+      const std::size_t *prev = jump.data() + (k-1)*(2*n+1);
+      std::size_t *step = jump.data() + k*(2*n+1);
+      for (std::size_t i = 0; i <= 2*n; ++i)
+        step[i] = prev[prev[i]];
     }
-    gimbaledCamera::Picture picture(FOV,refVessel,vessels.end());; // then add the last picture to the list
-    pictures.push_back(picture);		            
-
-    // check if the first and last picture can be merged
-    RelativeVessel vessel1 = pictures.front().getVessels().back(); // last bearing of first picture
-    RelativeVessel vessel2 = pictures.back().getVessels().front(); // last bearing of last picture
-    double dBearing =  vessel1.getBearing() + vessel1.getMargin() + (2*M_PI-vessel2.getBearing()) + vessel2.getMargin();
-    if (dBearing < FOV) {
-      pictures.front().addVessels(pictures.back().getVessels());
-      pictures.pop_back();
+
+    // count the pictures needed to go once around the circle from each start
+    std::size_t bestStart = 0, bestCount = n+1;
+    for (std::size_t start = 0; start < n; ++start) {
+      std::size_t pos = start, count = 1;
+      for (std::size_t k = levels; k-- > 0; )
+        if (jump[k*(2*n+1) + pos] < start+n) {
+          pos    = jump[k*(2*n+1) + pos];
+          count += std::size_t(1) << k;
+        }
+      if (count < bestCount) {
+        bestCount = count;
+        bestStart = start;
+      }
     }
-    return pictures;
+
+    // greedily rebuild the pictures from the best start, which becomes the
+    // start of the buffer
+    Plan::Builder builder(FOV, std::move(vessels));
+    builder.rotate(bestStart);
+    GIMBALEDCAMERA_COUNT(Pictures, bestCount);
+    builder.reserve(bestCount);
+    for (std::size_t pos = bestStart; pos < bestStart+n; pos = next[pos])
+      builder.addPicture(pos - bestStart, std::min(next[pos], bestStart+n) - bestStart);
+    return builder.build();
   }
 
 }
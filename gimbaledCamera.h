@@ -23,8 +23,13 @@
 #include <iomanip>
 #include <cmath>
 #include <complex>
+#include <cstdint>
 #include <list>
+#include <memory_resource>
+#include <string>
 #include <vector>
+#include "nameTable.h"
+#include "precision.h"
 
 #ifndef GIMBALEDCAMERA_H
 #define GIMBALEDCAMERA_H
@@ -36,7 +41,9 @@
  * */
 namespace gimbaledCamera {
   /** A class describing a vessel.
-   *  Include its name, latitude and longitude.
+   *  Include its name, latitude and longitude, and its course and speed.
+   *  The name is interned in NameTable::global(), so a Vessel is 40 bytes
+   *  and copying it costs no allocation.
    */
   class Vessel {
 
@@ -46,7 +53,18 @@ namespace gimbaledCamera {
       Vessel(
           const double      /** vessel latitude, in degrees */, 
           const double      /** vessel longitude, in degrees */, 
-          const std::string /** vessel name */
+          const std::string & /** vessel name */,
+          const double=0    /** vessel course over ground, in degrees clockwise from North */,
+          const double=0    /** vessel speed over ground, in meters per second */
+          ); 
+
+      /// Class constructor, from the id of a name interned in NameTable::global().
+      Vessel(
+          const double      /** vessel latitude, in degrees */, 
+          const double      /** vessel longitude, in degrees */, 
+          const std::uint32_t /** vessel name id */,
+          const double=0    /** vessel course over ground, in degrees clockwise from North */,
+          const double=0    /** vessel speed over ground, in meters per second */
           ); 
 
       /// Returns the vessel latitude in radians.
@@ -70,12 +88,48 @@ namespace gimbaledCamera {
       };     
 
       /// Returns the vessel name.
-      inline std::string getName() const { 
+      inline const std::string &getName() const { 
+        return NameTable::global().lookup(name); 
+      };     
+
+      /// Returns the id of the vessel name in NameTable::global().
+      inline std::uint32_t getNameId() const { 
         return name; 
       };     
 
+      /// Returns the row of the vessel in the snapshot it was built from (0 by default).
+      inline std::uint32_t getRow() const { 
+        return row; 
+      };     
+
+      /// Sets the row of the vessel in the snapshot it was built from.
+      inline void setRow(const std::uint32_t rowin) { 
+        row = rowin; 
+      };     
+
+      /// Returns the vessel course, in radians clockwise from North.
+      inline double getCourse() const { 
+        return course; 
+      };     
+
+      /// Returns the vessel course, in degrees clockwise from North.
+      inline double getCourseDeg() const { 
+        return course*180/M_PI; 
+      };     
+
+      /// Returns the vessel speed, in meters per second.
+      inline double getSpeed() const { 
+        return speed; 
+      };     
+
+      /// Sets the vessel course (in degrees clockwise from North) and speed (in meters per second).
+      inline void setMotion(const double courseDeg, const double speedin) { 
+        course = courseDeg*M_PI/180; 
+        speed  = speedin; 
+      };     
+
       /// Overloads the << operator
-      friend std::ostream &operator<<(std::ostream &output, Vessel &v) { 
+      friend std::ostream &operator<<(std::ostream &output, const Vessel &v) { 
         output << std::fixed;
         output << "Vessel name: " << std::setw(15) 
                << std::left       << v.getName() << std::right
@@ -90,7 +144,10 @@ namespace gimbaledCamera {
 
       double lon;       ///< Vessel longitude, in radians
       double lat;	///< Vessel latitude, in radians
-      std::string name; ///< Vessel name
+      double course;    ///< Vessel course, in radians clockwise from North
+      double speed;     ///< Vessel speed, in meters per second
+      std::uint32_t name; ///< Vessel name, as an id in NameTable::global()
+      std::uint32_t row;  ///< Row of the vessel in its snapshot: maps planned vessels back to it even when names repeat
 
   };
 
@@ -105,11 +162,47 @@ namespace gimbaledCamera {
       RelativeVessel(
           const double      /** vessel latitude, in degrees */, 
           const double      /** vessel longitude, in degrees */, 
-          const std::string /** vessel name */, 
-          const Vessel      /** drone instance */,
+          const std::string & /** vessel name */, 
+          const Vessel &      /** drone instance */,
           const double=100  /** the radius of the region around lat, lon we want to capture, in meters */
           ); 
 
+      /** Class constructor, with the geodesy computed with precision policy P
+       *  (see precision.h).  The margin is inflated by P::maxAngularError.
+       */
+      template<class P> RelativeVessel(
+          const double latin          /** vessel latitude, in degrees */, 
+          const double lonin          /** vessel longitude, in degrees */, 
+          const std::string &namein   /** vessel name */, 
+          const Vessel &drone         /** drone instance */,
+          const double margin         /** the radius of the region around lat, lon we want to capture, in meters */,
+          P                           /** the precision policy, e.g. precision::Poly() */
+          ) : Vessel(latin, lonin, namein) {
+        precision::geometry<P>(drone.getLat(), drone.getLon(), lat, lon, bearing, dist);
+        bearingMargin = P::asin(margin/dist) + P::maxAngularError;
+      };
+
+      /// Class constructor, from a bearing, distance and margin computed
+      /// elsewhere (e.g. by computeRelativeBatch).
+      RelativeVessel(
+          const double      /** vessel latitude, in degrees */, 
+          const double      /** vessel longitude, in degrees */, 
+          const std::string & /** vessel name */, 
+          const double      /** bearing, in radians */,
+          const double      /** distance, in meters */,
+          const double      /** bearing margin, in radians */
+          ); 
+
+      /// Same as above, from the id of a name interned in NameTable::global().
+      RelativeVessel(
+          const double      /** vessel latitude, in degrees */, 
+          const double      /** vessel longitude, in degrees */, 
+          const std::uint32_t /** vessel name id */, 
+          const double      /** bearing, in radians */,
+          const double      /** distance, in meters */,
+          const double      /** bearing margin, in radians */
+          ); 
+
       /// Returns distance from reference vessel in meters.
       inline double getDistance() const { 
         return dist; 
@@ -136,11 +229,18 @@ namespace gimbaledCamera {
         return bearingMargin*180/M_PI; 
       };                    
       
-      double computeBearing(const Vessel) const;  ///< Compute vessel bearing relative to drone
-      double computeDistance(const Vessel) const ; ///< Compute vessel distance relative to drone using Haversine distance 
+      /// Compute vessel bearing relative to drone, with precision policy P.
+      template<class P=precision::Exact> inline double computeBearing(const Vessel &drone) const {
+        return precision::bearing<P>(drone.getLat(), drone.getLon(), lat, lon);
+      };
+
+      /// Compute vessel distance relative to drone using Haversine distance, with precision policy P.
+      template<class P=precision::Exact> inline double computeDistance(const Vessel &drone) const {
+        return precision::distance<P>(drone.getLat(), drone.getLon(), lat, lon);
+      };
 
       /// Overloads the << operator.
-      friend std::ostream &operator<<(std::ostream &output, RelativeVessel &v) {
+      friend std::ostream &operator<<(std::ostream &output, const RelativeVessel &v) {
         output << std::fixed;
         output << "Vessel name: " << std::setw(15) 
                << std::left << v.getName() << std::right
@@ -161,7 +261,7 @@ namespace gimbaledCamera {
       double dist;           ///< distance, in meters
       double bearingMargin;  ///< asin(100./distance): used to make sure to capture an area 100 m around the target vessel
 
-      friend bool sortByBearing(RelativeVessel a, RelativeVessel b);
+      friend bool sortByBearing(const RelativeVessel &a, const RelativeVessel &b);
 
   };
 
@@ -169,13 +269,60 @@ namespace gimbaledCamera {
    *  than the bearing of b.
    *  Used for sorting a list of vessels by bearing.
    */
-  inline bool sortByBearing(RelativeVessel a, RelativeVessel b) { 
+  inline bool sortByBearing(const RelativeVessel &a, const RelativeVessel &b) { 
     return (a.bearing < b.bearing); 
   }
 
+  /** A contiguous range of vessels, sorted by bearing.
+   *  Does not own the vessels: it points into the buffer of a Plan.
+   */
+  class VesselSpan {
+
+    public:
+
+      typedef const RelativeVessel *const_iterator;
+
+      /// Class constructor.
+      VesselSpan(
+          const RelativeVessel *beginin=nullptr /** first vessel */,
+          const RelativeVessel *endin=nullptr   /** one past the last vessel */
+          ) : first(beginin), last(endin) {};
+
+      inline const_iterator begin() const { return first; };
+      inline const_iterator end()   const { return last;  };
+
+      /// Returns the number of vessels.
+      inline std::size_t size() const { return last - first; };
+
+      /// Returns true if there are no vessels.
+      inline bool empty() const { return first == last; };
+
+      /// Returns the vessel with the smallest bearing (counterclockwise first).
+      inline const RelativeVessel &front() const { return *first; };
+
+      /// Returns the vessel with the largest bearing (counterclockwise last).
+      inline const RelativeVessel &back() const { return *(last-1); };
+
+      inline const RelativeVessel &operator[](std::size_t i) const { return first[i]; };
+
+    private:
+
+      const RelativeVessel *first; ///< First vessel
+      const RelativeVessel *last;  ///< One past the last vessel
+
+  };
+
+  /// The reference systems of camera angles.
+  enum class Frame {
+    East   = 0, ///< counterclockwise, East=0 ('E')
+    North  = 1, ///< clockwise, North=0 ('N')
+    Camera = 2  ///< clockwise, North=0, from the left side of the camera frame ('C'): the trigger angle
+  };
+
   /** A class describing a picture. 
-   *  Contains a list of vessels.
-   *  Can compute the angle to which the camera should be pointed to.
+   *  Refers to a contiguous range of vessels in the buffer of a Plan.
+   *  The camera angles and the angular extent are computed once, when the
+   *  picture is made, so reading them costs no trigonometry.
    */
   class Picture {
 
@@ -183,28 +330,39 @@ namespace gimbaledCamera {
 
       /// Class constructor.
       Picture(
-          double FOVin,
-          std::list<RelativeVessel>::iterator begin,
-          std::list<RelativeVessel>::iterator end
+          double FOVin                 /** the camera field of view, in radians */,
+          const RelativeVessel *begin  /** first vessel in the picture */,
+          const RelativeVessel *end    /** one past the last vessel in the picture */
           ) ;
 
+      /// Returns the camera angle (in degrees), the average point between
+      /// the leftmost and rightmost vessel in the picture, in frame F.
+      template<Frame F> inline double getCameraAngleDeg() const {
+        return angle[int(F)];
+      };
+
+      /// Returns the camera angle (in degrees) in the given frame.
+      inline double getCameraAngleDeg(Frame frame) const {
+        return angle[int(frame)];
+      };
+
       /// Compute the camera angle (in degrees) as the average point between
       /// the leftmost and rightmost vessel in the picture.
-      double getCameraAngleDeg(
+      inline double getCameraAngleDeg(
           char referenceSystem='E' /** Possible values: \n
                                      'E' (counterclockwise, East=0) [default]\n
                                      'N' (clockwise, North=0) \n
                                      'C' (clockwise, North=0, from left side of the camera frame)\n
                                      */
-          ) const;
+          ) const {
+        return getCameraAngleDeg(referenceSystem == 'N' ? Frame::North :
+                                 referenceSystem == 'C' ? Frame::Camera : Frame::East);
+      };
 
-      /// Compute the maximum angular distance (in degrees) between the
+      /// Returns the maximum angular distance (in degrees) between the
       /// leftmost and rightmost vessel in the picture.
-      double getMaxAngularDistanceDeg() const;
-
-      /// Adds a vessel to the picture.
-      inline void addVessel(RelativeVessel vessel) { 
-        vessels.push_back(vessel); 
+      inline double getMaxAngularDistanceDeg() const {
+        return maxAngularDistance;
       };
 
       /// Counts the number of vessels in the picture 
@@ -212,57 +370,233 @@ namespace gimbaledCamera {
         return vessels.size();
       };
 
-      /// Transfers vessels from newVessel into this picture. Sorts them by bearing if sort=true
-      inline void addVessels( 
-          std::list<gimbaledCamera::RelativeVessel> newVessels, 
-          bool sort=false
-          ) {
-        vessels.splice(vessels.begin(), newVessels);
-        if (sort)
-          vessels.sort(sortByBearing); 
-      }
-
-      /// Returns the list of vessels.
-      inline std::list<RelativeVessel> getVessels() const { 
+      /// Returns the vessels in the picture, leftmost first.
+      inline const VesselSpan &getVessels() const { 
         return vessels; 
       };  
 
       /// Overloads the << operator.
-      friend std::ostream &operator<<(std::ostream &output, Picture &p) {
+      friend std::ostream &operator<<(std::ostream &output, const Picture &p) {
         output << std::fixed << std::setw(7) << std::setprecision(1)
           << "### PICTURE ###" << std::endl
-          << "Camera angle: ............................... " << p.getCameraAngleDeg()        << " degrees (counterclockwise from East)" << std::endl
-          << "Camera angle: ............................... " << p.getCameraAngleDeg('N')     << " degrees (clockwise from North)" << std::endl
-          << "Camera trigger angle: ....................... " << p.getCameraAngleDeg('C')     << " degrees (clockwise from North, left side of camera frame)" << std::endl
+          << "Camera angle: ............................... " << p.getCameraAngleDeg<Frame::East>()   << " degrees (counterclockwise from East)" << std::endl
+          << "Camera angle: ............................... " << p.getCameraAngleDeg<Frame::North>()  << " degrees (clockwise from North)" << std::endl
+          << "Camera trigger angle: ....................... " << p.getCameraAngleDeg<Frame::Camera>() << " degrees (clockwise from North, left side of camera frame)" << std::endl
           << "Number of vessels: .......................... " << p.countVessels()             << std::endl
           << "Maximum angular distance between vessels: ... " << p.getMaxAngularDistanceDeg() << " degrees (not including margin)"   << std::endl
           << "List of vessels:" << std::endl
           << std::setprecision(6);
 
-        for (std::list<gimbaledCamera::RelativeVessel>::iterator ptr=p.vessels.begin(); ptr!=p.vessels.end(); ptr++)
-          output << "-- " << *ptr;
+        for (auto & vessel : p.vessels)
+          output << "-- " << vessel;
 
         return output;
       }
 
     private:
 
-      std::list<RelativeVessel> vessels;        ///< The list of vessels in the picture 
-      double FOV;                               ///< The picture field of view
+      VesselSpan vessels;                       ///< The vessels in the picture
+      double angle[3];                          ///< The camera angle in each Frame, in degrees
+      double maxAngularDistance;                ///< Angle between the leftmost and rightmost vessel, in degrees
+
+      friend class Plan;                        // re-points the vessels of copied pictures
 
   };
 
+  /** The result of a planner: the pictures, and the vessels they refer to.
+   *
+   *  All vessels live in one contiguous buffer, sorted by bearing and rotated
+   *  so that every picture (including one that wraps around the circle) is a
+   *  contiguous range.  Pictures are lightweight views into that buffer, in
+   *  the order the planner produced them.
+   */
+  class Plan {
+
+    public:
+
+      typedef std::vector<Picture>::const_iterator const_iterator;
+
+      /// Class constructor (an empty plan).
+      Plan() : FOV(0) {};
+
+      Plan(const Plan &);              ///< Copies the buffer and re-points the pictures to it
+      Plan &operator=(const Plan &);   ///< Copies the buffer and re-points the pictures to it
+      Plan(Plan &&) = default;
+      Plan &operator=(Plan &&) = default;
+
+      inline const_iterator begin() const { return pictures.begin(); };
+      inline const_iterator end()   const { return pictures.end();   };
+
+      /// Returns the number of pictures.
+      inline std::size_t size() const { return pictures.size(); };
+
+      /// Returns true if there are no pictures.
+      inline bool empty() const { return pictures.empty(); };
+
+      /// Returns the first picture.
+      inline const Picture &front() const { return pictures.front(); };
+
+      /// Returns the last picture.
+      inline const Picture &back() const { return pictures.back(); };
+
+      inline const Picture &operator[](std::size_t i) const { return pictures[i]; };
+
+      /// Returns the vessel buffer the pictures refer to.
+      inline const std::vector<RelativeVessel> &getVessels() const { 
+        return vessels; 
+      };
+
+      class Builder;
+
+    private:
+
+      double FOV;                          ///< The picture field of view, in radians
+      std::vector<RelativeVessel> vessels; ///< All vessels, in bearing order
+      std::vector<Picture> pictures;       ///< Views into vessels
+
+  };
+
+  /** Builds a Plan, for the planners.  The vessels are moved into the plan
+   *  buffer first, then the pictures are added as ranges [begin, end) of it.
+   *  Pictures point into the buffer, so it may only be rotated or changed
+   *  before the first picture is added.
+   */
+  class Plan::Builder {
+
+    public:
+
+      /// Class constructor: the vessels, sorted by bearing, and no pictures (FOV in radians).
+      Builder(double FOV, std::vector<RelativeVessel> &&sorted);
+
+      /// Class constructor: the vessels of a plan, without its pictures.
+      explicit Builder(Plan &&plan);
+
+      /// Class constructor: no vessels, reusing the buffers of an old plan (FOV in radians).
+      Builder(double FOV, Plan &&recycled);
+
+      /// Returns the field of view, in radians.
+      inline double getFOV() const { 
+        return plan.FOV; 
+      };
+
+      /// Returns the vessel buffer, which may be changed until the first picture is added.
+      inline std::vector<RelativeVessel> &getVessels() { 
+        return plan.vessels; 
+      };
+
+      void rotate(std::size_t first);                  ///< Makes vessel first the start of the buffer
+      void reserve(std::size_t count);                 ///< Reserves room for count pictures
+      void addPicture(std::size_t begin, std::size_t end); ///< Adds the picture [begin, end) of the buffer
+      void addPicture(std::size_t begin, std::size_t end, double FOV); ///< Adds the picture [begin, end), taken with the given FOV (in radians)
+
+      /// Adds the pictures starting at the given offsets into the sorted buffer,
+      /// merging the first and last picture if they fit in the FOV.
+      void addPictures(const std::size_t *starts, std::size_t count);
+
+      /// Bins the sorted buffer into FOV-wide pictures, as makePictures does.
+      void addBins();
+
+      /// Returns the plan, leaving the builder empty.
+      inline Plan build() { 
+        return std::move(plan); 
+      };
+
+      /// Returns the number of FOV-wide bins of the sorted vessels, and writes their first vessel to starts (if not null).
+      /// Any vessel type with getBearing() and getMargin() (in radians) can be binned.
+      template <class SortedVessel>
+      static std::size_t partition(double FOV, const std::vector<SortedVessel> &sorted, std::size_t *starts);
+
+    private:
+
+      Plan plan;   ///< The plan being built
+
+  };
+
+  // Return the number of FOV-wide bins of the sorted vessels, and record
+  // their first vessel in starts (if given)
+  template <class SortedVessel>
+  std::size_t Plan::Builder::partition(double FOV, const std::vector<SortedVessel> &vessels, std::size_t *starts) {
+    std::size_t count = 0;
+    std::size_t refVessel = 0;                                               // the first reference vessel
+
+    for (std::size_t ptr = 0; ptr < vessels.size(); ++ptr) {
+
+      // compute the delta in bearing, including the marings
+      double dBearing = ( vessels[ptr].getBearing()       + vessels[ptr].getMargin()       ) 
+                      - ( vessels[refVessel].getBearing() - vessels[refVessel].getMargin() ); 
+
+      if (ptr == 0 || (dBearing >= FOV && ptr != refVessel)) {   // if bearings' difference is greater than FOV
+        if (starts)                                              // ... a new picture starts at ptr
+          starts[count] = ptr;
+        ++count;
+        refVessel = ptr;                                         // ... and update the reference Vessel
+      }
+    }
+    return count;
+  }
+
   /** Groups vessels into pictures.
    * 
    *  Given a list or RelatedVessels, it partitions them into pictures based on
    *  the FOV.  Returns a list containing the minimum number of pictures given
    *  the vessel position and the drone's FOV.
+   *
+   *  The vessels are moved into the returned Plan: pass them with std::move
+   *  to plan a frame with a constant number of heap allocations.
    * */
-  std::list<Picture> makePictures(
-      double FOV                        /** the camera field of view, in degrees */,
-      std::list<RelativeVessel> vessels /** the vessels to be partitioned into pictures */
+  Plan makePictures(
+      double FOV                          /** the camera field of view, in degrees */,
+      std::vector<RelativeVessel> vessels /** the vessels to be partitioned into pictures */
       );
 
+  /// Groups a list of vessels into pictures (copies them into a contiguous buffer).
+  inline Plan makePictures(
+      double FOV                                /** the camera field of view, in degrees */,
+      const std::list<RelativeVessel> &vessels  /** the vessels to be partitioned into pictures */
+      ) {
+    return makePictures(FOV, std::vector<RelativeVessel>(vessels.begin(), vessels.end()));
+  }
+
+  /** Groups vessels into pictures as makePictures does, into an existing
+   *  plan.
+   *
+   *  The plan's buffers are reused, so they only grow when a frame holds
+   *  more vessels or pictures than any before, and the scratch memory of the
+   *  sort and partition is taken from the given resource (e.g. a FrameArena
+   *  reset between frames).  A planning loop that keeps its plan and arena
+   *  makes no heap allocation once they have grown to the largest frame.
+   *  The vessels are copied, in bearing order, into the plan.
+   * */
+  void makePictures(
+      double FOV                                  /** the camera field of view, in degrees */,
+      const std::vector<RelativeVessel> &vessels  /** the vessels to be partitioned into pictures */,
+      Plan &plan                                  /** the plan to replace */,
+      std::pmr::memory_resource &scratch          /** the resource of the scratch memory */
+      );
+
+  /** Groups vessels into the provably minimum number of pictures.
+   *
+   *  A picture is a run of consecutive vessels (sorted by bearing, wrapping
+   *  around the circle) whose bearings, margins included, span less than
+   *  the FOV.  The greedy pass in makePictures is optimal only if the first
+   *  picture starts at the smallest bearing; this function greedily covers
+   *  the circle from every possible starting vessel at once, using
+   *  binary-lifting jump pointers, and keeps the start that needs the fewest
+   *  pictures.  Runs in O(n log n).
+   * */
+  Plan makeMinimalPictures(
+      double FOV                          /** the camera field of view, in degrees */,
+      std::vector<RelativeVessel> vessels /** the vessels to be partitioned into pictures */
+      );
+
+  /// Groups a list of vessels into the minimum number of pictures (copies them into a contiguous buffer).
+  inline Plan makeMinimalPictures(
+      double FOV                                /** the camera field of view, in degrees */,
+      const std::list<RelativeVessel> &vessels  /** the vessels to be partitioned into pictures */
+      ) {
+    return makeMinimalPictures(FOV, std::vector<RelativeVessel>(vessels.begin(), vessels.end()));
+  }
+
 }
 
 #endif
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+#include <iterator>
+#include "incrementalPlanner.h"
+
+namespace gimbaledCamera {
+
+  // Class constructor for IncrementalPlanner
+  IncrementalPlanner::IncrementalPlanner(
+      const double FOVin,
+      const Vessel &dronein,
+      const double marginin
+      ) : FOV(FOVin*M_PI/180), margin(marginin), drone(dronein), lastRepairCost(0)
+  {
+  }
+
+  // Add or move a vessel, then repair the pictures around its old and new bearing
+  void IncrementalPlanner::insert(const std::string &name, const double lat, const double lon) {
+    remove(name);
+
+    RelativeVessel vessel(lat, lon, name, drone, margin);
+    const Key key(vessel.getBearing(), name);
+    index.insert(Index::value_type(key, vessel));
+    keys[name] = key;
+    const std::size_t removalCost = lastRepairCost;
+    repair(key);
+    lastRepairCost += removalCost;
+  }
+
+  // Remove a vessel, then repair the pictures around its bearing
+  bool IncrementalPlanner::remove(const std::string &name) {
+    lastRepairCost = 0;
+    auto ptr = keys.find(name);
+    if (ptr == keys.end())
+      return false;
+
+    const Key key = ptr->second;
+    keys.erase(ptr);
+    index.erase(key);
+    cuts.erase(key);
+    repair(key);
+    return true;
+  }
+
+  // Move the drone and rebuild every vessel and picture
+  void IncrementalPlanner::setDrone(const Vessel &dronein) {
+    drone = dronein;
+
+    Index old;
+    old.swap(index);
+    keys.clear();
+    cuts.clear();
+    for (auto & entry : old) {
+      RelativeVessel vessel(entry.second.getLatDeg(), entry.second.getLonDeg(), entry.second.getName(), drone, margin);
+      const Key key(vessel.getBearing(), entry.second.getName());
+      index.insert(Index::value_type(key, vessel));
+      keys[key.second] = key;
+    }
+    if (!index.empty())
+      repair(index.begin()->first);
+  }
+
+  // Redo the greedy partition of makePictures from the picture containing the
+  // changed key, until it falls back onto an existing picture start past it
+  void IncrementalPlanner::repair(const Key &changed) {
+    lastRepairCost = 0;
+    if (index.empty()) {
+      cuts.clear();
+      return;
+    }
+
+    // the first vessel always starts a picture
+    auto first = cuts.lower_bound(changed);
+    Index::const_iterator ref;
+    if (first == cuts.begin() || index.begin()->first >= changed) {
+      ref = index.begin();
+      cuts.erase(cuts.begin(), cuts.lower_bound(ref->first));
+    } else {
+      ref = index.find(*std::prev(first));
+    }
+    cuts.insert(ref->first);
+
+    while (true) {
+      // the widest picture starting at ref, as in makePictures
+      const double left = ref->second.getBearing() - ref->second.getMargin();
+      auto ptr = std::next(ref);
+      for (; ptr != index.end(); ++ptr, ++lastRepairCost)
+        if (ptr->second.getBearing() + ptr->second.getMargin() - left >= FOV)
+          break;
+
+      // pictures that used to start inside it are gone
+      auto stale = cuts.upper_bound(ref->first);
+      if (ptr == index.end()) {
+        cuts.erase(stale, cuts.end());
+        return;
+      }
+      cuts.erase(stale, cuts.lower_bound(ptr->first));
+
+      // past the change, an existing picture start means the rest is unchanged
+      if (cuts.count(ptr->first) && changed < ptr->first)
+        return;
+      cuts.insert(ptr->first);
+      ref = ptr;
+    }
+  }
+
+  // Copy the vessels into a plan, then merge the first and last picture if they fit
+  Plan IncrementalPlanner::getPictures() const {
+    std::vector<RelativeVessel> vessels;
+    std::vector<std::size_t> starts;
+    vessels.reserve(index.size());
+    starts.reserve(cuts.size());
+
+    auto cut = cuts.begin();
+    for (auto & entry : index) {
+      if (cut != cuts.end() && entry.first == *cut) {
+        starts.push_back(vessels.size());
+        ++cut;
+      }
+      vessels.push_back(entry.second);
+    }
+    Plan::Builder builder(FOV, std::move(vessels));
+    builder.addPictures(starts.data(), starts.size());
+    return builder.build();
+  }
+
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include "gimbaledCamera.h"
+
+#ifndef INCREMENTALPLANNER_H
+#define INCREMENTALPLANNER_H
+
+/** @file */
+
+namespace gimbaledCamera {
+
+  /** A persistent planner for live position updates.
+   *
+   *  Keeps the vessels in an ordered bearing index, keyed by name, together
+   *  with the set of vessels that start a picture.  Inserting, moving or
+   *  removing a vessel costs O(log n) to update the index, plus a local
+   *  repair of the pictures: the greedy partition of makePictures is redone
+   *  from the picture that contains the change, and stops as soon as it
+   *  falls back onto a picture start that is past the change.
+   *
+   *  getPictures returns the same pictures as makePictures would for the
+   *  current vessels (assuming distinct bearings).
+   */
+  class IncrementalPlanner {
+
+    public:
+
+      /// Class constructor.
+      IncrementalPlanner(
+          const double FOV      /** the camera field of view, in degrees */,
+          const Vessel &drone   /** drone instance */,
+          const double margin=100 /** the radius of the region around each vessel we want to capture, in meters */
+          );
+
+      /// Adds a vessel, or moves it if a vessel with the same name is already planned.
+      void insert(
+          const std::string &name /** vessel name */,
+          const double lat       /** vessel latitude, in degrees */,
+          const double lon       /** vessel longitude, in degrees */
+          );
+
+      /// Moves a vessel to a new position (adds it if unknown).
+      inline void move(const std::string &name, const double lat, const double lon) {
+        insert(name, lat, lon);
+      };
+
+      /// Removes a vessel.  Returns false if no vessel has that name.
+      bool remove(const std::string &name);
+
+      /// Moves the drone.  Every bearing changes, so the plan is rebuilt.
+      void setDrone(const Vessel &drone);
+
+      /// Counts the number of vessels in the plan.
+      inline std::size_t countVessels() const {
+        return index.size();
+      };
+
+      /// Number of vessels scanned by the last repair (for diagnostics).
+      inline std::size_t getLastRepairCost() const {
+        return lastRepairCost;
+      };
+
+      /// Returns the current pictures, as makePictures would.
+      Plan getPictures() const;
+
+    private:
+
+      typedef std::pair<double, std::string>  Key;   ///< (bearing, name): the bearing order
+      typedef std::map<Key, RelativeVessel>    Index;
+
+      void repair(const Key &changed); ///< Redoes the greedy partition around a changed key
+
+      double FOV;                     ///< The picture field of view, in radians
+      double margin;                  ///< The radius captured around each vessel, in meters
+      Vessel drone;                   ///< The drone all bearings are relative to
+      Index index;                    ///< Vessels sorted by bearing
+      std::unordered_map<std::string, Key> keys; ///< Index key of each vessel, by name
+      std::set<Key> cuts;             ///< Keys of the vessels starting a picture
+      std::size_t lastRepairCost;     ///< Vessels scanned by the last repair
+
+  };
+
+}
+
+#endif
@@ -20,80 +20,251 @@
  * SOFTWARE.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <fstream>
-#include <list>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
 #include <vector>
+#include <fcntl.h>
+#include <unistd.h>
 #include "gimbaledCamera.h"
+#include "parallelPlanner.h"
+#include "planDaemon.h"
+#include "scheduleWriter.h"
+#include "slewScheduler.h"
+#include "stats.h"
+#include "streamPlanner.h"
+#include "vesselIO.h"
+
+namespace {
+
+  // set and cleared by runDaemon, read by the signal handler (lock-free, so signal-safe)
+  std::atomic<gimbaledCamera::PlanDaemon *> runningDaemon(nullptr);
+  static_assert(std::atomic<gimbaledCamera::PlanDaemon *>::is_always_lock_free, "the signal handler needs a lock-free pointer");
+
+  // SIGINT and SIGTERM stop the daemon
+  void stopDaemon(int) {
+    gimbaledCamera::PlanDaemon *planDaemon = runningDaemon.load();
+    if (planDaemon)
+      planDaemon->stop();
+  }
+
+  // The daemon mode: plans are published by the daemon on this thread, and
+  // read by a stand-in for the gimbal controller, which prints each new one.
+  int runDaemon(const std::string &path, double rate, double gimbalAngle) {
+    try {
+      gimbaledCamera::PlanDaemon planDaemon(path, rate, 80., 100, gimbalAngle);
+      runningDaemon = &planDaemon;
+      signal(SIGINT, stopDaemon);
+      signal(SIGTERM, stopDaemon);
+      std::cout << "Planning the updates received on " << path << std::endl;
+
+      std::atomic<bool> done(false);
+      std::thread controller([&]() {
+        std::uint64_t seen = 0;
+        while (!done.load()) {
+          {
+            const gimbaledCamera::PlanBuffer::Reader plan = planDaemon.getPlans().read();
+            if (plan->sequence != seen) {
+              seen = plan->sequence;
+              std::cout << "Plan " << seen << ", " << plan->vessels << " vessels, trigger angles: ";
+              std::cout << std::setprecision(0) << std::fixed;
+              for (double angle : plan->triggerAngleDeg)
+                std::cout << angle << ", ";
+              std::cout << std::endl;
+            }
+          }
+          std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+      });
+
+      try {
+        planDaemon.run();
+      } catch (...) {
+        runningDaemon = nullptr;
+        done.store(true);
+        controller.join();
+        throw;
+      }
+      done.store(true);
+      controller.join();
+      runningDaemon = nullptr;
+      std::cout << planDaemon.countUpdates() << " updates, " << planDaemon.countMalformed() 
+        << " malformed lines, " << planDaemon.countRejected() << " new vessels rejected" << std::endl;
+    } catch (const std::exception &e) {
+      runningDaemon = nullptr;
+      std::cerr << "main: " << e.what() << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
+}
 
 int main(int argc, char **argv) {
 
-  // the vessel positions and names (can be read from file)
-  struct Data { 
-    std::string name; 
-    double lat; 
-    double lon; 
-  };
+  // --format=csv|jsonl|binary selects the quiet mode: no report, only the
+  // schedule in that format, to standard output or to the --output file
+  // (which is only valid with --format).
+  // --daemon=PATH plans the updates received on a socket (or FIFO) instead
+  // of standard input, --rate times per second.  The other arguments are 
+  // positional: gimbal angle, range and threads.
+  std::vector<const char *> args;
+  std::string format, outputPath, daemonPath;
+  double rate = 10;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.compare(0, 9, "--format=") == 0)
+      format = arg.substr(9);
+    else if (arg.compare(0, 9, "--output=") == 0)
+      outputPath = arg.substr(9);
+    else if (arg.compare(0, 9, "--daemon=") == 0)
+      daemonPath = arg.substr(9);
+    else if (arg.compare(0, 7, "--rate=") == 0)
+      rate = atof(arg.c_str() + 7);
+    else
+      args.push_back(argv[i]);
+  }
+  if (!daemonPath.empty())
+    return runDaemon(daemonPath, rate, args.size() > 0 ? atof(args[0]) : 0.);
 
-  std::vector<Data> data;
+  const bool quiet = !format.empty();
+  if (!quiet && !outputPath.empty()) {
+    std::cerr << "main: --output needs --format (the report goes to standard output)" << std::endl;
+    return 1;
+  }
+  gimbaledCamera::OutputFormat outputFormat = gimbaledCamera::OutputFormat::CSV;
+  try {
+    if (quiet)
+      outputFormat = gimbaledCamera::outputFormat(format);
+  } catch (const std::exception &e) {
+    std::cerr << "main: " << e.what() << std::endl;
+    return 1;
+  }
 
-  // load the vessels' name and position from command line  
-  while ((!(std::cin >> std::ws).eof())) {
-    Data tmp;
-    std::cin >> tmp.name >> tmp.lat >> tmp.lon;
-    data.push_back(tmp);
+  // the frames of standard input (text snapshots separated by "---", or a
+  // binary snapshot) go through a pipeline: parse, geometry, plan and output
+  // overlap, and each frame is reported as soon as it is planned.  With a
+  // range (in meters) as second argument, only the vessels within range are
+  // planned: a grid index finds them without computing the geometry of the
+  // others.  The geometry and the sort run on as many threads as the third
+  // argument (one per core by default).
+  gimbaledCamera::StreamOptions options;
+  options.gimbalAngleDeg = args.size() > 0 ? atof(args[0]) : 0.;
+  options.maxRange = args.size() > 1 ? atof(args[1]) : 0.;
+  options.keepVessels = !quiet;
+  gimbaledCamera::ThreadPool pool(args.size() > 2 ? std::max(0, atoi(args[2])) : 0);
+
+  const int fd = outputPath.empty() ? 1 : open(outputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    std::cerr << "main: cannot open " << outputPath << ": " << strerror(errno) << std::endl;
+    return 1;
   }
+  gimbaledCamera::BufferedWriter output(fd);
+  const std::ios_base::fmtflags flags = std::cout.flags();
+  const std::streamsize precision = std::cout.precision();
+  std::size_t frames = 0;
+
+  auto report = [&](gimbaledCamera::FramePlan &frame) {
+    ++frames;
+    const gimbaledCamera::Plan &pictures = frame.plan;
+    const gimbaledCamera::Schedule &schedule = frame.schedule;
+
+    if (quiet) {
+      GIMBALEDCAMERA_TIME(Output);
+
+      // write the schedule, and the vessels in each picture, after a single header
+      if (frames == 1)
+        gimbaledCamera::writeScheduleHeader(output, outputFormat);
+      gimbaledCamera::writeScheduleFrame(output, pictures, schedule, outputFormat, std::uint64_t(frame.frame));
+      output.flush();
+      return;
+    }
+
+    // every frame is printed as if it were the only one
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+
+    // print the description of the drone (the first vessel) to screen
+    std::cout << std::endl <<
+      "===================== The drone and its position ========================" 
+      << std::endl;
+    std::cout << frame.drone; 
+
+    // print the description of the vessels to screen 
+    std::cout  << std::endl <<
+      "===================== List of identified vessels ========================"
+      << std::endl;
+    for (auto & vessel : frame.vessels)
+      std::cout << vessel;
 
-  // initialize the drone and print its description to screenn
-  gimbaledCamera::Vessel drone(data[0].lat, data[0].lon, data[0].name);
-  data.erase(data.begin()); // remove the drone from the list
+    // print the description of the pictures to screen
+    std::cout  << std::endl <<
+      "=====================      List of pictures      ========================"
+      << std::endl;
+    for (auto & picture : pictures) 
+      std::cout << std::endl << picture;
 
-  std::cout << std::endl <<
-    "===================== The drone and its position ========================" 
-    << std::endl;
-  std::cout << drone; 
+    // print the order of the pictures that minimizes the gimbal slew time
+    std::cout  << std::endl <<
+      "=====================      Capture schedule      ========================"
+      << std::endl;
+    std::cout << schedule;
 
-  // initialize a list of vessels and print their description to screen 
-  std::list<gimbaledCamera::RelativeVessel> vessels;
-  for (auto const& tmp : data) {
-    gimbaledCamera::RelativeVessel vessel(tmp.lat, tmp.lon, tmp.name, drone);
-    vessels.push_back(vessel);
+    GIMBALEDCAMERA_TIME(Output);
+
+    // print the final result to screen
+    std::cout << std::endl << 
+      "*************************************************************************\n";
+    std::cout << "** The camera trigger angles are: ";
+    std::cout << std::setprecision(0) << std::fixed;
+    for (auto & capture : schedule.captures) 
+      std::cout <<  capture.triggerAngleDeg << ", ";
+    std::cout << std::endl;
+
+    // save the final result to file (the last frame's, with several frames)
+    std::ofstream myfile;
+    myfile.open ("output.txt");
+    for (auto & capture : schedule.captures) 
+      myfile << capture.triggerAngleDeg << std::endl;
+    myfile.close();
+    std::cout << "** Trigger angles written to output.txt\n";
+    std::cout << 
+      "*************************************************************************\n";
+  };
+
+  try {
+    gimbaledCamera::streamPlans(0, pool, report, options);
+  } catch (const std::exception &e) {
+    std::cerr << "main: " << e.what() << std::endl;
+    return 1;
+  }
+  if (fd != 1)
+    close(fd);
+  if (frames == 0) {
+    std::cerr << "main: no vessels in input" << std::endl;
+    return 1;
   }
 
-  std::cout  << std::endl <<
-    "===================== List of identified vessels ========================"
-    << std::endl;
-  for (auto & vessel : vessels)
-    std::cout << vessel;
-
-  // generate a list of pictures and print their description to screen
-  std::list<gimbaledCamera::Picture> pictures;
-  pictures = makePictures(80., vessels);
-
-  std::cout  << std::endl <<
-    "=====================      List of pictures      ========================"
-    << std::endl;
-  for (auto & picture : pictures) 
-    std::cout << std::endl << picture;
-
-  // print the final result to screen
-  std::cout << std::endl << 
-    "*************************************************************************\n";
-  std::cout << "** The camera trigger angles are: ";
-  std::cout << std::setprecision(0) << std::fixed;
-  for (auto & picture : pictures) 
-    std::cout <<  picture.getCameraAngleDeg('C') << ", ";
-  std::cout << std::endl;
-
-  // save the final result to file 
-  std::ofstream myfile;
-  myfile.open ("output.txt");
-  for (auto & picture : pictures) 
-    myfile << picture.getCameraAngleDeg('C') << std::endl;
-  myfile.close();
-  std::cout << "** Trigger angles written to output.txt\n";
-  std::cout << 
-    "*************************************************************************\n";
+  // with make STATS=1, write the instrumentation to the file named by
+  // GIMBALEDCAMERA_STATS_FILE (JSON if it ends in .json, Prometheus text otherwise)
+  if (gimbaledCamera::stats::enabled && getenv("GIMBALEDCAMERA_STATS_FILE")) {
+    try {
+      gimbaledCamera::stats::dump(getenv("GIMBALEDCAMERA_STATS_FILE"));
+    } catch (const std::exception &e) {
+      std::cerr << "main: " << e.what() << std::endl;
+      return 1;
+    }
+  }
 
   return 0;
 
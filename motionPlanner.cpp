@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include "geodesy.h"
+#include "motionPlanner.h"
+
+namespace gimbaledCamera {
+
+  namespace {
+    const double earthRadius = 6371000;
+  }
+
+  // Class constructor for RelativeMotion: relative velocities, in degrees per second
+  RelativeMotion::RelativeMotion(const Vessel &drone, std::size_t n,
+      const double *lat, const double *course, const double *speed) : latRate(n), lonRate(n) {
+    const double droneNorth = drone.getSpeed()*cos(drone.getCourse()),
+                 droneEast  = drone.getSpeed()*sin(drone.getCourse());
+    const double toDeg = 180/M_PI/earthRadius;
+
+    for (std::size_t i = 0; i < n; ++i) {
+      const double c = course[i]*M_PI/180;
+      latRate[i] = (speed[i]*cos(c) - droneNorth)*toDeg;
+      lonRate[i] = (speed[i]*sin(c) - droneEast)*toDeg/cos(lat[i]*M_PI/180);
+    }
+  }
+
+  void RelativeMotion::propagate(const double *lat, const double *lon, const double *dt,
+      double *latOut, double *lonOut) const {
+    const std::size_t n = latRate.size();
+    const double *__restrict latRates = latRate.data();
+    const double *__restrict lonRates = lonRate.data();
+    for (std::size_t i = 0; i < n; ++i) {
+      latOut[i] = lat[i] + latRates[i]*dt[i];
+      lonOut[i] = lon[i] + lonRates[i]*dt[i];
+    }
+  }
+
+  MotionPlan planWithMotion(const double FOV, const Vessel &drone, const VesselSnapshot &snapshot,
+      const double *course, const double *speed, const double gimbalAngleDeg,
+      const SlewModel &model, const double margin, const int maxIterations, const double timeTolerance) {
+
+    const std::size_t n = snapshot.size();
+    const RelativeMotion motion(drone, n, snapshot.getLats(), course, speed);
+
+    MotionPlan result;
+    result.captureTime.assign(n, 0.);
+    std::vector<double> lat(n), lon(n), bearing(n), dist(n), bearingMargin(n), next(n);
+    std::vector<double> previous(1, -1.);   // the capture times of the last schedule
+    std::vector<std::uint32_t> names(n);    // the name ids, interned once for all iterations
+    for (std::size_t i = 0; i < n; ++i)
+      names[i] = NameTable::global().intern(snapshot.getName(i));
+
+    while (result.iterations < maxIterations) {
+      ++result.iterations;
+
+      // predicted positions, relative to the drone, at the current capture times
+      motion.propagate(snapshot.getLats(), snapshot.getLons(), result.captureTime.data(), lat.data(), lon.data());
+      computeRelativeBatch(drone, n, lat.data(), lon.data(), bearing.data(), dist.data(), bearingMargin.data(), margin);
+
+      std::vector<RelativeVessel> vessels;
+      vessels.reserve(n);
+      for (std::size_t i = 0; i < n; ++i) {
+        vessels.emplace_back(lat[i], lon[i], names[i], bearing[i], dist[i], bearingMargin[i]);
+        vessels.back().setMotion(course[i], speed[i]);
+        vessels.back().setRow(i);                             // maps the pictures back to the snapshot
+      }
+      result.plan     = makePictures(FOV, std::move(vessels));
+      result.schedule = schedulePictures(result.plan, gimbalAngleDeg, model);
+
+      // the trigger time of each vessel's picture
+      for (auto & capture : result.schedule.captures)
+        for (auto & vessel : result.plan[capture.picture].getVessels())
+          next[vessel.getRow()] = capture.time - model.captureTime;
+      result.captureTime.swap(next);
+
+      // converged when the schedule no longer changes (a vessel right on the
+      // boundary between two pictures may keep alternating between them)
+      bool same = previous.size() == result.schedule.captures.size();
+      for (std::size_t k = 0; same && k < previous.size(); ++k)
+        same = std::fabs(previous[k] - result.schedule.captures[k].time) <= timeTolerance;
+      if (same) {
+        result.converged = true;
+        break;
+      }
+      previous.clear();
+      for (auto & capture : result.schedule.captures)
+        previous.push_back(capture.time);
+    }
+    return result;
+  }
+
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstddef>
+#include <vector>
+#include "gimbaledCamera.h"
+#include "slewScheduler.h"
+#include "vesselIO.h"
+
+#ifndef MOTIONPLANNER_H
+#define MOTIONPLANNER_H
+
+/** @file */
+
+namespace gimbaledCamera {
+
+  /** Dead reckoning of a fleet relative to a moving drone.
+   *
+   *  Positions are propagated on the local tangent plane at constant course
+   *  and speed (accurate to well below a meter for tens of kilometers and
+   *  minutes).  Bearings only depend on the relative position, so each
+   *  vessel is moved by its velocity minus the drone's, and the drone stays
+   *  where it is.  The rates are computed once; propagating is then two
+   *  multiply-adds per vessel in structure-of-arrays layout, which the
+   *  compiler vectorizes.
+   */
+  class RelativeMotion {
+
+    public:
+
+      /// Class constructor.
+      RelativeMotion(
+          const Vessel &drone    /** drone instance, with its course and speed */,
+          std::size_t n          /** number of vessels */,
+          const double *lat      /** vessel latitudes, in degrees */,
+          const double *course   /** vessel courses, in degrees clockwise from North */,
+          const double *speed    /** vessel speeds, in meters per second */
+          );
+
+      /// Returns the number of vessels.
+      inline std::size_t size() const {
+        return latRate.size();
+      };
+
+      /// Moves vessel i from (lat[i], lon[i]) by dt[i] seconds.
+      void propagate(
+          const double *lat      /** vessel latitudes, in degrees */,
+          const double *lon      /** vessel longitudes, in degrees */,
+          const double *dt       /** time to propagate each vessel by, in seconds */,
+          double *latOut         /** output: propagated latitudes, in degrees */,
+          double *lonOut         /** output: propagated longitudes, in degrees */
+          ) const;
+
+    private:
+
+      std::vector<double> latRate;  ///< Relative northward rate, in degrees per second
+      std::vector<double> lonRate;  ///< Relative eastward rate, in degrees per second
+
+  };
+
+  /// The result of planWithMotion.
+  struct MotionPlan {
+    Plan plan;                        ///< The pictures, with every vessel at its predicted position
+    Schedule schedule;                ///< The capture order and times
+    std::vector<double> captureTime;  ///< Trigger time of each snapshot vessel in the schedule, in seconds
+    int iterations = 0;               ///< Number of plans computed
+    bool converged = false;           ///< True if the schedule reached a fixed point
+  };
+
+  /** Plans and schedules the pictures of moving vessels from a moving drone.
+   *
+   *  The first plan uses the current positions.  Each vessel is then moved
+   *  to the trigger time of its picture in the schedule, and the plan and
+   *  schedule are recomputed from the predicted positions, until no picture
+   *  of the schedule moves by more than timeTolerance or maxIterations plans
+   *  have been made.  A vessel right on the boundary between two pictures
+   *  may alternate between them without preventing convergence.  With no
+   *  motion, the result is the plan of makePictures.
+   */
+  MotionPlan planWithMotion(
+      const double FOV               /** the camera field of view, in degrees */,
+      const Vessel &drone            /** drone instance, with its course and speed */,
+      const VesselSnapshot &snapshot /** the vessels, at time zero */,
+      const double *course           /** vessel courses, in degrees clockwise from North */,
+      const double *speed            /** vessel speeds, in meters per second */,
+      const double gimbalAngleDeg    /** the current trigger angle, clockwise from North */,
+      const SlewModel &model=SlewModel() /** the gimbal dynamics */,
+      const double margin=100        /** the radius of the region around each vessel we want to capture, in meters */,
+      const int maxIterations=8      /** the maximum number of plans */,
+      const double timeTolerance=1e-3 /** convergence threshold on the schedule times, in seconds */
+      );
+
+}
+
+#endif
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include "nameTable.h"
+
+namespace gimbaledCamera {
+
+  // Class constructor for NameTable
+  NameTable::NameTable() : slots(1024, 0) {
+    names.emplace_back();
+    slots[find("", std::hash<std::string_view>()(""))] = 1;
+  }
+
+  // Linear probing; the high half of the hash is kept in the slot, so that
+  // most names are only compared to the one they are looking for
+  std::size_t NameTable::find(std::string_view name, std::size_t hash) const {
+    const std::size_t mask = slots.size() - 1;
+    const std::uint64_t tag = std::uint64_t(hash) >> 32 << 32;
+    for (std::size_t i = hash & mask; ; i = (i + 1) & mask) {
+      const std::uint64_t slot = slots[i];
+      if (slot == 0 || ((slot >> 32 << 32) == tag && names[std::uint32_t(slot) - 1] == name))
+        return i;
+    }
+  }
+
+  void NameTable::grow() {
+    std::vector<std::uint64_t> old(slots.size()*2, 0);
+    old.swap(slots);
+    const std::size_t mask = slots.size() - 1;
+    for (std::uint64_t slot : old)
+      if (slot != 0) {
+        std::size_t i = std::hash<std::string_view>()(names[std::uint32_t(slot) - 1]) & mask;
+        while (slots[i] != 0)
+          i = (i + 1) & mask;
+        slots[i] = slot;
+      }
+  }
+
+  // Look the name up under the shared lock, and add it under the exclusive one
+  std::uint32_t NameTable::intern(std::string_view name) {
+    const std::size_t hash = std::hash<std::string_view>()(name);
+    {
+      std::shared_lock<std::shared_mutex> lock(mutex);
+      const std::uint64_t slot = slots[find(name, hash)];
+      if (slot != 0)
+        return std::uint32_t(slot) - 1;
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    std::size_t i = find(name, hash);   // another thread may have added it meanwhile
+    if (slots[i] != 0)
+      return std::uint32_t(slots[i]) - 1;
+    if (names.size() >= UINT32_MAX)
+      throw std::length_error("NameTable: too many names");
+    if (2*(names.size() + 1) > slots.size()) {   // keep the table at most half full
+      grow();
+      i = find(name, hash);
+    }
+    const std::uint32_t id = names.size();
+    names.emplace_back(name);
+    slots[i] = (std::uint64_t(hash) >> 32 << 32) | (std::uint64_t(id) + 1);
+    return id;
+  }
+
+  bool NameTable::contains(std::string_view name) const {
+    const std::size_t hash = std::hash<std::string_view>()(name);
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return slots[find(name, hash)] != 0;
+  }
+
+  std::size_t NameTable::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return names.size();
+  }
+
+  NameTable &NameTable::global() {
+    static NameTable table;
+    return table;
+  }
+
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef NAMETABLE_H
+#define NAMETABLE_H
+
+/** @file */
+
+namespace gimbaledCamera {
+
+  /** Interned vessel names: each distinct name is stored once, and referred
+   *  to by a 32-bit id.
+   *
+   *  Vessels store the id of their name in the global table, so copying,
+   *  sorting and planning them never copies a string.  Names are never
+   *  removed, so ids and the references returned by lookup stay valid for
+   *  the life of the table; the table grows with the number of distinct
+   *  names seen.  Id 0 is the empty name.  Thread-safe.
+   */
+  class NameTable {
+
+    public:
+
+      /// Class constructor (a table holding the empty name only).
+      NameTable();
+
+      NameTable(const NameTable &) = delete;
+      NameTable &operator=(const NameTable &) = delete;
+
+      /// Returns the id of a name, adding it to the table if it is new.
+      std::uint32_t intern(std::string_view name);
+
+      /// Returns true if the name is in the table (without adding it).
+      bool contains(std::string_view name) const;
+
+      /// Returns the name with the given id.
+      inline const std::string &lookup(std::uint32_t id) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return names[id];
+      };
+
+      /// Returns the number of distinct names.
+      std::size_t size() const;
+
+      /// Returns the table of the names of Vessel.
+      static NameTable &global();
+
+    private:
+
+      /// Returns the slot of name in the hash table: the one holding its id, or the empty one where it goes.
+      std::size_t find(std::string_view name, std::size_t hash) const;
+
+      void grow();   ///< Doubles the hash table
+
+      mutable std::shared_mutex mutex;
+      std::deque<std::string> names;   ///< The names, by id (a deque never moves them)
+      std::vector<std::uint64_t> slots;///< Open addressing hash table: (hash >> 32) << 32 | (id+1), 0 if empty
+
+  };
+
+}
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "observerFrame.h"
+
+namespace gimbaledCamera {
+
+  // Class constructor for ObserverFrame: hoists the drone trig terms and
+  // turns the range and tolerance into a bound on rho^2
+  ObserverFrame::ObserverFrame(
+      const Vessel &drone,
+      double maxRangein,
+      double tolerancein) :
+    droneLat(drone.getLat()), droneLon(drone.getLon()),
+    sinD(std::sin(droneLat)), cosD(std::cos(droneLat)),
+    cosD2(cosD*cosD), halfSinCosD(sinD*cosD/2),
+    errorCoefficient((1 + 1/cosD2)/4),
+    maxRange(maxRangein), tolerance(tolerancein) {
+    const double rangeRad = std::max(0., maxRange/6371000);
+    // at the poles errorCoefficient is infinite: everything goes to the sphere
+    rho2Max = std::min(rangeRad*rangeRad, std::max(0., tolerance)/errorCoefficient);
+  }
+
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <string>
+#include "gimbaledCamera.h"
+#include "precision.h"
+
+#ifndef OBSERVERFRAME_H
+#define OBSERVERFRAME_H
+
+/** @file */
+
+namespace gimbaledCamera {
+
+  /** The local tangent plane of the drone, to compute the bearing and
+   *  distance of nearby vessels with planar arithmetic.
+   *
+   *  The drone trig terms are computed once.  A vessel dLat, dLon radians
+   *  away is then projected to second order,
+   *
+   *      X = dLon (cos D - sin D dLat),    Y = dLat + sin D cos D dLon^2 / 2,
+   *
+   *  D being the drone latitude: its bearing is atan2(Y, X) and its distance
+   *  6371 km sqrt(dLat^2 + cos D dLon X).  No sin or cos per vessel.
+   *
+   *  The error of the bearing plus that of the bearing margin, with respect
+   *  to the spherical formulas, is below
+   *
+   *      errorBound = (1 + 1/cos^2 D) rho^2 / 4,    rho^2 = dLat^2 + cos^2 D dLon^2,
+   *
+   *  about twice the worst case measured up to 85 degrees of latitude.
+   *  Vessels farther than maxRange, or whose errorBound would exceed the
+   *  tolerance, fall back to the spherical formulas (precision::geometry).
+   *  The margins of projected vessels are inflated by their errorBound, as
+   *  those of the precision policies are, so the pictures planned from them
+   *  still cover every vessel.
+   */
+  class ObserverFrame {
+
+    public:
+
+      /// Class constructor.
+      ObserverFrame(
+          const Vessel &drone      /** drone instance */,
+          double maxRange=20000    /** vessels farther than this (meters) are not projected */,
+          double tolerance=1e-5    /** largest errorBound of a projected vessel, in radians */
+          );
+
+      /// Returns the range within which vessels are projected, in meters:
+      /// the smaller of maxRange and the range at which errorBound reaches the tolerance.
+      inline double getPlanarRange() const {
+        return 6371000*std::sqrt(rho2Max);
+      };
+
+      /// Returns the maximum range of the projection, in meters.
+      inline double getMaxRange() const { 
+        return maxRange; 
+      };
+
+      /// Returns the tolerance on errorBound, in radians.
+      inline double getTolerance() const { 
+        return tolerance; 
+      };
+
+      /** Computes the bearing and distance of the vessel at lat, lon
+       *  (radians), projected if within the planar range and on the sphere
+       *  otherwise, with the trigonometry of precision policy P.  error is set
+       *  to a bound on the error of the bearing plus that of the margin
+       *  (P::maxAngularError on the sphere).  Returns true if the vessel was
+       *  projected.
+       */
+      template<class P=precision::Exact> inline bool locate(
+          double lat, double lon, double &bearing, double &dist, double &error) const {
+        const double dLat = lat - droneLat;
+        double dLon = lon - droneLon;
+        if (std::fabs(dLon) > M_PI)
+          dLon = std::remainder(dLon, 2*M_PI);
+        const double rho2 = dLat*dLat + cosD2*dLon*dLon;
+        if (!(rho2 <= rho2Max)) {
+          precision::geometry<P>(droneLat, droneLon, lat, lon, bearing, dist);
+          error = P::maxAngularError;
+          return false;
+        }
+        const double X = dLon*(cosD - sinD*dLat);
+        const double Y = dLat + halfSinCosD*dLon*dLon;
+        bearing = P::atan2(Y, X);
+        dist    = 6371000*std::sqrt(dLat*dLat + cosD*dLon*X);
+        error   = errorCoefficient*rho2 + P::maxAngularError;
+        return true;
+      };
+
+      /// Returns the vessel at latitude, longitude (degrees) relative to the
+      /// drone, with its margin inflated by the error of locate.
+      template<class P=precision::Exact> inline RelativeVessel relative(
+          const double latin         /** vessel latitude, in degrees */,
+          const double lonin         /** vessel longitude, in degrees */,
+          const std::string &namein  /** vessel name */,
+          const double margin=100    /** the radius of the region around lat, lon we want to capture, in meters */
+          ) const {
+        double bearing, dist, error;
+        locate<P>(latin*M_PI/180.0, lonin*M_PI/180.0, bearing, dist, error);
+        return RelativeVessel(latin, lonin, namein, bearing, dist, P::asin(margin/dist) + error);
+      };
+
+      /** Computes bearing, distance and bearing margin of n vessels, as
+       *  computeRelativeBatch does, with the margins inflated by the error of
+       *  locate.  Returns the number of vessels that fell back to the sphere.
+       */
+      template<class P=precision::Exact> std::size_t computeBatch(
+          std::size_t   n            /** number of vessels */,
+          const double *lat          /** vessel latitudes, in degrees */,
+          const double *lon          /** vessel longitudes, in degrees */,
+          double       *bearing      /** output: bearings, in radians [-pi, +pi], zero is east */,
+          double       *dist         /** output: distances, in meters */,
+          double       *bearingMargin/** output: asin(margin/distance) plus the error bound, in radians */,
+          const double  margin=100   /** the radius of the region around each vessel we want to capture, in meters */
+          ) const {
+        std::size_t spherical = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+          double error;
+          spherical += !locate<P>(lat[i]*M_PI/180.0, lon[i]*M_PI/180.0, bearing[i], dist[i], error);
+          bearingMargin[i] = P::asin(margin/dist[i]) + error;
+        }
+        return spherical;
+      };
+
+    private:
+
+      double droneLat, droneLon;   ///< Drone position, in radians
+      double sinD, cosD;           ///< Drone latitude trig terms
+      double cosD2, halfSinCosD;   ///< cos^2 D and sin D cos D / 2
+      double errorCoefficient;     ///< (1 + 1/cos^2 D)/4: errorBound = errorCoefficient*rho^2
+      double rho2Max;              ///< Square of the planar range, in radians
+      double maxRange;             ///< Maximum range of the projection, in meters
+      double tolerance;            ///< Largest errorBound of a projected vessel, in radians
+
+  };
+
+}
+
+#endif
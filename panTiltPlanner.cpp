@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <utility>
+#include "panTiltPlanner.h"
+#include "stats.h"
+
+namespace gimbaledCamera {
+
+  // Produce the pictures of a camera that pans and tilts, greedily from the widest bearing gap
+  PanTiltPlan makePanTiltPictures(double HFOV, double VFOV, double height, std::vector<RelativeVessel> vessels) {
+
+    HFOV *= M_PI/180;                                                        // convert fields of view from degrees to radians
+    VFOV *= M_PI/180;
+    GIMBALEDCAMERA_COUNT(Vessels, vessels.size());
+    {
+      GIMBALEDCAMERA_TIME(Sort);
+      std::stable_sort(vessels.begin(), vessels.end(), gimbaledCamera::sortByBearing); // sort the vessels by bearing
+    }
+
+    PanTiltPlan result;
+    const std::size_t n = vessels.size();
+    if (n == 0) {
+      result.plan = Plan::Builder(HFOV, std::move(vessels)).build();
+      return result;
+    }
+
+    GIMBALEDCAMERA_TIME(Partition);
+
+    // sweep the pan from the widest gap between two vessels: position p is
+    // vessel (cut+p)%n, with its bearing unwrapped
+    std::size_t cut = 0;
+    double widest = vessels[0].getBearing() + 2*M_PI - vessels[n-1].getBearing();
+    for (std::size_t i = 1; i < n; ++i)
+      if (vessels[i].getBearing() - vessels[i-1].getBearing() > widest) {
+        widest = vessels[i].getBearing() - vessels[i-1].getBearing();
+        cut = i;
+      }
+    std::vector<double> pan(n), tilt(n), margin(n);
+    for (std::size_t p = 0; p < n; ++p) {
+      const RelativeVessel &vessel = vessels[(cut + p)%n];
+      pan[p]    = vessel.getBearing() + (cut + p >= n ? 2*M_PI : 0);
+      tilt[p]   = elevation(vessel, height);
+      margin[p] = vessel.getMargin();
+    }
+
+    // sweep the boxes by their left edge: the first one must be in some
+    // picture, whose left edge can as well be the box's
+    std::vector<std::size_t> order(n);
+    for (std::size_t p = 0; p < n; ++p)
+      order[p] = p;
+    std::stable_sort(order.begin(), order.end(), 
+        [&](std::size_t a, std::size_t b) { return pan[a] - margin[a] < pan[b] - margin[b]; });
+    std::vector<double> boxLeft(n);
+    for (std::size_t r = 0; r < n; ++r)
+      boxLeft[r] = pan[order[r]] - margin[order[r]];
+
+    // next[r] leads to the first uncovered box from r, in sweep order (union-find with path halving)
+    std::vector<std::size_t> next(n+1);
+    for (std::size_t p = 0; p <= n; ++p)
+      next[p] = p;
+    auto find = [&next](std::size_t p) {
+      while (next[p] != p) {
+        next[p] = next[next[p]];
+        p = next[p];
+      }
+      return p;
+    };
+
+    std::vector<std::size_t> strip, members;                     // boxes in sweep order, and positions
+    std::vector<std::pair<double, int>> events;                  // (tilt of the window bottom, +1 or -1)
+    std::vector<RelativeVessel> buffer;
+    std::vector<std::size_t> starts;
+    buffer.reserve(n);
+
+    for (std::size_t first = find(0); first < n; first = find(first)) {
+
+      // the uncovered vessels that fit in the HFOV strip starting at the left
+      // of the anchor (none if the anchor does not)
+      const std::size_t anchor = order[first];
+      const double left = boxLeft[first];
+      strip.clear();
+      strip.push_back(first);
+      for (std::size_t r = find(first+1); 2*margin[anchor] < HFOV && r < n && boxLeft[r] - left < HFOV; r = find(r+1))
+        if (pan[order[r]] + margin[order[r]] - left < HFOV)
+          strip.push_back(r);
+
+      // the windows [bottom, bottom + VFOV] holding vessel p have their bottom in
+      // [top(p) - VFOV, bottom(p)]: take the bottom in most such ranges, the anchor's included
+      const double low  = tilt[anchor] + margin[anchor] - VFOV, high = tilt[anchor] - margin[anchor];
+      double bottom = high;
+      if (low < high && strip.size() > 1) {
+        events.clear();
+        for (std::size_t r : strip) {
+          const std::size_t p = order[r];
+          const double from = std::max(low, tilt[p] + margin[p] - VFOV), to = std::min(high, tilt[p] - margin[p]);
+          if (from <= to) {
+            events.push_back(std::make_pair(from, -1));          // openings sort first at equal tilts
+            events.push_back(std::make_pair(to, +1));
+          }
+        }
+        std::sort(events.begin(), events.end());
+        int depth = 0, deepest = 0;
+        for (auto & event : events) {
+          depth -= event.second;
+          if (depth > deepest) {
+            deepest = depth;
+            bottom = event.first;
+          }
+        }
+      }
+
+      // take the vessels that fit in that window (none if the anchor does not), 
+      // and mark them covered
+      members.clear();
+      double lowest = tilt[anchor] - margin[anchor], highest = tilt[anchor] + margin[anchor];
+      for (std::size_t r : strip) {
+        const std::size_t p = order[r];
+        // (the same test as the sweep, so that rounding cannot leave out the vessel that set bottom)
+        if (r == first || (low <= high && std::max(low, tilt[p] + margin[p] - VFOV) <= bottom 
+                                       && bottom <= std::min(high, tilt[p] - margin[p]))) {
+          members.push_back(p);
+          lowest  = std::min(lowest,  tilt[p] - margin[p]);
+          highest = std::max(highest, tilt[p] + margin[p]);
+          next[r] = r+1;
+        }
+      }
+
+      // the vessels of a picture are sorted by bearing in the buffer
+      std::sort(members.begin(), members.end());
+      starts.push_back(buffer.size());
+      for (std::size_t p : members)
+        buffer.push_back(vessels[(cut + p)%n]);
+      result.tiltDeg.push_back((lowest + highest)/2*180/M_PI);
+    }
+
+    GIMBALEDCAMERA_COUNT(Pictures, starts.size());
+    Plan::Builder builder(HFOV, std::move(buffer));
+    builder.reserve(starts.size());
+    for (std::size_t k = 0; k < starts.size(); ++k)
+      builder.addPicture(starts[k], k+1 < starts.size() ? starts[k+1] : n);
+    result.plan = builder.build();
+    return result;
+  }
+
+}
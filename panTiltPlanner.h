@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+#include <vector>
+#include "gimbaledCamera.h"
+
+#ifndef PANTILTPLANNER_H
+#define PANTILTPLANNER_H
+
+/** @file */
+
+namespace gimbaledCamera {
+
+  /** Returns the elevation of a vessel (at sea level) seen from a camera at
+   *  the given height, in radians: negative below the horizon.  The drop of
+   *  the sea surface with distance, d^2/2R, is taken into account:
+   *
+   *      elevation = -atan((height + d^2/2R)/d)
+   */
+  inline double elevation(
+      const RelativeVessel &vessel  /** the vessel */,
+      const double height           /** height of the camera above the sea, in meters */
+      ) {
+    const double d = vessel.getDistance(), earthRadius = 6371000;
+    return -std::atan2(height + d*d/(2*earthRadius), d);
+  }
+
+  /// Pictures with both a pan and a tilt angle.
+  struct PanTiltPlan {
+    Plan plan;                  ///< The pictures; their camera angles are the pan angles
+    std::vector<double> tiltDeg;///< The tilt of each picture, in degrees (negative below the horizon)
+  };
+
+  /** Groups vessels into pictures of a camera that pans and tilts.
+   *
+   *  Each vessel is a box in (pan, tilt): its bearing and elevation (see
+   *  elevation), plus or minus its margin in both directions.  A picture is
+   *  a set of vessels whose boxes fit in a rectangle of HFOV by VFOV (or a
+   *  single vessel); covering all boxes with the fewest rectangles is
+   *  NP-hard, so pictures are made greedily, sweeping the pan angle from
+   *  the widest bearing gap:
+   *
+   *  - the uncovered vessel whose box has the smallest left edge anchors the
+   *    next picture, whose left edge is the left of its box;
+   *  - among the uncovered vessels that fit in that HFOV strip, a sweep
+   *    over the tilt intervals picks the VFOV window, containing the
+   *    anchor, that holds the most vessels.
+   *
+   *  With a VFOV wide enough for all elevations, this is the optimal greedy
+   *  for covering intervals on a line (pictures need not be runs of
+   *  consecutive bearings, so there may be fewer than makeMinimalPictures
+   *  makes).  Covered vessels are skipped with a union-find over the
+   *  sweep order, so each picture costs O(k log k) for the k vessels of its
+   *  strip, and the planner O(n log n) when the vessels of a strip need a
+   *  few tilts.
+   *
+   *  The vessels of each picture are contiguous in the buffer of the plan,
+   *  sorted by bearing, so pictures are ordinary Pictures.
+   */
+  PanTiltPlan makePanTiltPictures(
+      double HFOV                         /** the camera horizontal field of view, in degrees */,
+      double VFOV                         /** the camera vertical field of view, in degrees */,
+      double height                       /** height of the camera above the sea, in meters */,
+      std::vector<RelativeVessel> vessels /** the vessels to be grouped into pictures */
+      );
+
+}
+
+#endif
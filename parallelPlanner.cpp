@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <utility>
+#include "geodesy.h"
+#include "parallelPlanner.h"
+#include "stats.h"
+
+namespace gimbaledCamera {
+
+  namespace {
+
+    const std::size_t chunkSize = 16384;   // vessels per conversion task
+
+    // A vessel to sort: ordered by bearing, then by position in the input
+    struct Key {
+      double bearing;
+      std::uint32_t index;
+
+      bool operator<(const Key &other) const {
+        return bearing < other.bearing || (!(other.bearing < bearing) && index < other.index);
+      }
+    };
+
+    // The number of elements of a among the first k of the merge of a and b:
+    // keys are distinct, so the merge is unique
+    std::size_t coRank(std::size_t k, const Key *a, std::size_t na, const Key *b, std::size_t nb) {
+      std::size_t lo = k > nb ? k - nb : 0, hi = std::min(k, na);
+      while (lo < hi) {
+        const std::size_t i = (lo + hi)/2;
+        if (a[i] < b[k-i-1])
+          lo = i + 1;
+        else
+          hi = i;
+      }
+      return lo;
+    }
+
+    // A placeholder for the slots of a vessel buffer about to be assigned
+    const RelativeVessel &emptyVessel() {
+      static const RelativeVessel vessel(0, 0, "", 0, 0, 0);
+      return vessel;
+    }
+
+  }
+
+  // Convert the vessels in chunks: the geometry of a chunk, then the vessels
+  // it keeps, at the offset given by the counts of the previous chunks
+  std::vector<RelativeVessel> makeRelativeVessels(
+      const Vessel &drone, 
+      const VesselSnapshot &snapshot, 
+      const std::vector<std::uint32_t> &ids, 
+      ThreadPool &pool, 
+      double margin, 
+      double maxRange) {
+
+    const std::size_t n = ids.size(), chunks = (n + chunkSize - 1)/chunkSize;
+    std::vector<double> lat(n), lon(n), bearing(n), dist(n), bearingMargin(n);
+    std::vector<std::size_t> kept(chunks + 1, 0);
+    pool.parallelFor(chunks, [&](std::size_t c) {
+        const std::size_t begin = c*chunkSize, end = std::min(n, begin + chunkSize);
+        for (std::size_t i = begin; i < end; ++i) {
+          lat[i] = snapshot.getLatDeg(ids[i]);
+          lon[i] = snapshot.getLonDeg(ids[i]);
+        }
+        computeRelativeBatch(drone, end - begin, &lat[begin], &lon[begin], 
+            &bearing[begin], &dist[begin], &bearingMargin[begin], margin);
+        for (std::size_t i = begin; i < end; ++i)
+          kept[c+1] += (maxRange <= 0 || dist[i] <= maxRange);
+        });
+    for (std::size_t c = 0; c < chunks; ++c)
+      kept[c+1] += kept[c];
+
+    std::vector<RelativeVessel> vessels(kept[chunks], emptyVessel());
+    pool.parallelFor(chunks, [&](std::size_t c) {
+        const std::size_t begin = c*chunkSize, end = std::min(n, begin + chunkSize);
+        std::size_t out = kept[c];
+        for (std::size_t i = begin; i < end; ++i)
+          if (maxRange <= 0 || dist[i] <= maxRange) {
+            vessels[out] = RelativeVessel(lat[i], lon[i], NameTable::global().intern(snapshot.getName(ids[i])),
+                bearing[i], dist[i], bearingMargin[i]);
+            vessels[out++].setRow(ids[i]);
+          }
+        });
+    return vessels;
+  }
+
+  void parallelSortByBearing(std::vector<RelativeVessel> &vessels, ThreadPool &pool) {
+    const std::size_t n = vessels.size(), threads = pool.size();
+    // small inputs are sorted in place; large ones through the keys, which
+    // is faster also on one thread (a vessel is moved once, not log n times)
+    if (n < 2*chunkSize) {
+      std::stable_sort(vessels.begin(), vessels.end(), gimbaledCamera::sortByBearing);
+      return;
+    }
+
+    // sort the keys of each chunk
+    std::vector<Key> keys(n), merged(n);
+    std::vector<std::size_t> bounds(threads + 1);
+    for (std::size_t t = 0; t <= threads; ++t)
+      bounds[t] = n*t/threads;
+    pool.parallelFor(threads, [&](std::size_t t) {
+        for (std::size_t i = bounds[t]; i < bounds[t+1]; ++i)
+          keys[i] = {vessels[i].getBearing(), static_cast<std::uint32_t>(i)};
+        std::sort(keys.begin() + bounds[t], keys.begin() + bounds[t+1]);
+        });
+
+    // merge the runs pairwise; each merge is split into pieces of equal
+    // output, so that every round keeps every thread busy
+    while (bounds.size() > 2) {
+      const std::size_t runs = bounds.size() - 1, pairs = runs/2;
+      const std::size_t pieces = std::max<std::size_t>(1, threads/pairs);
+      pool.parallelFor(pairs*pieces, [&](std::size_t task) {
+          const std::size_t p = task/pieces, piece = task%pieces;
+          const std::size_t begin = bounds[2*p], middle = bounds[2*p+1], end = bounds[2*p+2];
+          const Key *a = &keys[begin], *b = &keys[middle];
+          const std::size_t na = middle - begin, nb = end - middle;
+          const std::size_t k0 = (na + nb)*piece/pieces, k1 = (na + nb)*(piece+1)/pieces;
+          const std::size_t i0 = coRank(k0, a, na, b, nb), i1 = coRank(k1, a, na, b, nb);
+          std::merge(a + i0, a + i1, b + (k0 - i0), b + (k1 - i1), merged.begin() + begin + k0);
+          });
+      if (runs % 2)   // the odd run out is carried over
+        std::copy(keys.begin() + bounds[runs-1], keys.end(), merged.begin() + bounds[runs-1]);
+      keys.swap(merged);
+
+      std::vector<std::size_t> next;
+      for (std::size_t r = 0; r < runs; r += 2)
+        next.push_back(bounds[r]);
+      next.push_back(n);
+      bounds.swap(next);
+    }
+
+    // move the vessels to their place
+    std::vector<RelativeVessel> sorted(n, emptyVessel());
+    pool.parallelFor(threads, [&](std::size_t t) {
+        for (std::size_t i = n*t/threads; i < n*(t+1)/threads; ++i)
+          sorted[i] = std::move(vessels[keys[i].index]);
+        });
+    vessels.swap(sorted);
+  }
+
+  // Produce the pictures of makePictures, sorting on the pool
+  Plan makePictures(double FOV, std::vector<RelativeVessel> vessels, ThreadPool &pool) {
+
+    FOV *= M_PI/180;                                                         // convert field of view from degrees to radians
+    GIMBALEDCAMERA_COUNT(Vessels, vessels.size());
+    {
+      GIMBALEDCAMERA_TIME(Sort);
+      parallelSortByBearing(vessels, pool);
+    }
+    Plan::Builder builder(FOV, std::move(vessels));
+    builder.addBins();
+    return builder.build();
+  }
+
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "gimbaledCamera.h"
+#include "threadPool.h"
+#include "vesselIO.h"
+
+#ifndef PARALLELPLANNER_H
+#define PARALLELPLANNER_H
+
+/** @file 
+ *  The stages of makePictures, on a thread pool, for fleets of millions of
+ *  vessels.
+ *
+ *  Each stage gives results bit-identical to its serial counterpart, for
+ *  any number of threads: the geometry of a vessel does not depend on the
+ *  batch it is computed in, and the sort orders vessels by bearing and then
+ *  by position in the input, which is the order std::stable_sort gives.
+ */
+
+namespace gimbaledCamera {
+
+  /** Computes the bearing, distance and margin of the given vessels of a
+   *  snapshot and builds their RelativeVessels, in chunks on the thread
+   *  pool.  With a maxRange, only the vessels within maxRange of the drone
+   *  are kept.  The result is in the order of ids, and equal to building
+   *  each vessel from computeRelativeBatch; the row of each vessel is its
+   *  index in the snapshot.
+   */
+  std::vector<RelativeVessel> makeRelativeVessels(
+      const Vessel &drone                    /** drone instance */,
+      const VesselSnapshot &snapshot         /** the vessels */,
+      const std::vector<std::uint32_t> &ids  /** the vessels to convert, by index in the snapshot */,
+      ThreadPool &pool                       /** the threads to convert on */,
+      double margin=100                      /** the radius of the region around each vessel we want to capture, in meters */,
+      double maxRange=0                      /** the maximum distance of a vessel, in meters; 0 for any */
+      );
+
+  /** Sorts the vessels by bearing on the thread pool, in the same order as
+   *  std::stable_sort with sortByBearing.  The (bearing, index) keys are
+   *  sorted in one chunk per thread, the chunks are merged pairwise (each
+   *  merge split among the threads at its median ranks), and the vessels
+   *  are then moved to their place in parallel.
+   */
+  void parallelSortByBearing(
+      std::vector<RelativeVessel> &vessels   /** the vessels to sort */,
+      ThreadPool &pool                       /** the threads to sort on */
+      );
+
+  /// Same as makePictures, with the sort on the thread pool.  The plan is identical.
+  Plan makePictures(
+      double FOV                             /** the camera field of view, in degrees */,
+      std::vector<RelativeVessel> vessels    /** the vessels to be partitioned into pictures */,
+      ThreadPool &pool                       /** the threads to sort on */
+      );
+
+}
+
+#endif
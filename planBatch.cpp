@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string>
+#include <utility>
+#include "geodesy.h"
+#include "planBatch.h"
+
+namespace gimbaledCamera {
+
+  // Plan one observer: batch geometry, then makePictures
+  Plan planObserver(const Observer &observer, const VesselSnapshot &snapshot) {
+    const std::size_t n = snapshot.size();
+    std::vector<double> bearing(n), dist(n), bearingMargin(n);
+    computeRelativeBatch(observer.drone, n, snapshot.getLats(), snapshot.getLons(),
+        bearing.data(), dist.data(), bearingMargin.data(), observer.margin);
+
+    std::vector<RelativeVessel> vessels;
+    vessels.reserve(n);
+    for (std::size_t i = 0; i < n; ++i)
+      vessels.emplace_back(snapshot.getLatDeg(i), snapshot.getLonDeg(i), NameTable::global().intern(snapshot.getName(i)),
+          bearing[i], dist[i], bearingMargin[i]);
+
+    return makePictures(observer.FOV, std::move(vessels));
+  }
+
+  // Plan one observer over the candidates of the index: batch geometry of the
+  // candidates, then makePictures of those within range
+  Plan planObserver(const Observer &observer, const VesselSnapshot &snapshot, const SpatialIndex &index, double maxRange) {
+    std::vector<std::uint32_t> ids;
+    index.query(observer.drone, maxRange, ids);
+
+    const std::size_t n = ids.size();
+    std::vector<double> lat(n), lon(n), bearing(n), dist(n), bearingMargin(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      lat[i] = snapshot.getLatDeg(ids[i]);
+      lon[i] = snapshot.getLonDeg(ids[i]);
+    }
+    computeRelativeBatch(observer.drone, n, lat.data(), lon.data(),
+        bearing.data(), dist.data(), bearingMargin.data(), observer.margin);
+
+    std::vector<RelativeVessel> vessels;
+    vessels.reserve(n);
+    for (std::size_t i = 0; i < n; ++i)
+      if (dist[i] <= maxRange)
+        vessels.emplace_back(lat[i], lon[i], NameTable::global().intern(snapshot.getName(ids[i])),
+            bearing[i], dist[i], bearingMargin[i]);
+
+    return makePictures(observer.FOV, std::move(vessels));
+  }
+
+  // Plan every observer, one task each
+  std::vector<Plan> planBatch(const std::vector<Observer> &observers, const VesselSnapshot &snapshot, ThreadPool &pool) {
+    std::vector<Plan> plans(observers.size());
+    pool.parallelFor(observers.size(), [&](std::size_t i) {
+        plans[i] = planObserver(observers[i], snapshot);
+        });
+    return plans;
+  }
+
+  std::vector<Plan> planBatch(const std::vector<Observer> &observers, const VesselSnapshot &snapshot, std::size_t threads) {
+    ThreadPool pool(threads);
+    return planBatch(observers, snapshot, pool);
+  }
+
+  std::vector<Plan> planBatch(const std::vector<Observer> &observers, const VesselSnapshot &snapshot, 
+      const SpatialIndex &index, double maxRange, ThreadPool &pool) {
+    std::vector<Plan> plans(observers.size());
+    pool.parallelFor(observers.size(), [&](std::size_t i) {
+        plans[i] = planObserver(observers[i], snapshot, index, maxRange);
+        });
+    return plans;
+  }
+
+}
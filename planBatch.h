@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstddef>
+#include <vector>
+#include "gimbaledCamera.h"
+#include "spatialIndex.h"
+#include "threadPool.h"
+#include "vesselIO.h"
+
+#ifndef PLANBATCH_H
+#define PLANBATCH_H
+
+/** @file */
+
+namespace gimbaledCamera {
+
+  /// A camera platform: the drone the bearings are relative to, and its camera.
+  struct Observer {
+    Vessel drone;      ///< The vessel carrying the camera
+    double FOV;        ///< The camera field of view, in degrees
+    double margin;     ///< The radius of the region around each vessel we want to capture, in meters
+  };
+
+  /** Plans the pictures of one observer over a snapshot of vessels, as
+   *  makePictures does.  The geometry is computed by computeRelativeBatch
+   *  directly from the snapshot columns.  The observer itself should not be
+   *  part of the snapshot.
+   */
+  Plan planObserver(
+      const Observer &observer         /** the camera platform */,
+      const VesselSnapshot &snapshot   /** the vessels to photograph */
+      );
+
+  /** Plans the pictures of one observer over the vessels of a snapshot
+   *  within maxRange of it.  Only the vessels the index returns for the
+   *  range circle are converted, so the result is that of planObserver on
+   *  the vessels within range, at a cost independent of the size of the
+   *  snapshot.  The index must have been built from (or updated to) the
+   *  snapshot.
+   */
+  Plan planObserver(
+      const Observer &observer         /** the camera platform */,
+      const VesselSnapshot &snapshot   /** the vessels to photograph */,
+      const SpatialIndex &index        /** the index of the snapshot */,
+      double maxRange                  /** the camera range, in meters */
+      );
+
+  /** Plans the pictures of several observers over a shared snapshot, in
+   *  parallel.  Each observer is an independent task on the thread pool, so
+   *  result i is identical to planObserver(observers[i], snapshot).
+   */
+  std::vector<Plan> planBatch(
+      const std::vector<Observer> &observers /** the camera platforms */,
+      const VesselSnapshot &snapshot         /** the vessels to photograph */,
+      ThreadPool &pool                       /** the threads to plan on */
+      );
+
+  /// Same as above, on a temporary pool of the given number of threads (0 for one per core).
+  std::vector<Plan> planBatch(
+      const std::vector<Observer> &observers,
+      const VesselSnapshot &snapshot,
+      std::size_t threads=0
+      );
+
+  /// Plans several observers in parallel, each over the vessels of the snapshot within maxRange of it.
+  std::vector<Plan> planBatch(
+      const std::vector<Observer> &observers /** the camera platforms */,
+      const VesselSnapshot &snapshot         /** the vessels to photograph */,
+      const SpatialIndex &index              /** the index of the snapshot */,
+      double maxRange                        /** the camera range, in meters */,
+      ThreadPool &pool                       /** the threads to plan on */
+      );
+
+}
+
+#endif
@@ -0,0 +1,371 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "planDaemon.h"
+#include "scheduleWriter.h"
+#include "stats.h"
+
+namespace gimbaledCamera {
+
+  PlanBuffer::Reader PlanBuffer::read() const {
+    while (true) {
+      const unsigned index = current.load();
+      slots[index].readers.fetch_add(1);
+      // the slot may have been made the next one meanwhile: only read it if it is still current
+      if (current.load() == index)
+        return Reader(&slots[index]);
+      slots[index].readers.fetch_sub(1);
+    }
+  }
+
+  void PlanBuffer::publish(const Schedule &schedule, std::size_t vessels) {
+    const unsigned index = current.load(std::memory_order_relaxed);
+    Slot &next = slots[1 - index];
+    // wait for the readers of the previous plan (they registered before it was replaced)
+    while (next.readers.load() != 0)
+      std::this_thread::yield();
+
+    next.plan.sequence = slots[index].plan.sequence + 1;
+    next.plan.vessels = vessels;
+    next.plan.triggerAngleDeg.clear();
+    next.plan.time.clear();
+    for (auto & capture : schedule.captures) {
+      next.plan.triggerAngleDeg.push_back(capture.triggerAngleDeg);
+      next.plan.time.push_back(capture.time);
+    }
+    next.plan.totalTime = schedule.totalTime;
+    current.store(1 - index);
+  }
+
+  namespace {
+
+    [[noreturn]] void fail(const std::string &what, const std::string &path) {
+      throw std::runtime_error(what + " " + path + ": " + strerror(errno));
+    }
+
+    // A sockaddr_un for path, which must fit in sun_path
+    sockaddr_un socketAddress(const std::string &path) {
+      sockaddr_un address;
+      std::memset(&address, 0, sizeof(address));
+      address.sun_family = AF_UNIX;
+      if (path.size() >= sizeof(address.sun_path))
+        throw std::runtime_error("socket path too long: " + path);
+      std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+      return address;
+    }
+
+    inline bool isSpace(char c) {
+      return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+  }
+
+  PlanDaemon::PlanDaemon(const std::string &pathin, const double rate, const double FOVin, 
+      const double marginin, const double gimbalAngleDegin, const SlewModel &modelin, const std::size_t maxNewNamesin) :
+    path(pathin), isFifo(false), listenFd(-1), wakeFd{-1, -1}, stopping(false),
+    period(std::chrono::nanoseconds(std::int64_t(1e9/rate))), FOV(FOVin), margin(marginin), 
+    gimbalAngleDeg(gimbalAngleDegin), model(modelin), maxNewNames(maxNewNamesin), newNames(0),
+    droneLat(0), droneLon(0), droneMoved(false), changed(false), updates(0), malformed(0), rejected(0) {
+
+    if (!(rate > 0))
+      throw std::runtime_error("the plan rate must be positive");
+    if (pipe(wakeFd) != 0)
+      fail("cannot create the wake pipe for", path);
+    fcntl(wakeFd[1], F_SETFL, O_NONBLOCK);
+
+    struct stat status;
+    isFifo = stat(path.c_str(), &status) == 0 && S_ISFIFO(status.st_mode);
+    if (isFifo) {
+      // opened for writing too, so that the FIFO stays open when writers come and go
+      const int fd = open(path.c_str(), O_RDWR | O_NONBLOCK);
+      if (fd < 0)
+        fail("cannot open", path);
+      connections.push_back({fd, std::string(), false});
+      return;
+    }
+
+    const sockaddr_un address = socketAddress(path);
+    if (stat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode))
+      unlink(path.c_str());    // left behind by a daemon that did not exit cleanly
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0 || bind(listenFd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 
+        || listen(listenFd, 16) != 0) {
+      const int error = errno;
+      if (listenFd >= 0)
+        close(listenFd);
+      close(wakeFd[0]);
+      close(wakeFd[1]);
+      errno = error;
+      fail("cannot listen on", path);
+    }
+    fcntl(listenFd, F_SETFL, O_NONBLOCK);
+  }
+
+  PlanDaemon::~PlanDaemon() {
+    for (auto & connection : connections)
+      close(connection.fd);
+    if (listenFd >= 0) {
+      close(listenFd);
+      unlink(path.c_str());
+    }
+    close(wakeFd[0]);
+    close(wakeFd[1]);
+  }
+
+  void PlanDaemon::stop() {
+    // a signal handler must leave errno as it found it
+    const int error = errno;
+    stopping.store(true);
+    const char byte = 0;
+    if (write(wakeFd[1], &byte, 1) < 0) {
+      // the pipe is full: run is being woken already
+    }
+    errno = error;
+  }
+
+  void PlanDaemon::run() {
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point nextPlan = Clock::now();
+    std::vector<pollfd> fds;
+
+    while (!stopping.load()) {
+      // wait for input, or for the next plan if anything changed
+      int timeout = -1;
+      if (changed) {
+        const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(nextPlan - Clock::now()).count();
+        timeout = wait > 0 ? int(wait) : 0;
+      }
+      fds.clear();
+      fds.push_back({wakeFd[0], POLLIN, 0});
+      if (listenFd >= 0)
+        fds.push_back({listenFd, POLLIN, 0});
+      for (auto & connection : connections)
+        fds.push_back({connection.fd, POLLIN, 0});
+      if (poll(fds.data(), fds.size(), timeout) < 0 && errno != EINTR)
+        fail("cannot poll", path);
+
+      // read the clients first, as accept adds to them
+      const std::size_t first = listenFd >= 0 ? 2 : 1;
+      for (std::size_t i = connections.size(); i-- > 0; )
+        if (fds[first + i].revents && !receive(connections[i])) {
+          close(connections[i].fd);
+          connections.erase(connections.begin() + i);
+        }
+      if (listenFd >= 0 && fds[1].revents) {
+        int fd;
+        while ((fd = accept(listenFd, nullptr, nullptr)) >= 0) {
+          fcntl(fd, F_SETFL, O_NONBLOCK);
+          connections.push_back({fd, std::string(), false});
+        }
+      }
+
+      const Clock::time_point now = Clock::now();
+      if (changed && now >= nextPlan) {
+        replan();
+        // keep the rate, unless planning fell behind it
+        nextPlan = std::max(nextPlan + period, now);
+      }
+    }
+
+    // the stop request has been seen: empty the wake pipe
+    char bytes[64];
+    while (read(wakeFd[0], bytes, sizeof(bytes)) == sizeof(bytes)) {}
+  }
+
+  bool PlanDaemon::receive(Connection &connection) {
+    char buffer[1 << 16];
+    while (true) {
+      const ssize_t n = read(connection.fd, buffer, sizeof(buffer));
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        return true;
+      if (n <= 0) {
+        // end of input: the last line may have no line break
+        if (!connection.overflowed && !connection.pending.empty())
+          apply(connection.pending.data(), connection.pending.data() + connection.pending.size());
+        connection.pending.clear();
+        return false;
+      }
+
+      // apply the complete lines, and keep the rest for the next read; lines
+      // spanning two reads are assembled in pending, the others read in place
+      const char *p = buffer, *end = buffer + n;
+      const char *lineEnd = static_cast<const char *>(std::memchr(p, '\n', end - p));
+      if (lineEnd && (connection.overflowed || !connection.pending.empty())) {
+        if (!connection.overflowed) {            // an overflowed line was counted already
+          connection.pending.append(p, lineEnd);
+          apply(connection.pending.data(), connection.pending.data() + connection.pending.size());
+        }
+        connection.pending.clear();
+        connection.overflowed = false;
+        p = lineEnd + 1;
+        lineEnd = static_cast<const char *>(std::memchr(p, '\n', end - p));
+      }
+      for (; lineEnd; lineEnd = static_cast<const char *>(std::memchr(p, '\n', end - p))) {
+        apply(p, lineEnd);
+        p = lineEnd + 1;
+      }
+
+      // a line too long to be an update is dropped up to its line break
+      if (!connection.overflowed && connection.pending.size() + (end - p) > maxLineLength) {
+        malformed.fetch_add(1, std::memory_order_relaxed);
+        connection.pending.clear();
+        connection.overflowed = true;
+      }
+      if (!connection.overflowed)
+        connection.pending.append(p, end);
+    }
+  }
+
+  void PlanDaemon::apply(const char *begin, const char *end) {
+    if (std::size_t(end - begin) > maxLineLength) {
+      malformed.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    // split the line in at most three fields (and a fourth to detect extra ones)
+    const char *field[4], *fieldEnd[4];
+    int fields = 0;
+    for (const char *p = begin; p < end && fields < 4; ) {
+      for (; p < end && isSpace(*p); ++p) {}
+      if (p == end)
+        break;
+      field[fields] = p;
+      for (; p < end && !isSpace(*p); ++p) {}
+      fieldEnd[fields++] = p;
+    }
+    if (fields == 0)
+      return;
+
+    const std::string name(field[0], fieldEnd[0]);
+    if (fields == 1) {
+      if (planner && name != droneName && planner->remove(name))
+        changed = true;
+      updates.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    // latitude and longitude, which must be numbers and nothing else
+    double position[2];
+    bool ok = fields == 3;
+    for (int k = 0; ok && k < 2; ++k) {
+      char number[64];
+      const std::size_t length = fieldEnd[k+1] - field[k+1];
+      ok = length < sizeof(number);
+      if (ok) {
+        std::memcpy(number, field[k+1], length);
+        number[length] = '\0';
+        char *stop;
+        position[k] = strtod(number, &stop);
+        ok = stop == number + length && std::isfinite(position[k]);
+      }
+    }
+    ok = ok && std::fabs(position[0]) <= 90 && std::fabs(position[1]) <= 360;
+    if (!ok) {
+      malformed.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    // names are never freed: bound the ones this daemon adds
+    if (!NameTable::global().contains(name)) {
+      if (newNames >= maxNewNames) {
+        rejected.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      ++newNames;
+    }
+
+    GIMBALEDCAMERA_COUNT(Updates, 1);
+    updates.fetch_add(1, std::memory_order_relaxed);
+    changed = true;
+    if (droneName.empty() || name == droneName) {
+      droneName = name;
+      droneLat = position[0];
+      droneLon = position[1];
+      droneMoved = true;
+      if (!planner)
+        planner.reset(new IncrementalPlanner(FOV, Vessel(droneLat, droneLon, droneName), margin));
+    } else {
+      planner->insert(name, position[0], position[1]);
+    }
+  }
+
+  void PlanDaemon::replan() {
+    GIMBALEDCAMERA_TIME(Replan);
+    if (droneMoved) {
+      planner->setDrone(Vessel(droneLat, droneLon, droneName));
+      droneMoved = false;
+    }
+    const Plan plan = planner->getPictures();
+    plans.publish(schedulePictures(plan, gimbalAngleDeg, model), planner->countVessels());
+    changed = false;
+  }
+
+  int connectDaemon(const std::string &path) {
+    struct stat status;
+    if (stat(path.c_str(), &status) == 0 && S_ISFIFO(status.st_mode)) {
+      const int fd = open(path.c_str(), O_WRONLY);
+      if (fd < 0)
+        fail("cannot open", path);
+      return fd;
+    }
+
+    const sockaddr_un address = socketAddress(path);
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+      const int error = errno;
+      if (fd >= 0)
+        close(fd);
+      errno = error;
+      fail("cannot connect to", path);
+    }
+    return fd;
+  }
+
+  void sendUpdates(int fd, const VesselSnapshot &snapshot) {
+    BufferedWriter output(fd);
+    for (std::size_t i = 0; i < snapshot.size(); ++i) {
+      output.write(snapshot.getName(i));
+      output.write(' ');
+      output.writeNumber(snapshot.getLatDeg(i));
+      output.write(' ');
+      output.writeNumber(snapshot.getLonDeg(i));
+      output.write('\n');
+    }
+    output.flush();
+  }
+
+}
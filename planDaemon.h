@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "gimbaledCamera.h"
+#include "incrementalPlanner.h"
+#include "slewScheduler.h"
+#include "vesselIO.h"
+
+#ifndef PLANDAEMON_H
+#define PLANDAEMON_H
+
+/** @file 
+ *  A long-running planner fed with live vessel updates.
+ *
+ *  PlanDaemon listens on a Unix domain socket (or reads a FIFO) for lines
+ *  in the format of test1.dat, one update per line:
+ *
+ *      Neo 37.77308 -122.33451     adds or moves the vessel Neo
+ *      Neo                         removes it
+ *
+ *  The first vessel received is the drone.  The updates are applied to an
+ *  IncrementalPlanner as they arrive, and the plan is rescheduled and
+ *  published at a fixed rate through a PlanBuffer, from which the gimbal
+ *  controller reads the trigger angles without locking.
+ *
+ *  Vessel names are interned in NameTable::global(), which never frees
+ *  them: removing a vessel does not release its name, so the memory of a
+ *  long-running daemon grows with the number of distinct names received.
+ *  The daemon therefore adds at most maxNewNames names to the table;
+ *  updates of further new vessels are counted and ignored.
+ */
+
+namespace gimbaledCamera {
+
+  /// A published capture schedule.
+  struct PublishedPlan {
+    std::uint64_t sequence = 0;            ///< Number of plans published up to this one (0: none yet)
+    std::size_t vessels = 0;               ///< Number of vessels planned
+    std::vector<double> triggerAngleDeg;   ///< Trigger angles, in capture order
+    std::vector<double> time;              ///< Time at which each picture is done, in seconds
+    double totalTime = 0;                  ///< Time to take all pictures, in seconds
+  };
+
+  /** The latest plan, published by one thread and read by any number of
+   *  others without locks.
+   *
+   *  Two slots alternate, each with a count of its readers.  A reader
+   *  registers on the current slot and checks that it is still current (it
+   *  retries otherwise, which only happens if a plan is published at that
+   *  very moment); it then reads the slot in place until the Reader is
+   *  destroyed.  The publisher fills the other slot, after waiting for its
+   *  last readers to leave, and makes it current.  Readers never wait and
+   *  never allocate; the slots keep their capacity, so publishing does not
+   *  allocate once the plans stop growing.
+   */
+  class PlanBuffer {
+
+    private:
+
+      /// A slot and its readers.
+      struct Slot {
+        PublishedPlan plan;
+        std::atomic<std::uint32_t> readers{0};
+      };
+
+    public:
+
+      /// Read access to the current plan, which is not replaced while the Reader lives.
+      class Reader {
+
+        public:
+
+          Reader(const Reader &) = delete;
+          Reader &operator=(const Reader &) = delete;
+
+          ~Reader() {
+            slot->readers.fetch_sub(1);
+          };
+
+          const PublishedPlan &operator*() const { return slot->plan; };
+          const PublishedPlan *operator->() const { return &slot->plan; };
+
+        private:
+
+          explicit Reader(Slot *slotin) : slot(slotin) {};
+
+          Slot *slot;   ///< The slot being read
+
+          friend class PlanBuffer;
+
+      };
+
+      /// Class constructor (sequence 0, no captures).
+      PlanBuffer() : current(0) {};
+
+      PlanBuffer(const PlanBuffer &) = delete;
+      PlanBuffer &operator=(const PlanBuffer &) = delete;
+
+      /// Returns read access to the current plan (lock-free, any thread).
+      Reader read() const;
+
+      /// Publishes a schedule (from one thread at a time).
+      void publish(
+          const Schedule &schedule  /** the schedule to publish */,
+          std::size_t vessels       /** number of vessels planned */
+          );
+
+    private:
+
+      mutable Slot slots[2];              ///< The current plan and the next one
+      std::atomic<unsigned> current;      ///< Index of the current slot
+
+  };
+
+  /** A planner daemon: see the file description.
+   *
+   *  The constructor opens the input, run serves it until stop is called.
+   *  If the path is an existing FIFO it is read; otherwise a Unix domain
+   *  socket is created there (replacing a stale one), and any number of
+   *  clients may connect and send updates.  Malformed lines, and lines longer
+   *  than maxLineLength, are counted and ignored.  Drone moves are applied
+   *  once per plan, since each one recomputes every bearing.
+   */
+  class PlanDaemon {
+
+    public:
+
+      /// Class constructor.  Throws std::runtime_error if the input cannot be opened.
+      explicit PlanDaemon(
+          const std::string &path       /** Unix domain socket to create, or FIFO to read */,
+          const double rate=10          /** plans published per second (at most: only after updates) */,
+          const double FOV=80           /** the camera field of view, in degrees */,
+          const double margin=100       /** the radius of the region around each vessel we want to capture, in meters */,
+          const double gimbalAngleDeg=0 /** the trigger angle each schedule starts from, clockwise from North */,
+          const SlewModel &model=SlewModel() /** the gimbal dynamics */,
+          const std::size_t maxNewNames=1<<20 /** the most names added to NameTable::global() */
+          );
+
+      /// Closes the input (and removes the socket).
+      ~PlanDaemon();
+
+      PlanDaemon(const PlanDaemon &) = delete;
+      PlanDaemon &operator=(const PlanDaemon &) = delete;
+
+      /// Serves updates and publishes plans until stop is called.
+      void run();
+
+      /// Makes run return; callable from any thread, or from a signal handler.
+      void stop();
+
+      /// The longest line accepted, in bytes; longer ones are malformed.
+      static constexpr std::size_t maxLineLength = 1 << 12;
+
+      /// Returns the published plans.
+      inline const PlanBuffer &getPlans() const {
+        return plans;
+      };
+
+      /// Returns the number of updates applied.
+      inline std::uint64_t countUpdates() const {
+        return updates.load(std::memory_order_relaxed);
+      };
+
+      /// Returns the number of malformed lines ignored.
+      inline std::uint64_t countMalformed() const {
+        return malformed.load(std::memory_order_relaxed);
+      };
+
+      /// Returns the number of updates of new vessels ignored once maxNewNames names were added.
+      inline std::uint64_t countRejected() const {
+        return rejected.load(std::memory_order_relaxed);
+      };
+
+    private:
+
+      /// A client connection, or the FIFO, and its incomplete last line.
+      struct Connection {
+        int fd;
+        std::string pending;
+        bool overflowed;           ///< True while dropping a line longer than maxLineLength
+      };
+
+      bool receive(Connection &connection);      ///< Reads and applies what is available; false at end of input
+      void apply(const char *begin, const char *end); ///< Applies one line
+      void replan();                             ///< Schedules the current vessels and publishes them
+
+      std::string path;            ///< The socket or FIFO
+      bool isFifo;                 ///< True if reading a FIFO
+      int listenFd;                ///< The listening socket, or -1
+      int wakeFd[2];               ///< Pipe used by stop to wake run
+      std::atomic<bool> stopping;  ///< Set by stop
+
+      std::chrono::nanoseconds period; ///< Time between plans
+      double FOV;                  ///< The camera field of view, in degrees
+      double margin;               ///< The radius captured around each vessel, in meters
+      double gimbalAngleDeg;       ///< The trigger angle schedules start from
+      SlewModel model;             ///< The gimbal dynamics
+      std::size_t maxNewNames;     ///< The most names added to NameTable::global()
+      std::size_t newNames;        ///< Names added to NameTable::global() so far
+
+      std::vector<Connection> connections;          ///< The clients (or the FIFO)
+      std::string droneName;                        ///< Name of the drone, the first vessel received
+      double droneLat, droneLon;                    ///< Latest drone position, in degrees
+      bool droneMoved;                              ///< True if the drone moved since the last plan
+      std::unique_ptr<IncrementalPlanner> planner;  ///< The vessels, once the drone is known
+      bool changed;                                 ///< True if anything changed since the last plan
+
+      PlanBuffer plans;                          ///< The published plans
+      std::atomic<std::uint64_t> updates;        ///< Updates applied
+      std::atomic<std::uint64_t> malformed;      ///< Malformed lines ignored
+      std::atomic<std::uint64_t> rejected;       ///< Updates of new vessels ignored beyond maxNewNames
+
+  };
+
+  /// Connects to a PlanDaemon's socket, or opens its FIFO for writing.  Throws std::runtime_error on failure.
+  int connectDaemon(const std::string &path);
+
+  /// Sends every vessel of a snapshot as an update line.  Throws std::runtime_error on failure.
+  void sendUpdates(int fd, const VesselSnapshot &snapshot);
+
+}
+
+#endif
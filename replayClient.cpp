@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "planDaemon.h"
+#include "vesselIO.h"
+
+// Replays snapshots (text or binary, e.g. test1.dat) to a running planner
+// daemon: each file is one frame of updates, sent at the given rate, and the
+// whole sequence is sent the given number of times.
+int main(int argc, char **argv) {
+
+  std::vector<std::string> paths;
+  double rate = 1;
+  long repeat = 1;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.compare(0, 7, "--rate=") == 0)
+      rate = atof(arg.c_str() + 7);
+    else if (arg.compare(0, 9, "--repeat=") == 0)
+      repeat = atol(arg.c_str() + 9);
+    else
+      paths.push_back(arg);
+  }
+  if (paths.size() < 2 || !(rate > 0) || repeat < 1) {
+    std::cerr << "usage: " << argv[0] << " SOCKET FILE... [--rate=FRAMES_PER_SECOND] [--repeat=N]\n"
+      "  sends each snapshot FILE to the planner daemon (./main --daemon=SOCKET), one frame at a time\n";
+    return 2;
+  }
+
+  // a daemon that exits must not kill the client
+  signal(SIGPIPE, SIG_IGN);
+
+  try {
+    std::vector<gimbaledCamera::VesselSnapshot> frames;
+    for (std::size_t k = 1; k < paths.size(); ++k)
+      frames.push_back(gimbaledCamera::loadSnapshot(paths[k]));
+
+    const int fd = gimbaledCamera::connectDaemon(paths[0]);
+    const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1/rate));
+    auto next = std::chrono::steady_clock::now();
+    std::size_t sent = 0;
+    for (long r = 0; r < repeat; ++r)
+      for (auto & frame : frames) {
+        std::this_thread::sleep_until(next);
+        next += period;
+        gimbaledCamera::sendUpdates(fd, frame);
+        sent += frame.size();
+      }
+    close(fd);
+    std::cout << sent << " updates sent to " << paths[0] << std::endl;
+  } catch (const std::exception &e) {
+    std::cerr << argv[0] << ": " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
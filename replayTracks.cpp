@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "tracks.h"
+
+// Replays a track file (or a synthetic harbour) through the planner, and
+// reports the plan rate, the frame latency and how often pictures changed.
+int main(int argc, char **argv) {
+
+  std::string path, save;
+  bool harbour = false, usage = false;
+  gimbaledCamera::HarbourScenario scenario;
+  gimbaledCamera::ReplayOptions options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--harbour")
+      harbour = true;
+    else if (arg.compare(0, 10, "--vessels=") == 0)
+      scenario.vessels = atol(arg.c_str() + 10);
+    else if (arg.compare(0, 11, "--duration=") == 0)
+      scenario.duration = atof(arg.c_str() + 11);
+    else if (arg.compare(0, 7, "--seed=") == 0)
+      scenario.seed = atol(arg.c_str() + 7);
+    else if (arg.compare(0, 7, "--save=") == 0)
+      save = arg.substr(7);
+    else if (arg.compare(0, 7, "--rate=") == 0)
+      options.frameRate = atof(arg.c_str() + 7);
+    else if (arg.compare(0, 8, "--speed=") == 0)
+      options.speedup = atof(arg.c_str() + 8);
+    else if (arg.compare(0, 6, "--fov=") == 0)
+      options.FOV = atof(arg.c_str() + 6);
+    else if (arg.compare(0, 8, "--drone=") == 0)
+      options.drone = arg.substr(8);
+    else if (path.empty() && arg.compare(0, 2, "--") != 0)
+      path = arg;
+    else
+      usage = true;
+  }
+  if (usage || harbour == !path.empty() || !(options.frameRate > 0) || options.speedup < 0) {
+    std::cerr << "usage: " << argv[0] << " FILE|--harbour [--rate=PLANS_PER_SECOND] [--speed=X] [--fov=DEGREES] [--drone=NAME]\n"
+      "         [--vessels=N] [--duration=SECONDS] [--seed=N] [--save=FILE]\n"
+      "  replays the track FILE (time name lat lon [course speed] per line), or a synthetic\n"
+      "  harbour, through the planner; --speed=0 replays as fast as possible, --save writes\n"
+      "  the harbour tracks to FILE\n";
+    return 2;
+  }
+
+  try {
+    const std::vector<gimbaledCamera::TrackPoint> points = harbour ? 
+      gimbaledCamera::makeHarbourTracks(scenario) : gimbaledCamera::loadTracks(path);
+    if (!save.empty())
+      gimbaledCamera::saveTracks(points, save);
+    std::cout << points.size() << " reports" << std::endl << gimbaledCamera::replayTracks(points, options);
+  } catch (const std::exception &e) {
+    std::cerr << argv[0] << ": " << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
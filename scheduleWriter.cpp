@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <unistd.h>
+#include "scheduleWriter.h"
+
+namespace gimbaledCamera {
+
+  OutputFormat outputFormat(const std::string &name) {
+    if (name == "csv")
+      return OutputFormat::CSV;
+    if (name == "jsonl")
+      return OutputFormat::JSONLines;
+    if (name == "binary")
+      return OutputFormat::Binary;
+    throw std::invalid_argument("unknown output format: " + name + " (csv, jsonl or binary)");
+  }
+
+  // Class constructor for BufferedWriter
+  BufferedWriter::BufferedWriter(int fdin, std::size_t capacity) : fd(fdin), buffer(capacity), used(0) {
+  }
+
+  BufferedWriter::~BufferedWriter() {
+    try {
+      flush();
+    } catch (const std::exception &) {
+    }
+  }
+
+  void BufferedWriter::flush() {
+    std::size_t done = 0;
+    while (done < used) {
+      const ssize_t n = ::write(fd, buffer.data() + done, used - done);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n < 0) {
+        used = 0;
+        throw std::runtime_error(std::string("write failed: ") + strerror(errno));
+      }
+      done += n;
+    }
+    used = 0;
+  }
+
+  void BufferedWriter::writeSlow(const void *data, std::size_t n) {
+    flush();
+    if (n <= buffer.size()) {
+      std::memcpy(buffer.data(), data, n);
+      used = n;
+      return;
+    }
+    // larger than the buffer: write it as it is
+    const char *bytes = static_cast<const char *>(data);
+    while (n > 0) {
+      const std::size_t chunk = std::min(n, buffer.size());
+      std::memcpy(buffer.data(), bytes, chunk);
+      used = chunk;
+      flush();
+      bytes += chunk;
+      n -= chunk;
+    }
+  }
+
+  void BufferedWriter::writeNumber(double value) {
+    char text[32];
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    const std::to_chars_result result = std::to_chars(text, text + sizeof(text), value);
+    write(text, result.ptr - text);
+#else
+    write(text, snprintf(text, sizeof(text), "%.17g", value));
+#endif
+  }
+
+  void BufferedWriter::writeNumber(std::uint64_t value) {
+    char text[24];
+    const std::to_chars_result result = std::to_chars(text, text + sizeof(text), value);
+    write(text, result.ptr - text);
+  }
+
+  namespace {
+
+    // A CSV field: quoted, with quotes doubled, if it contains a comma, a quote or a line break
+    void writeCsvField(BufferedWriter &output, std::string_view field) {
+      if (field.find_first_of(",\"\r\n") == std::string_view::npos)
+        return output.write(field);
+      output.write('"');
+      for (char c : field) {
+        if (c == '"')
+          output.write('"');
+        output.write(c);
+      }
+      output.write('"');
+    }
+
+    // A JSON string, with quotes, backslashes and control characters escaped
+    void writeJsonString(BufferedWriter &output, std::string_view text) {
+      output.write('"');
+      for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+          output.write('\\');
+          output.write(char(c));
+        } else if (c < 0x20) {
+          char escape[8];
+          output.write(escape, snprintf(escape, sizeof(escape), "\\u%04x", c));
+        } else
+          output.write(char(c));
+      }
+      output.write('"');
+    }
+
+    template<class T> void writeBinary(BufferedWriter &output, T value) {
+      output.write(&value, sizeof(value));
+    }
+
+  }
+
+  void writeScheduleHeader(BufferedWriter &output, OutputFormat format) {
+    switch (format) {
+      case OutputFormat::CSV:
+        output.write("frame,capture,trigger_angle_deg,time_s,vessel\n");
+        break;
+      case OutputFormat::JSONLines:
+        break;
+      case OutputFormat::Binary:
+        output.write("GCSC", 4);
+        writeBinary<std::uint32_t>(output, 2);
+        break;
+    }
+  }
+
+  void writeScheduleFrame(BufferedWriter &output, const Plan &plan, const Schedule &schedule, OutputFormat format, 
+      std::uint64_t frame) {
+    switch (format) {
+
+      case OutputFormat::CSV:
+        for (std::size_t k = 0; k < schedule.captures.size(); ++k) {
+          const ScheduledCapture &capture = schedule.captures[k];
+          for (auto & vessel : plan[capture.picture].getVessels()) {
+            output.writeNumber(frame);
+            output.write(',');
+            output.writeNumber(std::uint64_t(k));
+            output.write(',');
+            output.writeNumber(capture.triggerAngleDeg);
+            output.write(',');
+            output.writeNumber(capture.time);
+            output.write(',');
+            writeCsvField(output, vessel.getName());
+            output.write('\n');
+          }
+        }
+        break;
+
+      case OutputFormat::JSONLines:
+        for (std::size_t k = 0; k < schedule.captures.size(); ++k) {
+          const ScheduledCapture &capture = schedule.captures[k];
+          output.write("{\"frame\":");
+          output.writeNumber(frame);
+          output.write(",\"capture\":");
+          output.writeNumber(std::uint64_t(k));
+          output.write(",\"trigger_angle_deg\":");
+          output.writeNumber(capture.triggerAngleDeg);
+          output.write(",\"time_s\":");
+          output.writeNumber(capture.time);
+          output.write(",\"vessels\":[");
+          bool first = true;
+          for (auto & vessel : plan[capture.picture].getVessels()) {
+            if (!first)
+              output.write(',');
+            first = false;
+            writeJsonString(output, vessel.getName());
+          }
+          output.write("]}\n");
+        }
+        break;
+
+      case OutputFormat::Binary:
+        writeBinary<std::uint64_t>(output, frame);
+        writeBinary<std::uint64_t>(output, schedule.captures.size());
+        for (auto & capture : schedule.captures) {
+          const VesselSpan &vessels = plan[capture.picture].getVessels();
+          writeBinary<double>(output, capture.triggerAngleDeg);
+          writeBinary<double>(output, capture.time);
+          writeBinary<std::uint32_t>(output, vessels.size());
+          for (auto & vessel : vessels) {
+            const std::string &name = vessel.getName();
+            writeBinary<std::uint32_t>(output, name.size());
+            output.write(name.data(), name.size());
+          }
+        }
+        break;
+    }
+  }
+
+  void writeSchedule(BufferedWriter &output, const Plan &plan, const Schedule &schedule, OutputFormat format) {
+    writeScheduleHeader(output, format);
+    writeScheduleFrame(output, plan, schedule, format, 0);
+  }
+
+}
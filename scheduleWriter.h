@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "gimbaledCamera.h"
+#include "slewScheduler.h"
+
+#ifndef SCHEDULEWRITER_H
+#define SCHEDULEWRITER_H
+
+/** @file 
+ *  Machine-readable output of a capture schedule: for each picture, in
+ *  capture order, its trigger angle, the time it is done and the names of
+ *  its vessels.  An output may hold the schedules of several frames (the
+ *  snapshots of a stream), each record tagged with its frame, after a
+ *  single header.  Three formats:
+ *
+ *  CSV, one line per vessel, after a header line; names are quoted when they
+ *  contain a comma or a quote:
+ *
+ *      frame,capture,trigger_angle_deg,time_s,vessel
+ *      0,0,59.27,0.5,Trinity
+ *
+ *  JSON lines, one object per picture:
+ *
+ *      {"frame":0,"capture":0,"trigger_angle_deg":59.27,"time_s":0.5,"vessels":["Trinity","Cypher"]}
+ *
+ *  Binary, little-endian:
+ *
+ *      char     magic[4]         "GCSC"
+ *      uint32   version          2
+ *      then for each frame, up to the end of the output:
+ *      uint64   frame            index of the frame
+ *      uint64   count            number of captures
+ *      then for each capture:
+ *      double   triggerAngleDeg  
+ *      double   time             seconds
+ *      uint32   vessels          number of vessels
+ *      then for each vessel:
+ *      uint32   nameLength
+ *      char     name[nameLength]
+ *
+ *  Numbers are written with the shortest representation that reads back
+ *  exactly.
+ */
+
+namespace gimbaledCamera {
+
+  /// The formats of writeSchedule.
+  enum class OutputFormat {
+    CSV,        ///< one line per vessel
+    JSONLines,  ///< one JSON object per picture
+    Binary      ///< length-prefixed records
+  };
+
+  /// Returns the format named "csv", "jsonl" or "binary"; throws std::invalid_argument otherwise.
+  OutputFormat outputFormat(const std::string &name);
+
+  /** Buffered output to a file descriptor, formatting numbers with
+   *  std::to_chars instead of iostreams.  Flushed when the buffer is full
+   *  and on destruction.
+   */
+  class BufferedWriter {
+
+    public:
+
+      /// Class constructor.
+      explicit BufferedWriter(
+          int fd                    /** the file descriptor to write to (not closed) */,
+          std::size_t capacity=1<<16 /** the size of the buffer, in bytes */
+          );
+
+      BufferedWriter(const BufferedWriter &) = delete;
+      BufferedWriter &operator=(const BufferedWriter &) = delete;
+
+      /// Flushes the buffer (errors are ignored here: call flush to see them).
+      ~BufferedWriter();
+
+      /// Writes n bytes.
+      inline void write(const void *data, std::size_t n) {
+        if (used + n > buffer.size())
+          return writeSlow(data, n);
+        std::memcpy(buffer.data() + used, data, n);
+        used += n;
+      };
+
+      /// Writes a string.
+      inline void write(std::string_view text) { 
+        write(text.data(), text.size()); 
+      };
+
+      /// Writes a character.
+      inline void write(char c) { 
+        write(&c, 1); 
+      };
+
+      /// Writes a number, in the shortest decimal form that reads back exactly.
+      void writeNumber(double value);
+
+      /// Writes an integer in decimal.
+      void writeNumber(std::uint64_t value);
+
+      /// Writes the buffer out; throws std::runtime_error if the write fails.
+      void flush();
+
+    private:
+
+      void writeSlow(const void *data, std::size_t n);   ///< Flushes first, or writes large blocks directly
+
+      int fd;                       ///< The file descriptor
+      std::vector<char> buffer;     ///< Bytes not yet written
+      std::size_t used;             ///< Number of bytes in buffer
+
+  };
+
+  /// Writes the header of an output (the CSV header line, or the binary magic number and version).
+  void writeScheduleHeader(
+      BufferedWriter &output     /** where to write */,
+      OutputFormat format        /** the output format */
+      );
+
+  /// Writes the schedule of a plan, in capture order, as the given frame of an output (after its header).
+  void writeScheduleFrame(
+      BufferedWriter &output     /** where to write */,
+      const Plan &plan           /** the pictures */,
+      const Schedule &schedule   /** the order in which they are taken */,
+      OutputFormat format        /** the output format */,
+      std::uint64_t frame        /** the index of the frame */
+      );
+
+  /// Writes an output with the schedule of a plan alone: the header, and the schedule as frame 0.
+  void writeSchedule(
+      BufferedWriter &output     /** where to write */,
+      const Plan &plan           /** the pictures */,
+      const Schedule &schedule   /** the order in which they are taken */,
+      OutputFormat format        /** the output format */
+      );
+
+}
+
+#endif
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "slewScheduler.h"
+
+namespace gimbaledCamera {
+
+  // Trapezoidal profile: triangular if the maximum rate is never reached
+  double SlewModel::slewTime(double angleDeg) const {
+    const double angle = std::fabs(angleDeg);
+    if (angle == 0)
+      return 0;
+    const double rampAngle = maxRate*maxRate/acceleration; // angle covered accelerating and decelerating
+    const double slew = angle < rampAngle ? 2*std::sqrt(angle/acceleration)
+                                          : angle/maxRate + maxRate/acceleration;
+    return slew + settleTime;
+  }
+
+  Schedule schedulePictures(const Plan &plan, double gimbalAngleDeg, const SlewModel &model) {
+    const std::size_t n = plan.size();
+    Schedule schedule;
+    if (n == 0)
+      return schedule;
+
+    // clockwise offset of every picture from the gimbal, in [0, 360)
+    std::vector<std::pair<double, std::size_t>> offset(n);
+    for (std::size_t k = 0; k < n; ++k) {
+      double d = fmod(plan[k].getCameraAngleDeg<Frame::Camera>() - gimbalAngleDeg, 360.);
+      if (d < 0)
+        d += 360;
+      offset[k] = std::make_pair(d, k);
+    }
+    std::sort(offset.begin(), offset.end());
+
+    // Unrolled on a line, the gimbal starts at 0; the b pictures taken
+    // clockwise are at offset[0..b), the a taken counterclockwise at
+    // offset[n-a..n) - 360.  side 0: at the clockwise end, side 1: at the
+    // counterclockwise end.
+    auto position = [&](std::size_t b, std::size_t a, int side) {
+      if (side == 0)
+        return b ? offset[b-1].first : 0.;
+      return a ? offset[n-a].first - 360 : 0.;
+    };
+    auto step = [&](double from, double to) {
+      return model.slewTime(to - from) + model.captureTime;
+    };
+
+    const double inf = std::numeric_limits<double>::infinity();
+    const std::size_t stride = n+1;
+    std::vector<double> cost(2*stride*stride, inf);
+    std::vector<char> from(2*stride*stride, 0);         // side of the previous state
+    auto at = [&](std::size_t b, std::size_t a, int side) { 
+      return (b*stride + a)*2 + side; 
+    };
+
+    cost[at(0, 0, 0)] = cost[at(0, 0, 1)] = 0;
+    for (std::size_t taken = 1; taken <= n; ++taken)
+      for (std::size_t b = 0; b <= taken; ++b) {
+        const std::size_t a = taken - b;
+        if (b > 0) {   // the last picture is offset[b-1], reached clockwise
+          for (int side = 0; side < 2; ++side) {
+            const double c = cost[at(b-1, a, side)] + step(position(b-1, a, side), offset[b-1].first);
+            if (c < cost[at(b, a, 0)]) {
+              cost[at(b, a, 0)] = c;
+              from[at(b, a, 0)] = side;
+            }
+          }
+        }
+        if (a > 0) {   // the last picture is offset[n-a], reached counterclockwise
+          for (int side = 0; side < 2; ++side) {
+            const double c = cost[at(b, a-1, side)] + step(position(b, a-1, side), offset[n-a].first - 360);
+            if (c < cost[at(b, a, 1)]) {
+              cost[at(b, a, 1)] = c;
+              from[at(b, a, 1)] = side;
+            }
+          }
+        }
+      }
+
+    // best final state, then walk back
+    std::size_t b = n, a = 0;
+    int side = 0;
+    for (std::size_t bb = 0; bb <= n; ++bb)
+      for (int s = 0; s < 2; ++s)
+        if (cost[at(bb, n-bb, s)] < cost[at(b, a, side)]) {
+          b = bb;
+          a = n-bb;
+          side = s;
+        }
+    schedule.totalTime = cost[at(b, a, side)];
+
+    std::vector<std::pair<double, std::size_t>> path;   // (position, picture), last first
+    while (b + a > 0) {
+      const int previous = from[at(b, a, side)];
+      if (side == 0) {
+        path.push_back(std::make_pair(offset[b-1].first, offset[b-1].second));
+        --b;
+      } else {
+        path.push_back(std::make_pair(offset[n-a].first - 360, offset[n-a].second));
+        --a;
+      }
+      side = previous;
+    }
+    std::reverse(path.begin(), path.end());
+
+    double here = 0, time = 0;
+    for (auto & stop : path) {
+      ScheduledCapture capture;
+      capture.picture         = stop.second;
+      capture.triggerAngleDeg = plan[stop.second].getCameraAngleDeg<Frame::Camera>();
+      capture.slewDeg         = stop.first - here;
+      capture.duration        = step(here, stop.first);
+      time += capture.duration;
+      capture.time            = time;
+      schedule.captures.push_back(capture);
+      here = stop.first;
+    }
+    return schedule;
+  }
+
+}
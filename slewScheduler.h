@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "gimbaledCamera.h"
+
+#ifndef SLEWSCHEDULER_H
+#define SLEWSCHEDULER_H
+
+/** @file */
+
+namespace gimbaledCamera {
+
+  /** How fast the gimbal turns: a trapezoidal velocity profile (constant
+   *  acceleration up to the maximum rate, then constant deceleration),
+   *  followed by a settle time before each picture.
+   */
+  struct SlewModel {
+    double maxRate      = 60;   ///< Maximum slew rate, in degrees per second
+    double acceleration = 120;  ///< Angular acceleration and deceleration, in degrees per second squared
+    double settleTime   = .2;   ///< Time to settle after a slew, in seconds
+    double captureTime  = .05;  ///< Time to take a picture, in seconds
+
+    /// Time to slew by the given angle (in degrees) and settle; zero if the angle is zero.
+    double slewTime(double angleDeg) const;
+  };
+
+  /// One picture of a schedule.
+  struct ScheduledCapture {
+    std::size_t picture;    ///< Index of the picture in the plan
+    double triggerAngleDeg; ///< Camera trigger angle, as Picture::getCameraAngleDeg('C')
+    double slewDeg;         ///< Slew from the previous position, in degrees (positive clockwise)
+    double duration;        ///< Slew, settle and capture time of this picture, in seconds
+    double time;            ///< Time at which this picture is done, from the start of the schedule, in seconds
+  };
+
+  /// The order in which to take the pictures of a plan, with predicted times.
+  struct Schedule {
+    std::vector<ScheduledCapture> captures; ///< The pictures, in capture order
+    double totalTime = 0;                   ///< Time to take all pictures, in seconds
+
+    /// Overloads the << operator.
+    friend std::ostream &operator<<(std::ostream &output, const Schedule &s) {
+      output << std::fixed << std::setprecision(1);
+      for (auto & capture : s.captures)
+        output << "Trigger angle: " << std::setw(6) << capture.triggerAngleDeg << " degrees"
+               << " | slew: "       << std::setw(7) << capture.slewDeg         << " degrees"
+               << " | done at: "    << std::setw(6) << std::setprecision(2) << capture.time 
+               << std::setprecision(1) << " s" << std::endl;
+      output << "Total time: " << std::setprecision(2) << s.totalTime << " s" 
+             << std::setprecision(6) << std::endl;
+      return output;
+    }
+  };
+
+  /** Orders the pictures of a plan, and picks the slew direction of each
+   *  move, to take them all quickly.
+   *
+   *  The gimbal is assumed to turn freely in both directions (no cable
+   *  wrap).  The search is an interval dynamic program over the pictures
+   *  sorted clockwise from the current gimbal angle: at any time the pictures
+   *  taken form an arc around the starting angle, and the gimbal is at one
+   *  of its ends.  It returns the fastest of these arc orders, which covers
+   *  every sweep and every change of direction, in O(n^2) time and memory
+   *  for n pictures.
+   *
+   *  With a linear slew time (infinite acceleration) some arc order is the
+   *  fastest of all orders, and the schedule is exact.  With acceleration,
+   *  stopping at a picture on the way can cost more than skipping it and
+   *  coming back, and the schedule is an arc-order heuristic: taking the
+   *  pictures in the order the best schedule first passes over them is an
+   *  arc order, and each of its moves is at most maxRate/acceleration slower
+   *  than the distance it covers at the maximum rate, so the schedule is at
+   *  most n*maxRate/acceleration seconds slower than the best order.
+   */
+  Schedule schedulePictures(
+      const Plan &plan               /** the pictures to take */,
+      double gimbalAngleDeg          /** the current trigger angle, clockwise from North (as getCameraAngleDeg('C')) */,
+      const SlewModel &model=SlewModel() /** the gimbal dynamics */
+      );
+
+}
+
+#endif
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "spatialIndex.h"
+
+namespace gimbaledCamera {
+
+  // Class constructor for SpatialIndex
+  SpatialIndex::SpatialIndex(double cellDegin) : cellDeg(cellDegin) {
+    rows    = static_cast<std::int64_t>(std::ceil(180/cellDeg));
+    columns = static_cast<std::int64_t>(std::ceil(360/cellDeg));
+  }
+
+  // Row from the South pole, column from the antimeridian, both clamped to the grid
+  std::uint64_t SpatialIndex::cellOf(double lat, double lon) const {
+    const std::int64_t row = std::min(rows - 1, std::max<std::int64_t>(0, std::floor((lat + 90)/cellDeg)));
+    std::int64_t column = static_cast<std::int64_t>(std::floor((lon + 180)/cellDeg)) % columns;
+    if (column < 0)
+      column += columns;
+    return row*columns + column;
+  }
+
+  void SpatialIndex::insert(std::uint32_t id, std::uint64_t key) {
+    std::vector<std::uint32_t> &ids = cells[key];
+    cell[id] = key;
+    slot[id] = ids.size();
+    ids.push_back(id);
+  }
+
+  // The last contact of the cell takes the place of the one removed
+  void SpatialIndex::erase(std::uint32_t id) {
+    std::vector<std::uint32_t> &ids = cells[cell[id]];
+    ids[slot[id]] = ids.back();
+    slot[ids.back()] = slot[id];
+    ids.pop_back();
+  }
+
+  void SpatialIndex::build(std::size_t n, const double *lat, const double *lon) {
+    cells.clear();
+    cell.resize(n);
+    slot.resize(n);
+    for (std::size_t i = 0; i < n; ++i)
+      insert(i, cellOf(lat[i], lon[i]));
+  }
+
+  std::size_t SpatialIndex::update(std::size_t n, const double *lat, const double *lon) {
+    std::size_t changed = 0;
+    
+    // removed contacts
+    for (std::size_t i = n; i < cell.size(); ++i, ++changed)
+      erase(i);
+    const std::size_t old = std::min(n, cell.size());
+    cell.resize(n);
+    slot.resize(n);
+
+    // moved contacts, then added ones
+    for (std::size_t i = 0; i < old; ++i) {
+      const std::uint64_t key = cellOf(lat[i], lon[i]);
+      if (key != cell[i]) {
+        erase(i);
+        insert(i, key);
+        ++changed;
+      }
+    }
+    for (std::size_t i = old; i < n; ++i, ++changed)
+      insert(i, cellOf(lat[i], lon[i]));
+    return changed;
+  }
+
+  void SpatialIndex::move(std::uint32_t id, double lat, double lon) {
+    const std::uint64_t key = cellOf(lat, lon);
+    if (key != cell[id]) {
+      erase(id);
+      insert(id, key);
+    }
+  }
+
+  // The circle spans range/R radians of latitude, and asin(sin(range/R)/cos(lat))
+  // of longitude unless it contains a pole
+  void SpatialIndex::query(const Vessel &observer, double range, std::vector<std::uint32_t> &ids) const {
+    ids.clear();
+    const double delta = std::min(M_PI, range/6371000);
+    const double latMin = observer.getLatDeg() - delta*180/M_PI, 
+                 latMax = observer.getLatDeg() + delta*180/M_PI;
+    const std::int64_t rowMin = cellOf(latMin, 0)/columns, 
+                       rowMax = cellOf(latMax, 0)/columns;
+
+    std::int64_t columnMin = 0, count = columns;
+    if (latMin > -90 && latMax < 90) {
+      const double halfWidth = std::asin(std::sin(delta)/std::cos(observer.getLat()))*180/M_PI;
+      columnMin = cellOf(0, observer.getLonDeg() - halfWidth) % columns;
+      count = std::min(columns, std::int64_t(std::floor((observer.getLonDeg() + 180 + halfWidth)/cellDeg))
+                                - std::int64_t(std::floor((observer.getLonDeg() + 180 - halfWidth)/cellDeg)) + 1);
+    }
+
+    for (std::int64_t row = rowMin; row <= rowMax; ++row)
+      for (std::int64_t k = 0; k < count; ++k) {
+        auto ptr = cells.find(row*columns + (columnMin + k) % columns);
+        if (ptr != cells.end())
+          ids.insert(ids.end(), ptr->second.begin(), ptr->second.end());
+      }
+    std::sort(ids.begin(), ids.end());
+  }
+
+}
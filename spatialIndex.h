@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "gimbaledCamera.h"
+#include "vesselIO.h"
+
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+/** @file */
+
+namespace gimbaledCamera {
+
+  /** A latitude/longitude grid over the contacts of a feed, to find the few
+   *  that are within range of an observer without computing the geometry of
+   *  all of them.
+   *
+   *  Contacts are identified by their index in the feed (e.g. in a
+   *  VesselSnapshot); the index only stores those ids, by cell, so the same
+   *  index serves any number of observers.  When the contacts move, update
+   *  moves only those that changed cell, so it can follow a feed frame after
+   *  frame without being rebuilt.
+   */
+  class SpatialIndex {
+
+    public:
+
+      /// Class constructor (an empty index).
+      explicit SpatialIndex(
+          double cellDeg=0.1 /** the side of the grid cells, in degrees */
+          );
+
+      /// Returns the number of contacts.
+      inline std::size_t size() const { 
+        return cell.size(); 
+      };
+
+      /// Returns the side of the grid cells, in degrees.
+      inline double getCellDeg() const { 
+        return cellDeg; 
+      };
+
+      /// Indexes n contacts from scratch.
+      void build(
+          std::size_t n        /** number of contacts */,
+          const double *lat    /** contact latitudes, in degrees */,
+          const double *lon    /** contact longitudes, in degrees */
+          );
+
+      /// Indexes the vessels of a snapshot from scratch.
+      inline void build(const VesselSnapshot &snapshot) {
+        build(snapshot.size(), snapshot.getLats(), snapshot.getLons());
+      };
+
+      /** Follows the contacts to their new positions: only the contacts that
+       *  changed cell are moved.  Contacts beyond the previous size are
+       *  added, and contacts beyond n are removed.  Returns the number of
+       *  contacts added, moved or removed.
+       */
+      std::size_t update(
+          std::size_t n        /** number of contacts */,
+          const double *lat    /** contact latitudes, in degrees */,
+          const double *lon    /** contact longitudes, in degrees */
+          );
+
+      /// Follows the vessels of a snapshot, as above.
+      inline std::size_t update(const VesselSnapshot &snapshot) {
+        return update(snapshot.size(), snapshot.getLats(), snapshot.getLons());
+      };
+
+      /// Moves contact id to a new position.
+      void move(
+          std::uint32_t id     /** the contact */,
+          double lat           /** contact latitude, in degrees */,
+          double lon           /** contact longitude, in degrees */
+          );
+
+      /** Finds the contacts in the cells that intersect the bounding box of
+       *  the range circle of the observer.  ids is overwritten with them, in
+       *  increasing order.  Contacts within range are always found; the
+       *  others may be, so the caller still checks the distance.
+       */
+      void query(
+          const Vessel &observer        /** the observer */,
+          double range                  /** the range, in meters */,
+          std::vector<std::uint32_t> &ids /** output: the candidate contacts */
+          ) const;
+
+    private:
+
+      /// Returns the cell of a position, as row*columns + column.
+      std::uint64_t cellOf(double lat, double lon) const;
+
+      void insert(std::uint32_t id, std::uint64_t key);   ///< Adds contact id to cell key
+      void erase(std::uint32_t id);                       ///< Removes contact id from its cell
+
+      double cellDeg;                     ///< Side of the cells, in degrees
+      std::int64_t rows, columns;         ///< Size of the grid
+      std::vector<std::uint64_t> cell;    ///< The cell of each contact
+      std::vector<std::uint32_t> slot;    ///< The position of each contact in its cell
+      std::unordered_map<std::uint64_t, std::vector<std::uint32_t> > cells; ///< The contacts of each cell
+
+  };
+
+}
+
+#endif
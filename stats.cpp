@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include "stats.h"
+
+namespace gimbaledCamera {
+  namespace stats {
+
+    namespace {
+
+      const std::size_t counters = std::size_t(Counter::Size),
+                        timers   = std::size_t(Timer::Size),
+                        buckets  = 64;    // bucket k holds latencies in [2^k, 2^(k+1)) ns
+
+      const char *counterNames[counters] = {"vessels", "pictures", "merges", "allocations", "updates", "dropped_updates"};
+      const char *timerNames[timers] = {"relative_vessel", "sort", "partition", "merge", "output", "replan", "update_to_plan"};
+
+      struct Histogram {
+        std::atomic<std::uint64_t> bucket[buckets];
+        std::atomic<std::uint64_t> count;
+        std::atomic<std::uint64_t> sum;      // in nanoseconds
+      };
+
+      std::atomic<std::uint64_t> counterValues[counters];
+      Histogram histograms[timers];
+
+      inline std::size_t bucketOf(std::uint64_t nanoseconds) {
+        return 63 - __builtin_clzll(nanoseconds | 1);
+      }
+
+      // the upper bound of bucket k, in nanoseconds (the last one has none: UINT64_MAX)
+      inline std::uint64_t upperOf(std::size_t k) {
+        return k + 1 < buckets ? std::uint64_t(2) << k : std::numeric_limits<std::uint64_t>::max();
+      }
+
+    }
+
+    thread_local std::uint32_t openTimers = 0;
+
+    void add(Counter counter, std::uint64_t n) {
+      counterValues[std::size_t(counter)].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    void record(Timer timer, std::uint64_t nanoseconds) {
+      Histogram &h = histograms[std::size_t(timer)];
+      h.bucket[bucketOf(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+      h.count.fetch_add(1, std::memory_order_relaxed);
+      h.sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+    }
+
+    std::uint64_t get(Counter counter) {
+      return counterValues[std::size_t(counter)].load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t count(Timer timer) {
+      return histograms[std::size_t(timer)].count.load(std::memory_order_relaxed);
+    }
+
+    void reset() {
+      for (auto & value : counterValues)
+        value.store(0, std::memory_order_relaxed);
+      for (auto & h : histograms) {
+        for (auto & value : h.bucket)
+          value.store(0, std::memory_order_relaxed);
+        h.count.store(0, std::memory_order_relaxed);
+        h.sum.store(0, std::memory_order_relaxed);
+      }
+    }
+
+    // { "enabled": ..., "counters": {...}, "timers": { name: { count, sum_ns, buckets: [[upper_ns, count], ...] } } }
+    std::string toJson() {
+      std::ostringstream output;
+      output << "{\n  \"enabled\": " << (enabled ? "true" : "false") << ",\n  \"counters\": {";
+      for (std::size_t i = 0; i < counters; ++i)
+        output << (i ? ",\n" : "\n") << "    \"" << counterNames[i] << "\": " << counterValues[i].load();
+      output << "\n  },\n  \"timers\": {";
+      for (std::size_t i = 0; i < timers; ++i) {
+        const Histogram &h = histograms[i];
+        output << (i ? ",\n" : "\n") << "    \"" << timerNames[i] << "\": {\"count\": " << h.count.load()
+               << ", \"sum_ns\": " << h.sum.load() << ", \"buckets\": [";
+        bool first = true;
+        for (std::size_t k = 0; k < buckets; ++k)
+          if (const std::uint64_t n = h.bucket[k].load()) {
+            output << (first ? "" : ", ") << "[" << upperOf(k) << ", " << n << "]";
+            first = false;
+          }
+        output << "]}";
+      }
+      output << "\n  }\n}\n";
+      return output.str();
+    }
+
+    // counters as gimbaledcamera_<name>_total, timers as cumulative histograms in seconds
+    std::string toPrometheus() {
+      std::ostringstream output;
+      for (std::size_t i = 0; i < counters; ++i)
+        output << "# TYPE gimbaledcamera_" << counterNames[i] << "_total counter\n"
+               << "gimbaledcamera_" << counterNames[i] << "_total " << counterValues[i].load() << "\n";
+
+      for (std::size_t i = 0; i < timers; ++i) {
+        const Histogram &h = histograms[i];
+        const std::string name = std::string("gimbaledcamera_") + timerNames[i] + "_seconds";
+        std::size_t last = 0;
+        for (std::size_t k = 0; k < buckets; ++k)
+          if (h.bucket[k].load())
+            last = k;
+
+        output << "# TYPE " << name << " histogram\n";
+        std::uint64_t cumulative = 0;
+        for (std::size_t k = 0; k <= last && k + 1 < buckets; ++k) {   // the last bucket only has +Inf
+          cumulative += h.bucket[k].load();
+          output << name << "_bucket{le=\"" << (std::uint64_t(2) << k)*1e-9 << "\"} " << cumulative << "\n";
+        }
+        output << name << "_bucket{le=\"+Inf\"} " << h.count.load() << "\n"
+               << name << "_sum "   << h.sum.load()*1e-9 << "\n"
+               << name << "_count " << h.count.load() << "\n";
+      }
+      return output.str();
+    }
+
+    void dump(const std::string &path) {
+      std::ofstream output(path);
+      if (!output)
+        throw std::runtime_error("cannot write " + path);
+      const bool json = path.size() >= 5 && path.compare(path.size()-5, 5, ".json") == 0;
+      output << (json ? toJson() : toPrometheus());
+    }
+
+  }
+}
+
+#ifdef GIMBALEDCAMERA_STATS
+
+// Global operator new, counting the allocations made in the timed stages
+// (not inlined, so that the compiler does not pair malloc with new)
+__attribute__((noinline)) void *operator new(std::size_t size) {
+  if (gimbaledCamera::stats::openTimers != 0)
+    gimbaledCamera::stats::add(gimbaledCamera::stats::Counter::Allocations);
+  if (void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+#endif
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#ifndef STATS_H
+#define STATS_H
+
+/** @file 
+ *  Hot-path instrumentation: counters and latency histograms.
+ *
+ *  Instrumentation is compiled in only if GIMBALEDCAMERA_STATS is defined
+ *  (make STATS=1).  Otherwise GIMBALEDCAMERA_COUNT and GIMBALEDCAMERA_TIME
+ *  expand to nothing, so the instrumented code is exactly the code without
+ *  them.  The functions below are always available, and report zeros when
+ *  instrumentation is off.
+ *
+ *  Counters and histograms are global and updated with relaxed atomics, so
+ *  they can be used from several threads.  Latencies are recorded in
+ *  power-of-two buckets of nanoseconds.
+ *
+ *  With instrumentation, the library replaces the global operator new to
+ *  count the heap allocations made while a timed stage (a ScopedTimer) is
+ *  open on the allocating thread.
+ */
+
+#ifdef GIMBALEDCAMERA_STATS
+/// Adds n to a counter (a gimbaledCamera::stats::Counter name).
+#define GIMBALEDCAMERA_COUNT(counter, n) \
+  ::gimbaledCamera::stats::add(::gimbaledCamera::stats::Counter::counter, (n))
+/// Records the time from here to the end of the scope (a gimbaledCamera::stats::Timer name).
+#define GIMBALEDCAMERA_TIME(timer) \
+  const ::gimbaledCamera::stats::ScopedTimer gimbaledCameraTimer##timer(::gimbaledCamera::stats::Timer::timer)
+#else
+#define GIMBALEDCAMERA_COUNT(counter, n)
+#define GIMBALEDCAMERA_TIME(timer)
+#endif
+
+namespace gimbaledCamera {
+  namespace stats {
+
+    /// True if the library was built with instrumentation.
+#ifdef GIMBALEDCAMERA_STATS
+    constexpr bool enabled = true;
+#else
+    constexpr bool enabled = false;
+#endif
+
+    /// The counters.
+    enum class Counter {
+      Vessels,      ///< vessels planned
+      Pictures,     ///< pictures made
+      Merges,       ///< first and last pictures merged across the -180/+180 cut
+      Allocations,  ///< heap allocations (operator new) made in the timed stages, on their own thread
+      Updates,      ///< vessel updates applied by the PlanDaemon
+      DroppedUpdates, ///< contact updates discarded by a full ContactQueue
+      Size          ///< number of counters
+    };
+
+    /// The timed stages.
+    enum class Timer {
+      RelativeVessel, ///< construction of one RelativeVessel
+      Sort,           ///< sort by bearing in the planners
+      Partition,      ///< partition of the sorted vessels into pictures
+      Merge,          ///< check and merge of the first and last pictures
+      Output,         ///< output writing in main
+      Replan,         ///< rescheduling and publication of a plan by the PlanDaemon
+      UpdateToPlan,   ///< from the push of a contact update to the plan that uses it
+      Size            ///< number of timers
+    };
+
+    void add(Counter counter, std::uint64_t n=1);              ///< Adds n to a counter
+    void record(Timer timer, std::uint64_t nanoseconds);       ///< Records one latency
+    std::uint64_t get(Counter counter);                        ///< Returns the value of a counter
+    std::uint64_t count(Timer timer);                          ///< Returns the number of latencies recorded
+    void reset();                                              ///< Sets every counter and histogram to zero
+
+    std::string toJson();        ///< Returns all counters and histograms as JSON
+    std::string toPrometheus();  ///< Returns all counters and histograms in the Prometheus text format
+
+    /// Writes the stats to a file: JSON if the name ends in .json, Prometheus text otherwise.
+    void dump(const std::string &path);
+
+    /// Number of ScopedTimers alive on this thread: allocations are counted while it is not zero.
+    extern thread_local std::uint32_t openTimers;
+
+    /// Records the lifetime of the object in a histogram.
+    class ScopedTimer {
+
+      public:
+
+        explicit ScopedTimer(Timer timerin) : timer(timerin), start(std::chrono::steady_clock::now()) {
+          ++openTimers;
+        };
+
+        ~ScopedTimer() {
+          --openTimers;
+          record(timer, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count());
+        };
+
+        ScopedTimer(const ScopedTimer &) = delete;
+        ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+      private:
+
+        Timer timer;                                  ///< The histogram to record to
+        std::chrono::steady_clock::time_point start;  ///< Construction time
+
+    };
+
+  }
+}
+
+#endif
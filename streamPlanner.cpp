@@ -0,0 +1,311 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include "streamPlanner.h"
+#include "boundedQueue.h"
+#include "parallelPlanner.h"
+#include "spatialIndex.h"
+
+namespace gimbaledCamera {
+
+  namespace {
+
+    inline bool isSpace(char c) {
+      return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    // A line "---", with optional trailing whitespace, separates two frames
+    inline bool isSeparator(const char *begin, const char *end) {
+      return end - begin >= 3 && begin[0] == '-' && begin[1] == '-' && begin[2] == '-'
+        && std::all_of(begin + 3, end, isSpace);
+    }
+
+  }
+
+  // Class constructor for SnapshotStream
+  SnapshotStream::SnapshotStream(int fdin, std::size_t chunkBytesin, int wakeFdin) 
+    : fd(fdin), wakeFd(wakeFdin), chunkBytes(chunkBytesin ? chunkBytesin : 1) {
+  }
+
+  // Read more input, keeping only the bytes not parsed yet
+  bool SnapshotStream::read() {
+    if (start > 0) {
+      pending.erase(pending.begin(), pending.begin() + start);
+      scanned -= start;
+      start = 0;
+    }
+    const std::size_t size = pending.size(), block = std::max<std::size_t>(1<<16, std::min<std::size_t>(chunkBytes, 1<<20));
+    // wait for input, unless woken up first
+    if (wakeFd >= 0) {
+      pollfd fds[2] = {{fd, POLLIN, 0}, {wakeFd, POLLIN, 0}};
+      int ready;
+      do {
+        ready = poll(fds, 2, -1);
+      } while (ready < 0 && errno == EINTR);
+      if (ready < 0)
+        throw std::runtime_error(std::string("cannot read input: ") + strerror(errno));
+      if (fds[1].revents != 0)
+        return false;
+    }
+    pending.resize(size + block);
+    ssize_t got;
+    do {
+      got = ::read(fd, pending.data() + size, block);
+    } while (got < 0 && errno == EINTR);
+    pending.resize(size + std::max<ssize_t>(got, 0));
+    if (got < 0)
+      throw std::runtime_error(std::string("cannot read input: ") + strerror(errno));
+    return got > 0;
+  }
+
+  // Parse the lines [start, end) of pending, with the line numbers of the input;
+  // a frame starts with its first vessel
+  bool SnapshotStream::take(std::size_t end, bool last, SnapshotChunk &chunk) {
+    const char *begin = pending.data() + start;
+    try {
+      chunk.vessels = parseSnapshot(begin, pending.data() + end);
+    } catch (const std::runtime_error &e) {
+      const std::string what = e.what();
+      std::size_t digits = 0;
+      if (what.compare(0, 5, "line ") == 0) {
+        const std::size_t local = std::stoul(what.substr(5), &digits);
+        throw std::runtime_error("line " + std::to_string(local + line - 1) + what.substr(5 + digits));
+      }
+      throw;
+    }
+    line += std::count(begin, static_cast<const char *>(pending.data() + end), '\n');
+    start = end;
+    if (chunk.vessels.size() == 0 && !started)
+      return false;
+    chunk.frame = frame;
+    chunk.first = !started;
+    chunk.last  = last;
+    started = !last;
+    if (last)
+      ++frame;
+    return true;
+  }
+
+  // Return the next chunk: up to a separator, after chunkBytes, or at the end
+  bool SnapshotStream::next(SnapshotChunk &chunk) {
+    if (!checked) {
+      while (!done && pending.size() < 4)
+        done = !read();
+      checked = true;
+      if (isBinarySnapshot(pending.data(), pending.size())) {
+        while (!done)
+          done = !read();
+        chunk.vessels = loadSnapshot(std::move(pending));
+        chunk.frame = 0;
+        chunk.first = chunk.last = true;
+        pending.clear();
+        return chunk.vessels.size() > 0;
+      }
+    }
+
+    while (true) {
+      // check the complete lines read so far
+      while (true) {
+        const char *data = pending.data();
+        const char *newline = static_cast<const char *>(memchr(data + scanned, '\n', pending.size() - scanned));
+        if (!newline)
+          break;
+        const std::size_t lineStart = scanned;
+        scanned = newline - data + 1;
+        if (isSeparator(data + lineStart, newline)) {
+          const bool taken = take(lineStart, true, chunk);
+          ++line;                                            // the separator
+          start = scanned;
+          if (taken)
+            return true;
+          continue;
+        }
+        if (scanned - start >= chunkBytes && take(scanned, false, chunk))
+          return true;
+      }
+
+      // the end of the input ends the last frame
+      if (done) {
+        if (scanned < pending.size()) {                      // the last line has no newline
+          pending.push_back('\n');
+          continue;
+        }
+        return (start < pending.size() || started) && take(pending.size(), true, chunk);
+      }
+      done = !read();
+    }
+  }
+
+  // Plan the frames of an input in a pipeline of threads
+  void streamPlans(
+      int fd, 
+      ThreadPool &pool, 
+      const std::function<void(FramePlan &)> &emit, 
+      const StreamOptions &options, 
+      const SlewModel &model) {
+
+    // the vessels of a chunk, with the drone of their frame
+    struct Converted {
+      std::size_t frame = 0;
+      Vessel drone = Vessel(0, 0, std::uint32_t(0));
+      std::vector<RelativeVessel> vessels;
+      bool first = false, last = false;
+    };
+
+    BoundedQueue<SnapshotChunk> chunks(options.queueDepth);
+    BoundedQueue<Converted> converted(options.queueDepth);
+    BoundedQueue<FramePlan> plans(options.queueDepth);
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    int wakeFd[2];                                            // written by fail, to stop the reader
+    if (pipe(wakeFd) != 0)
+      throw std::runtime_error(std::string("cannot create a pipe: ") + strerror(errno));
+    fcntl(wakeFd[1], F_SETFL, O_NONBLOCK);
+    auto fail = [&]() {                                       // keep the first error, and stop every stage
+      {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (!error)
+          error = std::current_exception();
+      }
+      chunks.close();
+      converted.close();
+      plans.close();
+      const char wake = 0;                                    // the reader may be waiting for input
+      if (write(wakeFd[1], &wake, 1) < 0) {}
+    };
+
+    // read and parse
+    std::thread reader([&]() {
+      try {
+        SnapshotStream stream(fd, options.chunkBytes, wakeFd[0]);
+        SnapshotChunk chunk;
+        while (stream.next(chunk))
+          if (!chunks.push(std::move(chunk)))
+            break;
+        chunks.close();
+      } catch (...) {
+        fail();
+      }
+    });
+
+    // compute the geometry of each chunk, relative to the drone of its frame
+    std::thread converter([&]() {
+      try {
+        SnapshotChunk chunk;
+        Converted next;
+        std::vector<std::uint32_t> ids;
+        SpatialIndex index;
+        while (chunks.pop(chunk)) {
+          if (chunk.first) {
+            if (chunk.vessels.size() == 0)
+              continue;
+            next.drone = Vessel(chunk.vessels.getLatDeg(0), chunk.vessels.getLonDeg(0), std::string(chunk.vessels.getName(0)));
+          }
+          const std::uint32_t skip = chunk.first ? 1 : 0;    // the drone is not planned
+          if (options.maxRange > 0) {
+            // only the vessels in the cells around the drone are converted;
+            // the index follows the chunks in place of the previous frame's
+            index.update(chunk.vessels);
+            index.query(next.drone, options.maxRange, ids);
+            if (skip && !ids.empty() && ids.front() == 0)
+              ids.erase(ids.begin());
+          } else {
+            ids.resize(chunk.vessels.size() - std::min<std::size_t>(skip, chunk.vessels.size()));
+            std::iota(ids.begin(), ids.end(), skip);
+          }
+          next.frame   = chunk.frame;
+          next.first   = chunk.first;
+          next.last    = chunk.last;
+          next.vessels = makeRelativeVessels(next.drone, chunk.vessels, ids, pool, options.margin, options.maxRange);
+          if (!converted.push(std::move(next)))
+            break;
+        }
+        converted.close();
+      } catch (...) {
+        fail();
+      }
+    });
+
+    // gather the chunks of each frame, then plan and schedule it
+    std::thread planner([&]() {
+      try {
+        Converted chunk;
+        FramePlan frame;
+        std::vector<RelativeVessel> vessels;
+        while (converted.pop(chunk)) {
+          if (chunk.first) {
+            frame.frame = chunk.frame;
+            frame.drone = chunk.drone;
+            vessels.clear();
+          }
+          if (vessels.empty())
+            vessels.swap(chunk.vessels);
+          else
+            vessels.insert(vessels.end(), chunk.vessels.begin(), chunk.vessels.end());
+          if (!chunk.last)
+            continue;
+          if (options.keepVessels)
+            frame.vessels = vessels;
+          frame.plan     = makePictures(options.FOV, std::move(vessels), pool);
+          frame.schedule = schedulePictures(frame.plan, options.gimbalAngleDeg, model);
+          vessels = std::vector<RelativeVessel>();
+          if (!plans.push(std::move(frame)))
+            break;
+          frame = FramePlan();
+        }
+        plans.close();
+      } catch (...) {
+        fail();
+      }
+    });
+
+    // hand the plans over, in frame order
+    try {
+      FramePlan frame;
+      while (plans.pop(frame))
+        emit(frame);
+    } catch (...) {
+      fail();
+    }
+    reader.join();
+    converter.join();
+    planner.join();
+    close(wakeFd[0]);
+    close(wakeFd[1]);
+    if (error)
+      std::rethrow_exception(error);
+  }
+
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "gimbaledCamera.h"
+#include "slewScheduler.h"
+#include "threadPool.h"
+#include "vesselIO.h"
+
+#ifndef STREAMPLANNER_H
+#define STREAMPLANNER_H
+
+/** @file 
+ *  Planning a stream of snapshots in a pipeline of threads.
+ *
+ *  The input of main may hold several snapshots (frames), separated by a
+ *  line "---"; each frame is a snapshot as before, the drone first.  The
+ *  frames are read and parsed in chunks of lines, so that the geometry of
+ *  a chunk is computed while the next one is parsed, and a frame is
+ *  planned while the next one is read: the first plans come out before
+ *  the whole input is read.
+ */
+
+namespace gimbaledCamera {
+
+  /// A chunk of consecutive vessels of a frame.
+  struct SnapshotChunk {
+    VesselSnapshot vessels;     ///< The vessels of the chunk (the drone first, in the first chunk of a frame)
+    std::size_t frame = 0;      ///< Index of the frame, from 0
+    bool first = false;         ///< True for the first chunk of a frame
+    bool last = false;          ///< True for the last chunk of a frame
+  };
+
+  /** Reads the frames of an input in chunks of whole lines.
+   *
+   *  A text input is cut at the frame separators, and within a frame after
+   *  chunkBytes; frames with no vessels are skipped.  A binary snapshot is
+   *  a single frame, read whole.  Parse errors are thrown by next, as
+   *  std::runtime_error with the line number in the input.
+   */
+  class SnapshotStream {
+
+    public:
+
+      /// Class constructor.
+      explicit SnapshotStream(
+          int fdin                         /** the file descriptor to read (not closed) */,
+          std::size_t chunkBytesin=1<<20   /** the size of a chunk of text, in bytes */,
+          int wakeFdin=-1                  /** a file descriptor that ends the input once readable (e.g. a pipe), or -1 */
+          );
+
+      /// Reads and parses the next chunk.  Returns false at the end of the input.
+      bool next(SnapshotChunk &chunk);
+
+    private:
+
+      /// Parses the lines [start, end) of pending into chunk, and consumes them.  Returns false (and no chunk) if the frame has no vessels yet.
+      bool take(std::size_t end, bool last, SnapshotChunk &chunk);
+
+      /// Reads more input into pending; returns false at the end of the input, or once wakeFd is readable.
+      bool read();
+
+      int fd;                     ///< The input
+      int wakeFd;                 ///< Ends the input once readable, or -1
+      std::size_t chunkBytes;     ///< Size of a chunk of text
+      std::vector<char> pending;  ///< Input read and not parsed yet
+      std::size_t start = 0;      ///< First byte of pending not parsed yet
+      std::size_t scanned = 0;    ///< First byte of pending not checked for separators
+      std::size_t line = 1;       ///< Line number of start in the input
+      std::size_t frame = 0;      ///< Index of the current frame
+      bool started = false;       ///< True if a chunk of the current frame was returned
+      bool checked = false;       ///< True once the input is known to be text
+      bool done = false;          ///< True at the end of the input
+
+  };
+
+  /// How streamPlans plans each frame.
+  struct StreamOptions {
+    double FOV = 80;                ///< Camera field of view, in degrees
+    double gimbalAngleDeg = 0;      ///< Trigger angle the schedules start from, clockwise from North
+    double margin = 100;            ///< Radius of the region around each vessel we want to capture, in meters
+    double maxRange = 0;            ///< Maximum distance of a vessel, in meters; 0 for any
+    std::size_t chunkBytes = 1<<20; ///< Size of a chunk of text, in bytes
+    std::size_t queueDepth = 4;     ///< Most items waiting between two stages
+    bool keepVessels = false;       ///< Also return the vessels of each frame, in input order
+  };
+
+  /// The plan of one frame.
+  struct FramePlan {
+    std::size_t frame = 0;                  ///< Index of the frame, from 0
+    Vessel drone = Vessel(0, 0, std::uint32_t(0)); ///< The drone (the first vessel of the frame)
+    std::vector<RelativeVessel> vessels;    ///< The vessels planned, in input order (with keepVessels only)
+    Plan plan;                              ///< The pictures
+    Schedule schedule;                      ///< The order in which to take them
+  };
+
+  /** Plans the frames of an input in a pipeline: one thread reads and
+   *  parses chunks, one computes their RelativeVessels (makeRelativeVessels
+   *  on the pool; with a maxRange, only for the vessels that a SpatialIndex
+   *  of the chunk finds around the drone), one plans and schedules each frame (makePictures on the
+   *  pool, then schedulePictures), and the calling thread gets the plans,
+   *  in frame order, through emit.  Stages are connected by bounded
+   *  queues, so memory stays bounded however long the input.
+   *
+   *  Each plan is the one main makes of the frame alone: the vessels (those
+   *  within maxRange, if given) are in input order, and each stage is
+   *  bit-identical to its serial counterpart.  The first exception of a
+   *  stage (or of emit) stops the pipeline, even while the reader waits for
+   *  input that never comes, and is rethrown.
+   */
+  void streamPlans(
+      int fd                                          /** the input (not closed) */,
+      ThreadPool &pool                                /** the threads of the geometry and the sort */,
+      const std::function<void(FramePlan &)> &emit    /** called with the plan of each frame */,
+      const StreamOptions &options=StreamOptions()    /** how to plan */,
+      const SlewModel &model=SlewModel()              /** the gimbal dynamics */
+      );
+
+}
+
+#endif
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include "threadPool.h"
+
+namespace gimbaledCamera {
+
+  namespace {
+    thread_local bool insideLoop = false; // true while running a parallelFor body
+  }
+
+  // Class constructor for ThreadPool
+  ThreadPool::ThreadPool(std::size_t threads) : generation(0), stop(false), body(nullptr), remaining(0) {
+    if (threads == 0)
+      threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (std::size_t i = 0; i < threads; ++i)
+      queues.emplace_back(new Queue);
+    for (std::size_t i = 1; i < threads; ++i)
+      workers.emplace_back(&ThreadPool::runWorker, this, i);
+  }
+
+  ThreadPool::~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    wake.notify_all();
+    for (auto & worker : workers)
+      worker.join();
+  }
+
+  void ThreadPool::parallelFor(std::size_t n, const std::function<void(std::size_t)> &bodyin) {
+    if (n == 0)
+      return;
+
+    // nested loops, or no workers: run here
+    if (insideLoop || workers.empty()) {
+      for (std::size_t i = 0; i < n; ++i)
+        bodyin(i);
+      return;
+    }
+
+    std::lock_guard<std::mutex> loopLock(loopMutex);
+
+    // one contiguous chunk per thread
+    body = &bodyin;
+    error = nullptr;
+    remaining = n;
+    const std::size_t threads = queues.size();
+    for (std::size_t i = 0; i < threads; ++i) {
+      std::lock_guard<std::mutex> lock(queues[i]->mutex);
+      queues[i]->begin = n*i/threads;
+      queues[i]->end   = n*(i+1)/threads;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      ++generation;
+    }
+    wake.notify_all();
+
+    // the calling thread works too, then waits for the tasks still running
+    work(0);
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]() { return remaining == 0; });
+    body = nullptr;
+
+    if (error)
+      std::rethrow_exception(error);
+  }
+
+  void ThreadPool::runWorker(std::size_t id) {
+    std::size_t seen = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [&]() { return stop || generation != seen; });
+        if (stop)
+          return;
+        seen = generation;
+      }
+      work(id);
+    }
+  }
+
+  void ThreadPool::work(std::size_t id) {
+    insideLoop = true;
+    std::size_t task;
+    while (pop(id, task) || steal(id, task)) {
+      try {
+        (*body)(task);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error)
+          error = std::current_exception();
+      }
+      if (--remaining == 0) {
+        std::lock_guard<std::mutex> lock(mutex); // the caller may be about to wait
+        done.notify_one();
+      }
+    }
+    insideLoop = false;
+  }
+
+  bool ThreadPool::pop(std::size_t id, std::size_t &task) {
+    Queue &queue = *queues[id];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.begin == queue.end)
+      return false;
+    task = queue.begin++;
+    return true;
+  }
+
+  bool ThreadPool::steal(std::size_t id, std::size_t &task) {
+    const std::size_t threads = queues.size();
+    for (std::size_t k = 1; k < threads; ++k) {
+      Queue &victim = *queues[(id+k) % threads];
+      std::size_t first, last;
+      {
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.begin == victim.end)
+          continue;
+        first = victim.begin + (victim.end - victim.begin)/2;  // the back half, rounded up
+        last  = victim.end;
+        victim.end = first;
+      }
+      // run the first stolen task now, keep the others
+      Queue &own = *queues[id];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      own.begin = first + 1;
+      own.end   = last;
+      task = first;
+      return true;
+    }
+    return false;
+  }
+
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+/** @file */
+
+namespace gimbaledCamera {
+
+  /** A fixed set of worker threads running parallel loops with work stealing.
+   *
+   *  parallelFor splits the index range into one contiguous chunk per
+   *  thread (the calling thread included).  Each thread takes indices from
+   *  the front of its own chunk; a thread that runs out steals the back half
+   *  of the chunk of another thread, so that uneven tasks still keep every
+   *  thread busy until the loop is done.
+   */
+  class ThreadPool {
+
+    public:
+
+      /// Class constructor.
+      explicit ThreadPool(
+          std::size_t threads=0 /** number of threads, the calling one included; 0 for one per core */
+          );
+
+      ThreadPool(const ThreadPool &) = delete;
+      ThreadPool &operator=(const ThreadPool &) = delete;
+
+      /// Stops and joins the workers.
+      ~ThreadPool();
+
+      /// Returns the number of threads, the calling one included.
+      inline std::size_t size() const {
+        return queues.size();
+      };
+
+      /** Calls body(i) for every i in [0, n) and waits for all calls to
+       *  return.  If a call throws, the remaining indices are still run and
+       *  the first exception is rethrown.  Loops are run one at a time; a
+       *  parallelFor called from inside a body runs serially.
+       */
+      void parallelFor(std::size_t n, const std::function<void(std::size_t)> &body);
+
+    private:
+
+      /// The indices [begin, end) left to a thread.
+      struct Queue {
+        std::mutex mutex;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+      };
+
+      void work(std::size_t id);                      ///< Runs tasks until none is left
+      bool pop(std::size_t id, std::size_t &task);    ///< Takes the next task of thread id
+      bool steal(std::size_t id, std::size_t &task);  ///< Takes half the tasks of another thread
+      void runWorker(std::size_t id);                 ///< The loop of a worker thread
+
+      std::vector<std::unique_ptr<Queue>> queues; ///< One queue per thread, the calling one first
+      std::vector<std::thread> workers;           ///< The worker threads
+
+      std::mutex loopMutex;                       ///< Serializes parallelFor calls
+      std::mutex mutex;                           ///< Guards generation, stop and error
+      std::condition_variable wake;               ///< Signals a new loop (or stop) to the workers
+      std::condition_variable done;               ///< Signals the end of a loop to the caller
+      std::size_t generation;                     ///< Number of loops started
+      bool stop;                                  ///< True when the pool is being destroyed
+
+      const std::function<void(std::size_t)> *body; ///< The body of the current loop
+      std::atomic<std::size_t> remaining;           ///< Tasks of the current loop not finished yet
+      std::exception_ptr error;                     ///< The first exception of the current loop
+
+  };
+
+}
+
+#endif
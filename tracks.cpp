@@ -0,0 +1,375 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include "tracks.h"
+#include "frameArena.h"
+#include "geodesy.h"
+#include "gimbaledCamera.h"
+#include "nameTable.h"
+
+namespace gimbaledCamera {
+
+  namespace {
+
+    const double earthRadius = 6371000;   // meters, as the geodesy
+
+    /// The splitmix64 finalizer: spreads the bits of a name id.
+    inline std::uint64_t mix(std::uint64_t x) {
+      x += 0x9e3779b97f4a7c15ULL;
+      x = (x ^ (x >> 30))*0xbf58476d1ce4e5b9ULL;
+      x = (x ^ (x >> 27))*0x94d049bb133111ebULL;
+      return x ^ (x >> 31);
+    }
+
+    /// Milliseconds between two times.
+    inline double milliseconds(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+      return std::chrono::duration<double, std::milli>(to - from).count();
+    }
+
+  }
+
+  // Parse a track file, line by line
+  std::vector<TrackPoint> parseTracks(const char *begin, const char *end) {
+    std::vector<TrackPoint> points;
+    std::size_t line = 0;
+    std::string text, token[7];
+    for (const char *p = begin; p < end; ) {
+      const char *eol = std::find(p, end, '\n');
+      text.assign(p, eol);
+      p = (eol == end) ? end : eol+1;
+      ++line;
+
+      std::istringstream fields(text);
+      std::size_t count = 0;
+      while (count < 7 && fields >> token[count])
+        ++count;
+      if (count == 0 || token[0][0] == '#')                   // blank line or comment
+        continue;
+      if (count != 4 && count != 6)
+        throw std::runtime_error("line " + std::to_string(line) + ": expected time, name, lat, lon and an optional course and speed");
+
+      auto number = [&](std::size_t i, const char *what) {
+        char *last;
+        const double value = strtod(token[i].c_str(), &last);
+        if (*last != '\0' || token[i].empty() || !std::isfinite(value))
+          throw std::runtime_error("line " + std::to_string(line) + ": bad " + what + " '" + token[i] + "'");
+        return value;
+      };
+      TrackPoint point;
+      point.time = number(0, "time");
+      point.name = NameTable::global().intern(token[1]);
+      point.lat  = number(2, "latitude");
+      point.lon  = number(3, "longitude");
+      if (count == 6) {
+        point.course    = number(4, "course");
+        point.speed     = number(5, "speed");
+        point.hasMotion = true;
+      }
+      if (!points.empty() && point.time < points.back().time)
+        throw std::runtime_error("line " + std::to_string(line) + ": report older than the one before");
+      points.push_back(point);
+    }
+    return points;
+  }
+
+  // Load a track file
+  std::vector<TrackPoint> loadTracks(const std::string &path) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input)
+      throw std::runtime_error("cannot open " + path);
+    const std::string text((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    return parseTracks(text.data(), text.data() + text.size());
+  }
+
+  // Write a track file, with the shortest exact representation of each number
+  void saveTracks(const std::vector<TrackPoint> &points, const std::string &path) {
+    std::ofstream output(path);
+    if (!output)
+      throw std::runtime_error("cannot write " + path);
+
+    output << "# time name lat lon [course speed]\n" << std::setprecision(17);
+    for (auto & point : points) {
+      output << point.time << ' ' << NameTable::global().lookup(point.name) << ' ' << point.lat << ' ' << point.lon;
+      if (point.hasMotion)
+        output << ' ' << point.course << ' ' << point.speed;
+      output << '\n';
+    }
+
+    if (!output)
+      throw std::runtime_error("cannot write " + path);
+  }
+
+  // Generate the tracks of a harbour: each vessel follows a smooth path in
+  // meters East and North of the mouth, sampled at its report times
+  std::vector<TrackPoint> makeHarbourTracks(const HarbourScenario &scenario) {
+    std::mt19937 gen(scenario.seed);
+    std::uniform_real_distribution<double> uniform(0., 1.);
+
+    // the path of a vessel: position (x East, y North) and velocity at time t
+    struct Path {
+      int kind;                     // 0 fairway, 1 ferry, 2 anchored, 3 small craft
+      double x0, y0, a, b, w1, w2, phase1, phase2, speed;
+    };
+    auto position = [](const Path &path, double t, double &x, double &y) {
+      switch (path.kind) {
+        case 0:                                               // along the fairway, moored at the inner end
+          x = path.speed > 0 ? std::min(path.x0 + path.speed*t, 2500.) : path.x0 + path.speed*t;
+          y = path.y0;
+          break;
+        case 1: {                                             // across the harbour and back, 60 s at each quay
+          const double crossing = 3000/path.speed, period = 2*(crossing + 60);
+          const double s = std::fmod(t + path.phase1*period, period);
+          const double along = s < 60 ? 0 : s < 60 + crossing ? (s - 60)*path.speed 
+                             : s < 120 + crossing ? 3000 : 3000 - (s - 120 - crossing)*path.speed;
+          x = path.x0;
+          y = -1500 + along;
+          break;
+        }
+        case 2:                                               // swinging around the anchor
+          x = path.x0 + path.a*std::cos(path.w1*t + path.phase1);
+          y = path.y0 + path.a*std::sin(path.w1*t + path.phase1);
+          break;
+        default:                                              // wandering around a point
+          x = path.x0 + path.a*std::cos(path.w1*t + path.phase1) + path.b*std::sin(path.w2*t + path.phase2);
+          y = path.y0 + path.a*std::sin(path.w1*t + path.phase1) + path.b*std::cos(path.w2*t + path.phase2);
+      }
+    };
+
+    std::vector<Path> paths(scenario.vessels);
+    std::vector<std::uint32_t> names(scenario.vessels);
+    const char *prefix[] = {"ship", "ferry", "anchored", "craft"};
+    for (std::size_t i = 0; i < scenario.vessels; ++i) {
+      Path &path = paths[i];
+      const double kind = uniform(gen);
+      path.kind = kind < .3 ? 0 : kind < .4 ? 1 : kind < .7 ? 2 : 3;
+      path.phase1 = 2*M_PI*uniform(gen);
+      path.phase2 = 2*M_PI*uniform(gen);
+      switch (path.kind) {
+        case 0: {
+          const bool inbound = uniform(gen) < .5;
+          path.speed = (inbound ? 1 : -1)*(4 + 3*uniform(gen));
+          path.x0 = -8000 + 10500*uniform(gen);
+          path.y0 = inbound ? -150 : 150;
+          break;
+        }
+        case 1:
+          path.speed = 5 + 2*uniform(gen);
+          path.x0 = 1200 + 600*uniform(gen);
+          path.phase1 = uniform(gen);
+          break;
+        case 2: {
+          const double r = 1000*std::sqrt(uniform(gen)), theta = 2*M_PI*uniform(gen);
+          path.x0 = -2000 + r*std::cos(theta);
+          path.y0 = -3000 + r*std::sin(theta);
+          path.a  = 30 + 40*uniform(gen);
+          path.w1 = 2*M_PI/(900 + 900*uniform(gen));
+          break;
+        }
+        default: {
+          const double r = 3000*std::sqrt(uniform(gen)), theta = 2*M_PI*uniform(gen);
+          path.x0 = r*std::cos(theta);
+          path.y0 = r*std::sin(theta);
+          path.a  = 150 + 300*uniform(gen);                    // up to 7 m/s
+          path.b  = 50 + 150*uniform(gen);
+          path.w1 = 2*M_PI/(900 + 1800*uniform(gen));
+          path.w2 = 2*M_PI/(300 + 600*uniform(gen));
+        }
+      }
+      names[i] = NameTable::global().intern(prefix[path.kind] + std::to_string(i));
+    }
+
+    const double metersToLat = 180/(M_PI*earthRadius), 
+                 metersToLon = metersToLat/std::cos(scenario.lat*M_PI/180);
+    std::vector<TrackPoint> points;
+    points.reserve(std::size_t((scenario.vessels + 1)*(scenario.duration/scenario.reportInterval + 1)));
+
+    // the drone hovers above the mouth
+    for (double t = 0; t <= scenario.duration; t += scenario.reportInterval) {
+      TrackPoint point;
+      point.time = t;
+      point.name = NameTable::global().intern("drone");
+      point.lat  = scenario.lat;
+      point.lon  = scenario.lon;
+      point.hasMotion = true;
+      points.push_back(point);
+    }
+
+    // each vessel reports at its own phase, its velocity by central difference
+    for (std::size_t i = 0; i < scenario.vessels; ++i)
+      for (double t = scenario.reportInterval*uniform(gen); t <= scenario.duration; t += scenario.reportInterval) {
+        double x, y, xBefore, yBefore, xAfter, yAfter;
+        position(paths[i], t, x, y);
+        position(paths[i], t - .5, xBefore, yBefore);
+        position(paths[i], t + .5, xAfter, yAfter);
+        TrackPoint point;
+        point.time   = t;
+        point.name   = names[i];
+        point.lat    = scenario.lat + y*metersToLat;
+        point.lon    = scenario.lon + x*metersToLon;
+        point.speed  = std::hypot(xAfter - xBefore, yAfter - yBefore);
+        point.course = point.speed > 0 ? std::fmod(std::atan2(xAfter - xBefore, yAfter - yBefore)*180/M_PI + 360, 360.) : 0;
+        point.hasMotion = true;
+        points.push_back(point);
+      }
+
+    std::stable_sort(points.begin(), points.end(), 
+        [](const TrackPoint &a, const TrackPoint &b) { return a.time < b.time; });
+    return points;
+  }
+
+  // Replay tracks through the planner, one frame at a time
+  ReplayReport replayTracks(const std::vector<TrackPoint> &points, const ReplayOptions &options) {
+    ReplayReport report;
+    if (points.empty() || !(options.frameRate > 0))
+      return report;
+
+    // the latest report of each vessel, in slots
+    std::uint32_t maxName = 0;
+    for (auto & point : points)
+      maxName = std::max(maxName, point.name);
+    std::vector<std::int64_t> slotOf(std::size_t(maxName) + 1, -1);
+    std::vector<TrackPoint> latest;
+    const std::uint32_t droneName = options.drone.empty() ? points.front().name : NameTable::global().intern(options.drone);
+    std::int64_t droneSlot = -1;
+
+    std::vector<double> lat, lon, bearing, dist, bearingMargin;
+    std::vector<RelativeVessel> vessels;
+    std::vector<std::uint64_t> signatures, previous;
+    std::vector<double> latencies;
+    FrameArena arena;
+    Plan plan;
+
+    const double first = points.front().time, last = points.back().time, period = 1/options.frameRate;
+    const std::size_t frames = std::size_t(std::floor((last - first)*options.frameRate + 1e-9)) + 1;
+    latencies.reserve(frames);
+    const auto start = std::chrono::steady_clock::now();
+    auto due = [&](double t) {                                // the wall time at which recording time t comes
+      return start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>((t - first)/options.speedup));
+    };
+
+    std::size_t next = 0;
+    bool planned = false;
+    for (std::size_t frame = 0; frame < frames; ++frame) {
+      const double t = first + frame*period;
+      if (options.speedup > 0)
+        std::this_thread::sleep_until(due(t));
+      const auto frameStart = std::chrono::steady_clock::now();
+
+      // apply the reports up to t
+      for (; next < points.size() && points[next].time <= t; ++next) {
+        std::int64_t &slot = slotOf[points[next].name];
+        if (slot < 0) {
+          slot = latest.size();
+          latest.push_back(points[next]);
+          if (points[next].name == droneName)
+            droneSlot = slot;
+        } else
+          latest[slot] = points[next];
+      }
+      if (droneSlot < 0)
+        continue;
+
+      // move every vessel to t on the local tangent plane
+      const std::size_t n = latest.size();
+      lat.resize(n);
+      lon.resize(n);
+      bearing.resize(n);
+      dist.resize(n);
+      bearingMargin.resize(n);
+      for (std::size_t i = 0; i < n; ++i) {
+        const TrackPoint &point = latest[i];
+        const double dt = point.hasMotion ? t - point.time : 0, course = point.course*M_PI/180;
+        lat[i] = point.lat + point.speed*std::cos(course)*dt*180/(M_PI*earthRadius);
+        lon[i] = point.lon + point.speed*std::sin(course)*dt*180/(M_PI*earthRadius*std::cos(point.lat*M_PI/180));
+      }
+
+      // plan, as a live planning loop does
+      const Vessel drone(lat[droneSlot], lon[droneSlot], droneName);
+      computeRelativeBatch(drone, n, lat.data(), lon.data(), bearing.data(), dist.data(), bearingMargin.data(), options.margin);
+      vessels.clear();
+      for (std::size_t i = 0; i < n; ++i)
+        if (std::int64_t(i) != droneSlot)
+          vessels.emplace_back(lat[i], lon[i], latest[i].name, bearing[i], dist[i], bearingMargin[i]);
+      arena.reset();
+      makePictures(options.FOV, vessels, plan, arena);
+
+      const auto frameEnd = std::chrono::steady_clock::now();
+      latencies.push_back(milliseconds(frameStart, frameEnd));
+      if (options.speedup > 0 && frameEnd > due(t + period))
+        ++report.lateFrames;
+      report.maxVessels = std::max(report.maxVessels, vessels.size());
+
+      // a picture is known by the set of its vessels: compare with the frame before
+      signatures.clear();
+      for (auto & picture : plan) {
+        std::uint64_t signature = picture.getVessels().size();
+        for (auto & vessel : picture.getVessels())
+          signature += mix(vessel.getNameId());
+        signatures.push_back(signature);
+      }
+      std::sort(signatures.begin(), signatures.end());
+      if (planned) {
+        std::size_t changed = 0;
+        for (std::size_t i = 0, j = 0; i < signatures.size(); ++i) {
+          while (j < previous.size() && previous[j] < signatures[i])
+            ++j;
+          if (j < previous.size() && previous[j] == signatures[i])
+            ++j;
+          else
+            ++changed;
+        }
+        report.changedPictures += changed;
+        report.changedFrames += (changed > 0 || signatures.size() != previous.size());
+      }
+      signatures.swap(previous);
+      planned = true;
+    }
+
+    report.frames        = latencies.size();
+    report.recordingTime = last - first;
+    report.wallTime      = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    report.plansPerSecond = report.wallTime > 0 ? report.frames/report.wallTime : 0;
+    if (!latencies.empty()) {
+      std::sort(latencies.begin(), latencies.end());
+      auto percentile = [&latencies](double q) {           // nearest rank
+        return latencies[std::min(latencies.size() - 1, std::size_t(std::ceil(q*latencies.size())) - 1)];
+      };
+      report.latencyP50 = percentile(.5);
+      report.latencyP90 = percentile(.9);
+      report.latencyP99 = percentile(.99);
+      report.latencyMax = latencies.back();
+    }
+    return report;
+  }
+
+}
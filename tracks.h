@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef TRACKS_H
+#define TRACKS_H
+
+/** @file 
+ *  Recorded vessel tracks, and their replay through the planner.
+ *
+ *  A track file holds timestamped position reports, one per line, in
+ *  nondecreasing order of time:
+ *
+ *      # comment
+ *      time name lat lon [course speed]
+ *
+ *  with the time in seconds from the start of the recording, latitude and
+ *  longitude in degrees, and the optional course (degrees clockwise from
+ *  North) and speed (meters per second) over ground.  Between two reports, a
+ *  vessel with a course and speed is dead-reckoned, and one without stays
+ *  where it was last reported.
+ */
+
+namespace gimbaledCamera {
+
+  /// One position report of a track file.
+  struct TrackPoint {
+    double time;              ///< Time of the report, in seconds from the start of the recording
+    std::uint32_t name;       ///< Vessel name, as an id in NameTable::global()
+    double lat;               ///< Latitude, in degrees
+    double lon;               ///< Longitude, in degrees
+    double course = 0;        ///< Course over ground, in degrees clockwise from North
+    double speed  = 0;        ///< Speed over ground, in meters per second
+    bool hasMotion = false;   ///< True if the report gives course and speed
+  };
+
+  /** Parses a track file.  Throws std::runtime_error, with the line number,
+   *  on malformed input or on a report older than the one before.
+   */
+  std::vector<TrackPoint> parseTracks(
+      const char *begin /** first character */, 
+      const char *end   /** one past the last character */
+      );
+
+  /// Loads a track file.
+  std::vector<TrackPoint> loadTracks(const std::string &path);
+
+  /// Writes a track file (coordinates round-trip exactly).
+  void saveTracks(const std::vector<TrackPoint> &points, const std::string &path);
+
+  /** A synthetic harbour: a fairway running from the open sea (to the
+   *  West) through the harbour mouth, an anchorage South of the mouth, a
+   *  ferry line across the harbour, and small craft around it.  The drone
+   *  (named "drone", reported first) hovers above the mouth.
+   */
+  struct HarbourScenario {
+    double lat = 37.81;             ///< Latitude of the harbour mouth, in degrees
+    double lon = -122.48;           ///< Longitude of the harbour mouth, in degrees
+    std::size_t vessels = 200;      ///< Number of vessels, the drone not included
+    double duration = 600;          ///< Length of the recording, in seconds
+    double reportInterval = 2;      ///< Time between two reports of a vessel, in seconds
+    unsigned seed = 1;              ///< Seed of the random traffic
+  };
+
+  /** Generates the tracks of a harbour: 30% of the vessels transit the
+   *  fairway (in or out), 10% are ferries going back and forth, 30% swing
+   *  at anchor and 30% are small craft wandering around the mouth.  Each
+   *  vessel reports, with its course and speed, every reportInterval, at a
+   *  random phase (as AIS transponders do).
+   */
+  std::vector<TrackPoint> makeHarbourTracks(const HarbourScenario &scenario=HarbourScenario());
+
+  /// How replayTracks plans.
+  struct ReplayOptions {
+    double FOV = 80;          ///< Camera field of view, in degrees
+    double frameRate = 10;    ///< Plans per second of recording
+    double speedup = 1;       ///< Replay speed: 1 is real time, 0 as fast as possible
+    double margin = 100;      ///< Radius of the region around each vessel we want to capture, in meters
+    std::string drone;        ///< Name of the drone's track (the first name of the file if empty)
+  };
+
+  /// What replayTracks measured.
+  struct ReplayReport {
+    std::size_t frames = 0;         ///< Plans made
+    std::size_t maxVessels = 0;     ///< Most vessels planned in a frame
+    double recordingTime = 0;       ///< Recording time replayed, in seconds
+    double wallTime = 0;            ///< Time taken to replay it, in seconds
+    double plansPerSecond = 0;      ///< Plans made per second of wall time
+    double latencyP50 = 0;          ///< Median time to update and plan a frame, in milliseconds
+    double latencyP90 = 0;          ///< 90th percentile of the frame latency, in milliseconds
+    double latencyP99 = 0;          ///< 99th percentile of the frame latency, in milliseconds
+    double latencyMax = 0;          ///< Longest frame latency, in milliseconds
+    std::size_t lateFrames = 0;     ///< Frames planned after the next one was due (real-time replay only)
+    std::size_t changedFrames = 0;  ///< Frames whose pictures differ from the frame before
+    std::size_t changedPictures = 0;///< Pictures holding a set of vessels no picture of the frame before held
+
+    /// Overloads the << operator (the stream flags and precision are left as they were).
+    friend std::ostream &operator<<(std::ostream &output, const ReplayReport &r) {
+      const std::ios_base::fmtflags flags = output.flags();
+      const std::streamsize precision = output.precision();
+      output << std::fixed << std::setprecision(3)
+        << "Frames: ........................ " << r.frames << " (" << r.recordingTime << " s of recording in " << r.wallTime << " s)" << std::endl
+        << "Plans per second: .............. " << std::setprecision(1) << r.plansPerSecond << std::endl
+        << "Vessels per frame: ............. up to " << r.maxVessels << std::endl
+        << "Frame latency: ................. " << std::setprecision(3) 
+        << "p50 " << r.latencyP50 << " ms, p90 " << r.latencyP90 << " ms, p99 " << r.latencyP99 
+        << " ms, max " << r.latencyMax << " ms" << std::endl
+        << "Late frames: ................... " << r.lateFrames << std::endl
+        << "Frames with changed pictures: .. " << r.changedFrames << " (" << r.changedPictures << " pictures changed)" 
+        << std::endl;
+      output.flags(flags);
+      output.precision(precision);
+      return output;
+    }
+  };
+
+  /** Replays tracks through the planner.
+   *
+   *  Frames are frameRate per second of recording, from the first report
+   *  to the last.  Each frame applies the reports up to its time, moves
+   *  every vessel (and the drone) to that time, and plans the pictures
+   *  with makePictures into a kept plan and FrameArena, as a live planning
+   *  loop would.  With a speedup, each frame waits for its time to come
+   *  (scaled by the speedup); otherwise frames follow each other.  Frames
+   *  before the drone's first report are skipped.
+   */
+  ReplayReport replayTracks(
+      const std::vector<TrackPoint> &points         /** the reports, in order of time */,
+      const ReplayOptions &options=ReplayOptions()  /** how to plan */
+      );
+
+}
+
+#endif
@@ -21,7 +21,92 @@
  */
 
 #include <gtest/gtest.h> 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <new>
+#include <numeric>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
 #include "gimbaledCamera.h"
+#include "boundedQueue.h"
+#include "budgetedPlanner.h"
+#include "compactVessel.h"
+#include "contactQueue.h"
+#include "frameArena.h"
+#include "geodesy.h"
+#include "incrementalPlanner.h"
+#include "motionPlanner.h"
+#include "observerFrame.h"
+#include "panTiltPlanner.h"
+#include "parallelPlanner.h"
+#include "planBatch.h"
+#include "planDaemon.h"
+#include "scheduleWriter.h"
+#include "slewScheduler.h"
+#include "spatialIndex.h"
+#include "stats.h"
+#include "streamPlanner.h"
+#include "tracks.h"
+#include "vesselIO.h"
+#include "zoomPlanner.h"
+
+/* Counting the allocations made by this thread between
+ * startCountingAllocations and stopCountingAllocations (see
+ * Pictures.ArenaPlanning).  With STATS=1 the library already replaces the
+ * global operator new, and counts the allocations made while a timer is open
+ * (see stats.h); otherwise it is replaced here.
+ */
+#ifdef GIMBALEDCAMERA_STATS
+
+static std::uint64_t allocationsBefore = 0;
+
+void startCountingAllocations() {
+  ++gimbaledCamera::stats::openTimers;
+  allocationsBefore = gimbaledCamera::stats::get(gimbaledCamera::stats::Counter::Allocations);
+}
+
+std::uint64_t stopCountingAllocations() {
+  --gimbaledCamera::stats::openTimers;
+  return gimbaledCamera::stats::get(gimbaledCamera::stats::Counter::Allocations) - allocationsBefore;
+}
+
+#else
+
+static std::atomic<bool> countAllocations(false);
+static std::atomic<std::size_t> allocations(0);
+
+__attribute__((noinline)) void *operator new(std::size_t size) {
+  if (countAllocations.load(std::memory_order_relaxed))
+    allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+// (not inlined, so that the compiler does not pair malloc with new)
+__attribute__((noinline)) void operator delete(void *p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+void startCountingAllocations() {
+  allocations = 0;
+  countAllocations = true;
+}
+
+std::uint64_t stopCountingAllocations() {
+  countAllocations = false;
+  return allocations.load();
+}
+
+#endif
 
   struct Data { 
     std::string name; 
@@ -57,6 +142,53 @@ TEST(Vessel, LatLon) {
   ASSERT_STREQ(testDataDrone.name.c_str(), drone.getName().c_str());
 }
 
+/* Test the interned names and the compact vessel record */
+TEST(Vessel, CompactRecords) {
+
+  // names are stored once, and vessels only refer to them
+  gimbaledCamera::NameTable &names = gimbaledCamera::NameTable::global();
+  gimbaledCamera::Vessel a(1, 2, std::string("a rather long vessel name")), b(3, 4, std::string("a rather long vessel name"));
+  EXPECT_EQ(a.getNameId(), b.getNameId());
+  EXPECT_EQ(&a.getName(), &b.getName());
+  EXPECT_EQ(a.getName(), "a rather long vessel name");
+  EXPECT_EQ(names.lookup(names.intern("another")), "another");
+  EXPECT_EQ(names.lookup(0), "");
+  EXPECT_LE(sizeof(gimbaledCamera::Vessel), 40);
+  EXPECT_LE(sizeof(gimbaledCamera::RelativeVessel), 64);
+  EXPECT_EQ(sizeof(gimbaledCamera::CompactVessel), 24);
+
+  // a compact vessel keeps the values to float precision, and its bearing
+  // range contains that of the vessel it was made from
+  std::mt19937 gen(16);
+  std::uniform_real_distribution<double> offset(-.2, .2);
+  gimbaledCamera::Vessel drone(testDataDrone.lat, testDataDrone.lon, testDataDrone.name);
+  gimbaledCamera::VesselSnapshot snapshot;
+  for (int i = 0; i < 5000; ++i)
+    snapshot.push_back("V" + std::to_string(i), testDataDrone.lat + offset(gen), testDataDrone.lon + offset(gen));
+  const std::vector<gimbaledCamera::CompactVessel> compact = makeCompactVessels(drone, snapshot);
+  ASSERT_EQ(compact.size(), snapshot.size());
+  std::vector<gimbaledCamera::RelativeVessel> expanded;
+  for (std::size_t i = 0; i < compact.size(); ++i) {
+    const gimbaledCamera::RelativeVessel exact(snapshot.getLatDeg(i), snapshot.getLonDeg(i), std::string(snapshot.getName(i)), drone);
+    EXPECT_EQ(compact[i].getName(), exact.getName());
+    EXPECT_NEAR(compact[i].getLatDeg(), exact.getLatDeg(), 1e-7);
+    EXPECT_NEAR(compact[i].getLonDeg(), exact.getLonDeg(), 1e-7);
+    EXPECT_NEAR(compact[i].getDistance(), exact.getDistance(), 1e-3);
+    EXPECT_LE(compact[i].getBearing() - compact[i].getMargin(), exact.getBearing() - exact.getMargin() + 1e-13);
+    EXPECT_GE(compact[i].getBearing() + compact[i].getMargin(), exact.getBearing() + exact.getMargin() - 1e-13);
+    expanded.push_back(compact[i].expand());
+  }
+
+  // and planning them is planning their expansion
+  const gimbaledCamera::Plan plan = makePictures(30., compact), reference = makePictures(30., expanded);
+  ASSERT_EQ(plan.size(), reference.size());
+  for (std::size_t j = 0; j < plan.size(); ++j) {
+    EXPECT_EQ(plan[j].getCameraAngleDeg('C'), reference[j].getCameraAngleDeg('C'));
+    ASSERT_EQ(plan[j].countVessels(), reference[j].countVessels());
+    EXPECT_EQ(plan[j].getVessels().front().getNameId(), reference[j].getVessels().front().getNameId());
+  }
+}
+
 /* Test computation of bearing and distance from the RelativeVessel class.
  * Reference values (the last two columns of testData) are computed independently
  * using python.  We allow an error of 0.1 degrees and 10m because a different
@@ -73,6 +205,147 @@ TEST(RelativeVessel, BearingAndDistance) {
   }
 }
 
+// Long double reference bearing and margin (100 m) of lat2, lon2 from lat1, lon1 (radians)
+void referenceGeometry(long double lat1, long double lon1, long double lat2, long double lon2,
+    long double &bearing, long double &margin) {
+  const long double R = 6371000;
+  const long double dLat = lat2 - lat1, dLon = lon2 - lon1;
+  const long double X = cosl(lat2)*sinl(dLon),
+                    Y = sinl(dLat) + 2*sinl(lat1)*cosl(lat2)*sinl(dLon/2)*sinl(dLon/2);
+  const long double a = sinl(dLat/2)*sinl(dLat/2) + sinl(dLon/2)*sinl(dLon/2)*cosl(lat1)*cosl(lat2);
+  bearing = atan2l(Y, X);
+  margin  = asinl(100/(R*2*asinl(sqrtl(a))));
+}
+
+// Worst bearing plus margin error of policy P against a long double
+// reference, over vessels 200 m to 5000 km away from drones up to 75 degrees
+// of latitude
+template<class P> double worstAngularError() {
+  std::mt19937 gen(12);
+  std::uniform_real_distribution<double> uniform(0., 1.);
+  const long double R = 6371000;
+  double worst = 0;
+  for (int k = 0; k < 100000; ++k) {
+    const double droneLat = (150*uniform(gen) - 75)*M_PI/180, droneLon = (360*uniform(gen) - 180)*M_PI/180;
+    const long double dist = 200*std::pow(25000., uniform(gen)), theta = 2*M_PI*uniform(gen); // clockwise from North
+    const long double d = dist/R;
+    const double lat = asinl(sinl(droneLat)*cosl(d) + cosl(droneLat)*sinl(d)*cosl(theta));
+    const double lon = droneLon + atan2l(sinl(theta)*sinl(d)*cosl(droneLat), cosl(d) - sinl(droneLat)*sinl(lat));
+
+    gimbaledCamera::Vessel drone(droneLat*180/M_PI, droneLon*180/M_PI, "drone");
+    gimbaledCamera::RelativeVessel vessel(lat*180/M_PI, lon*180/M_PI, "vessel", drone, 100, P());
+
+    // reference, from the positions as stored (in radians)
+    long double refBearing, refMargin;
+    referenceGeometry(drone.getLat(), drone.getLon(), vessel.getLat(), vessel.getLon(), refBearing, refMargin);
+
+    const double bearingError = std::fabs(remainderl(vessel.getBearing() - refBearing, 2*M_PI));
+    const double marginError  = std::fabs(vessel.getMargin() - P::maxAngularError - refMargin);
+    worst = std::max(worst, bearingError + marginError);
+  }
+  return worst;
+}
+
+/* Test the error bounds of the fast geometry policies, and that their
+ * inflated margins still cover every vessel.
+ */
+TEST(RelativeVessel, PrecisionPolicies) {
+
+  // the default policy is the historical computation
+  gimbaledCamera::Vessel drone(testDataDrone.lat, testDataDrone.lon, testDataDrone.name);
+  for (auto & tmp : testData) {
+    gimbaledCamera::RelativeVessel a(tmp.lat, tmp.lon, tmp.name, drone),
+                                   b(tmp.lat, tmp.lon, tmp.name, drone, 100, gimbaledCamera::precision::Exact());
+    EXPECT_EQ(a.getBearing(), b.getBearing());
+    EXPECT_EQ(a.getDistance(), b.getDistance());
+    EXPECT_EQ(a.getMargin(), b.getMargin());
+  }
+
+  // the documented bounds hold
+  EXPECT_LE(worstAngularError<gimbaledCamera::precision::Exact>(), 1e-10);
+  EXPECT_LE(worstAngularError<gimbaledCamera::precision::Poly>(),  gimbaledCamera::precision::Poly::maxAngularError);
+  EXPECT_LE(worstAngularError<gimbaledCamera::precision::Table>(), gimbaledCamera::precision::Table::maxAngularError);
+
+  // so inflated margins contain the exact ones, and the pictures still cover every vessel
+  std::vector<gimbaledCamera::RelativeVessel> exact, fast;
+  for (auto & tmp : testData) {
+    exact.emplace_back(tmp.lat, tmp.lon, tmp.name, drone);
+    fast.emplace_back(tmp.lat, tmp.lon, tmp.name, drone, 100, gimbaledCamera::precision::Poly());
+    EXPECT_GE(fast.back().getMargin(), exact.back().getMargin());
+  }
+  const gimbaledCamera::Plan plan = makePictures(80., fast);
+  EXPECT_EQ(plan.size(), makePictures(80., exact).size());
+}
+
+/* Test the local projection of the observer frame against the spherical
+ * formulas, one vessel at a time and in batches.
+ */
+TEST(RelativeVessel, ObserverFrame) {
+
+  // vessels 200 m to 50 km away from drones up to 75 degrees of latitude: the
+  // projected ones are within their error bound, the others are exact
+  std::mt19937 gen(13);
+  std::uniform_real_distribution<double> uniform(0., 1.);
+  int projected = 0;
+  for (int k = 0; k < 20000; ++k) {
+    gimbaledCamera::Vessel drone(150*uniform(gen) - 75, 360*uniform(gen) - 180, "drone");
+    const gimbaledCamera::ObserverFrame frame(drone);
+    const double dist = 200*std::pow(250., uniform(gen)), theta = 2*M_PI*uniform(gen);
+    const double lat = drone.getLatDeg() + dist*cos(theta)/111195,
+                 lon = drone.getLonDeg() + dist*sin(theta)/(111195*cos(drone.getLat()));
+
+    const gimbaledCamera::RelativeVessel vessel = frame.relative(lat, lon, "vessel");
+    const gimbaledCamera::RelativeVessel exact(lat, lon, "vessel", drone);
+    double bearing, distance, error;
+    if (frame.locate(vessel.getLat(), vessel.getLon(), bearing, distance, error)) {
+      ++projected;
+      long double refBearing, refMargin;
+      referenceGeometry(drone.getLat(), drone.getLon(), vessel.getLat(), vessel.getLon(), refBearing, refMargin);
+      EXPECT_LE(error, frame.getTolerance());
+      EXPECT_LE(std::fabs(remainderl(vessel.getBearing() - refBearing, 2*M_PI)) 
+          + std::fabs(vessel.getMargin() - error - refMargin), error);
+      EXPECT_NEAR(vessel.getDistance(), exact.getDistance(), 1e-3*exact.getDistance());
+      EXPECT_LE(vessel.getDistance(), frame.getPlanarRange()*1.01);
+    } else {
+      EXPECT_EQ(vessel.getBearing(), exact.getBearing());
+      EXPECT_EQ(vessel.getDistance(), exact.getDistance());
+      EXPECT_EQ(vessel.getMargin(), exact.getMargin());
+      EXPECT_GE(vessel.getDistance(), frame.getPlanarRange()*.99);
+    }
+  }
+  EXPECT_GT(projected, 10000);
+
+  // the batch gives the same vessels, and the same pictures as the spherical formulas
+  gimbaledCamera::Vessel drone(testDataDrone.lat, testDataDrone.lon, testDataDrone.name);
+  const gimbaledCamera::ObserverFrame frame(drone);
+  EXPECT_DOUBLE_EQ(frame.getPlanarRange(), 20000);
+  std::vector<double> lat, lon;
+  std::vector<gimbaledCamera::RelativeVessel> exact, planar;
+  for (auto & tmp : testData) {
+    lat.push_back(tmp.lat);
+    lon.push_back(tmp.lon);
+    exact.emplace_back(tmp.lat, tmp.lon, tmp.name, drone);
+    planar.push_back(frame.relative(tmp.lat, tmp.lon, tmp.name));
+  }
+  std::vector<double> bearing(lat.size()), dist(lat.size()), margin(lat.size());
+  EXPECT_EQ(frame.computeBatch(lat.size(), lat.data(), lon.data(), bearing.data(), dist.data(), margin.data()), 0);
+  for (std::size_t i = 0; i < lat.size(); ++i) {
+    EXPECT_EQ(bearing[i], planar[i].getBearing());
+    EXPECT_EQ(margin[i], planar[i].getMargin());
+    EXPECT_GE(planar[i].getMargin(), exact[i].getMargin());
+  }
+  const gimbaledCamera::Plan plan = makePictures(80., planar), reference = makePictures(80., exact);
+  ASSERT_EQ(plan.size(), reference.size());
+  for (std::size_t i = 0; i < plan.size(); ++i)
+    EXPECT_EQ(plan[i].countVessels(), reference[i].countVessels());
+
+  // a zero tolerance sends every vessel to the sphere
+  const gimbaledCamera::ObserverFrame sphere(drone, 20000, 0);
+  EXPECT_EQ(sphere.computeBatch(lat.size(), lat.data(), lon.data(), bearing.data(), dist.data(), margin.data()), lat.size());
+  for (std::size_t i = 0; i < lat.size(); ++i)
+    EXPECT_EQ(bearing[i], exact[i].getBearing());
+}
+
 /* Test the generation of the Picture class */
 TEST(Pictures, MakePictures) {
   gimbaledCamera::Vessel drone(testDataDrone.lat, testDataDrone.lon, testDataDrone.name);
@@ -83,7 +356,7 @@ TEST(Pictures, MakePictures) {
     vessels.push_back(vessel);
   }
 
-  std::list<gimbaledCamera::Picture> pictures = makePictures(80., vessels);
+  gimbaledCamera::Plan pictures = makePictures(80., vessels);
   
   EXPECT_EQ(pictures.size()                 , 2)                    << "The number of pictures produced is not as expected";
   EXPECT_EQ(pictures.front().countVessels() , 4)                    << "The first picture does not have the expected number of vessels";
@@ -96,6 +369,1481 @@ TEST(Pictures, MakePictures) {
   EXPECT_NEAR(pictures.back().getCameraAngleDeg('C')  , 58.8  , .1) << "The camera angle for the last picture in the 'C' reference system is incorrect";
 }
 
+/* Test that the pictures of a Plan are contiguous views into its vessel
+ * buffer, and that copying a Plan points the pictures to the copy.
+ */
+TEST(Pictures, PlanStorage) {
+  gimbaledCamera::Vessel drone(testDataDrone.lat, testDataDrone.lon, testDataDrone.name);
+
+  std::vector<gimbaledCamera::RelativeVessel> vessels;
+  for (auto & testVessel : testData)
+    vessels.emplace_back(testVessel.lat, testVessel.lon, testVessel.name, drone);
+
+  gimbaledCamera::Plan plan = makePictures(80., std::move(vessels));
+  const std::vector<gimbaledCamera::RelativeVessel> &buffer = plan.getVessels();
+  ASSERT_EQ(buffer.size(), testData.size());
+
+  // the pictures tile the buffer in order, the merged picture first
+  const gimbaledCamera::RelativeVessel *next = buffer.data();
+  for (auto & picture : plan) {
+    EXPECT_EQ(picture.getVessels().begin(), next);
+    next = picture.getVessels().end();
+  }
+  EXPECT_EQ(next, buffer.data() + buffer.size());
+  EXPECT_EQ(plan.front().getVessels().front().getName(), "Neo");
+  EXPECT_EQ(plan.front().getVessels().back().getName(),  "SmithS");
+
+  gimbaledCamera::Plan copy = plan;
+  ASSERT_EQ(copy.size(), plan.size());
+  for (std::size_t k = 0; k < plan.size(); ++k) {
+    EXPECT_GE(copy[k].getVessels().begin(), copy.getVessels().data());
+    EXPECT_LE(copy[k].getVessels().end(),   copy.getVessels().data() + copy.getVessels().size());
+    EXPECT_EQ(copy[k].countVessels(),           plan[k].countVessels());
+    EXPECT_EQ(copy[k].getCameraAngleDeg('C'),   plan[k].getCameraAngleDeg('C'));
+  }
+}
+
+/* Test that planning into a kept plan, with a FrameArena for scratch,
+ * makes the pictures of makePictures, and no heap allocation once the plan
+ * and the arena have grown.
+ */
+TEST(Pictures, ArenaPlanning) {
+  gimbaledCamera::Vessel drone(testDataDrone.lat, testDataDrone.lon, testDataDrone.name);
+  std::mt19937 gen(5);
+  std::uniform_real_distribution<double> offset(-.05, .05);
+  std::vector<gimbaledCamera::RelativeVessel> vessels;
+  for (int i = 0; i < 500; ++i)
+    vessels.emplace_back(testDataDrone.lat + offset(gen), testDataDrone.lon + offset(gen), "a" + std::to_string(i), drone);
+  vessels.push_back(vessels[7]);                                   // equal bearings keep their order
+
+  gimbaledCamera::FrameArena arena(256);
+  gimbaledCamera::Plan plan;
+  for (int frame = 0; frame < 3; ++frame) {
+    arena.reset();
+    makePictures(30., vessels, plan, arena);
+  }
+  EXPECT_GT(arena.countGrowths(), 0u);
+  const gimbaledCamera::Plan expected = makePictures(30., vessels);
+  ASSERT_EQ(plan.size(), expected.size());
+  for (std::size_t k = 0; k < plan.size(); ++k) {
+    ASSERT_EQ(plan[k].countVessels(), expected[k].countVessels());
+    EXPECT_EQ(plan[k].getCameraAngleDeg('C'), expected[k].getCameraAngleDeg('C'));
+    for (int i = 0; i < plan[k].countVessels(); ++i)
+      EXPECT_EQ(plan[k].getVessels()[i].getName(), expected[k].getVessels()[i].getName());
+  }
+
+  // the steady state: fleets of the same size, no allocation
+  const std::size_t growths = arena.countGrowths();
+  std::vector<std::vector<gimbaledCamera::RelativeVessel>> frames(10, vessels);
+  for (auto & frame : frames)
+    std::shuffle(frame.begin(), frame.end(), gen);
+  startCountingAllocations();
+  for (auto & frame : frames) {
+    arena.reset();
+    makePictures(30., frame, plan, arena);
+  }
+  EXPECT_EQ(stopCountingAllocations(), 0u);
+  EXPECT_EQ(arena.countGrowths(), growths);
+  EXPECT_EQ(plan.size(), expected.size());
+}
+
+/* Test the camera angles cached by Picture against the way they were
+ * computed before (from the first and last vessel), in every frame.
+ */
+TEST(Pictures, CachedGeometry) {
+
+  gimbaledCamera::Vessel drone(testDataDrone.lat, testDataDrone.lon, testDataDrone.name);
+  std::vector<gimbaledCamera::RelativeVessel> vessels;
+  for (auto & tmp : testData)
+    vessels.emplace_back(tmp.lat, tmp.lon, tmp.name, drone);
+  const gimbaledCamera::Plan plan = makePictures(80., vessels);
+
+  for (auto & picture : plan) {
+    // the angles as computed before they were cached
+    const std::complex<double> a = std::polar(1., picture.getVessels().front().getBearing()),
+                               b = std::polar(1., picture.getVessels().back().getBearing());
+    const double mean = std::arg((a+b)/2.);
+    EXPECT_EQ(picture.getCameraAngleDeg<gimbaledCamera::Frame::East>()  , mean*180/M_PI);
+    EXPECT_EQ(picture.getCameraAngleDeg<gimbaledCamera::Frame::North>() , fmod(450-mean*180/M_PI, 360.));
+    EXPECT_EQ(picture.getCameraAngleDeg<gimbaledCamera::Frame::Camera>(), fmod(450-(mean+40*M_PI/180)*180/M_PI, 360.));
+    EXPECT_EQ(picture.getMaxAngularDistanceDeg()                        , std::arg(b/a)*180/M_PI);
+
+    // every way of naming a frame gives the same angle
+    EXPECT_EQ(picture.getCameraAngleDeg('E'), picture.getCameraAngleDeg(gimbaledCamera::Frame::East));
+    EXPECT_EQ(picture.getCameraAngleDeg('N'), picture.getCameraAngleDeg(gimbaledCamera::Frame::North));
+    EXPECT_EQ(picture.getCameraAngleDeg('C'), picture.getCameraAngleDeg(gimbaledCamera::Frame::Camera));
+  }
+}
+
+/* Test makeMinimalPictures against a brute-force oracle that tries every
+ * possible set of cuts between consecutive vessels (sorted by bearing) on
+ * small random fleets.
+ */
+TEST(Pictures, MakeMinimalPictures) {
+  gimbaledCamera::Vessel drone(testDataDrone.lat, testDataDrone.lon, testDataDrone.name);
+
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<double> offset(-.03, .03);
+  const double FOVs[] = {30., 80., 120.};
+
+  for (int trial = 0; trial < 300; ++trial) {
+    const double FOV = FOVs[trial%3];
+    const int n = 1 + trial%9;
+
+    std::list<gimbaledCamera::RelativeVessel> vessels;
+    for (int i = 0; i < n; ++i)
+      vessels.push_back(gimbaledCamera::RelativeVessel(
+            testDataDrone.lat + offset(gen), testDataDrone.lon + offset(gen), std::to_string(i), drone));
+
+    // oracle: vessel edges sorted by bearing, then every subset of cuts
+    std::list<gimbaledCamera::RelativeVessel> sorted = vessels;
+    sorted.sort(gimbaledCamera::sortByBearing);
+    std::vector<double> bearing, margin;
+    for (auto & vessel : sorted) {
+      bearing.push_back(vessel.getBearing());
+      margin.push_back(vessel.getMargin());
+    }
+    auto feasible = [&](int start, int length) {
+      double lo = INFINITY, hi = -INFINITY;
+      for (int k = start; k < start+length; ++k) {
+        const double b = bearing[k%n] + (k >= n ? 2*M_PI : 0);
+        lo = std::min(lo, b - margin[k%n]);
+        hi = std::max(hi, b + margin[k%n]);
+      }
+      return length == 1 || hi - lo < FOV*M_PI/180; // a vessel wider than the FOV gets its own picture
+    };
+
+    int best = n;
+    for (int start = 0; start < n; ++start)
+      if (feasible(start, n))
+        best = 1;
+    for (int cuts = 1; cuts < (1 << n); ++cuts) {
+      int first = 0;
+      while (!(cuts & (1 << first)))
+        ++first;
+      int count = 0, start = first;
+      bool ok = true;
+      for (int k = first+1; k <= first+n; ++k)
+        if (cuts & (1 << (k%n))) {
+          ok = ok && feasible(start, k-start);
+          start = k;
+          ++count;
+        }
+      if (ok)
+        best = std::min(best, count);
+    }
+
+    gimbaledCamera::Plan pictures = makeMinimalPictures(FOV, vessels);
+
+    int total = 0;
+    for (auto & picture : pictures)
+      total += picture.countVessels();
+    EXPECT_EQ(int(pictures.size()), best) << "trial " << trial;
+    EXPECT_EQ(total, n)                   << "trial " << trial;
+  }
+
+  // the reference data needs two pictures as well
+  std::list<gimbaledCamera::RelativeVessel> vessels;
+  for (auto & testVessel : testData)
+    vessels.push_back(gimbaledCamera::RelativeVessel(testVessel.lat, testVessel.lon, testVessel.name, drone));
+  EXPECT_EQ(makeMinimalPictures(80., vessels).size(), 2);
+}
+
+// The most weight K pictures can hold, by trying every set of runs of
+// consecutive vessels starting from every vessel
+double bruteForceBudget(double FOV, std::vector<gimbaledCamera::RelativeVessel> vessels, 
+    const std::vector<double> &weight, std::size_t K) {
+  const std::size_t n = vessels.size();
+  auto span = [&](std::size_t first, std::size_t count) {   // vessels [first, first+count) modulo n
+    double lo = INFINITY, hi = -INFINITY;
+    for (std::size_t i = first; i < first + count; ++i) {
+      const double turn = i >= n ? 2*M_PI : 0;
+      lo = std::min(lo, vessels[i%n].getBearing() - vessels[i%n].getMargin() + turn);
+      hi = std::max(hi, vessels[i%n].getBearing() + vessels[i%n].getMargin() + turn);
+    }
+    return hi - lo;
+  };
+  std::function<double(std::size_t, std::size_t, std::size_t)> best = [&](std::size_t origin, std::size_t p, std::size_t k) {
+    if (p == n)
+      return 0.;
+    double value = best(origin, p+1, k), w = 0;
+    for (std::size_t count = 1; k > 0 && p + count <= n; ++count) {
+      w += weight[(origin + p + count - 1)%n];
+      if (count == 1 || span(origin + p, count) < FOV*M_PI/180)
+        value = std::max(value, w + best(origin, p + count, k-1));
+    }
+    return value;
+  };
+  double value = 0;
+  for (std::size_t origin = 0; origin < n; ++origin)
+    value = std::max(value, best(origin, 0, K));
+  return value;
+}
+
+/* Test that the budgeted pictures hold the most weight possible, are
+ * disjoint and within the FOV, and are the minimal cover if K allows.
+ */
+TEST(Pictures, BudgetedPictures) {
+  gimbaledCamera::Vessel drone(testDataDrone.lat, testDataDrone.lon, testDataDrone.name);
+  std::mt19937 gen(5);
+  std::uniform_real_distribution<double> uniform(0., 1.);
+
+  for (int trial = 0; trial < 300; ++trial) {
+    // a few clusters of vessels, or vessels all around; some close enough to have wide margins
+    const bool clusters = trial%3 == 0;
+    const std::size_t n = clusters ? 1 + gen()%10 : 8 + gen()%5;
+    std::vector<gimbaledCamera::RelativeVessel> vessels;
+    std::map<std::string, double> weightOf;
+    for (std::size_t i = 0; i < n; ++i) {
+      const double bearing = clusters ? (gen()%3)*2.1 + .8*uniform(gen) : 2*M_PI*uniform(gen);
+      const double dist = 300 + 3000*uniform(gen);
+      const std::string name = "b" + std::to_string(i);
+      vessels.emplace_back(testDataDrone.lat + dist*sin(bearing)/111000, 
+          testDataDrone.lon + dist*cos(bearing)/(111000*cos(testDataDrone.lat*M_PI/180)), name, drone);
+      weightOf[name] = (gen()%4)*uniform(gen);
+    }
+    const gimbaledCamera::BudgetedPlanner::Weight weight = 
+      [&](const gimbaledCamera::RelativeVessel &v) { return weightOf[v.getName()]; };
+    std::vector<double> weights;
+    std::vector<gimbaledCamera::RelativeVessel> sorted = vessels;
+    std::stable_sort(sorted.begin(), sorted.end(), gimbaledCamera::sortByBearing);
+    for (auto & vessel : sorted)
+      weights.push_back(weightOf[vessel.getName()]);
+    const double FOV = clusters ? 20 + 60*uniform(gen) : 60 + 60*uniform(gen);
+    const std::size_t minimal = makeMinimalPictures(FOV, vessels).size();
+
+    for (std::size_t K = 0; K <= minimal; ++K) {
+      gimbaledCamera::BudgetedPlanner planner(FOV, trial%2 ? 16 : 1);
+      const gimbaledCamera::Plan plan = planner.plan(vessels, K, weight);
+      const gimbaledCamera::BudgetReport &report = planner.getReport();
+      ASSERT_LE(plan.size(), K);
+
+      double held = 0;
+      std::set<std::string> seen;
+      for (auto & picture : plan) {
+        const double spanDeg = (picture.getVessels().back().getBearing() + picture.getVessels().back().getMargin()
+            - picture.getVessels().front().getBearing() + picture.getVessels().front().getMargin())*180/M_PI;
+        EXPECT_TRUE(picture.countVessels() == 1 || remainder(spanDeg, 360.) < FOV) << "trial " << trial;
+        for (auto & vessel : picture.getVessels()) {
+          EXPECT_TRUE(seen.insert(vessel.getName()).second) << "trial " << trial;
+          held += weightOf[vessel.getName()];
+        }
+      }
+      EXPECT_NEAR(held, report.weight, 1e-9);
+      EXPECT_EQ(plan.getVessels().size(), n);
+
+      const double expected = bruteForceBudget(FOV, sorted, weights, K);
+      EXPECT_LE(report.weight, expected + 1e-9) << "trial " << trial << " K " << K;
+      EXPECT_GE(report.upperBound, expected - 1e-9) << "trial " << trial << " K " << K;
+      if (report.exact) {
+        EXPECT_NEAR(report.weight, expected, 1e-9) << "trial " << trial << " K " << K;
+      }
+      if (K == minimal) {
+        EXPECT_EQ(plan.size(), minimal);
+      }
+    }
+  }
+  EXPECT_THROW(gimbaledCamera::makeBudgetedPictures(80., std::vector<gimbaledCamera::RelativeVessel>(1, 
+          gimbaledCamera::RelativeVessel(37.77, -122.33, "v", drone)), 1, 
+        [](const gimbaledCamera::RelativeVessel &) { return -1.; }), std::invalid_argument);
+}
+
+/* Test the pan/tilt pictures: every vessel is in one picture, which holds
+ * its box in both directions; with a VFOV holding all elevations, and a
+ * bearing gap wider than the HFOV, they are no more than makeMinimalPictures'
+ * (whose pictures must also be runs of consecutive bearings).
+ */
+TEST(Pictures, PanTiltPictures) {
+  gimbaledCamera::Vessel drone(testDataDrone.lat, testDataDrone.lon, testDataDrone.name);
+  const gimbaledCamera::RelativeVessel near(testDataDrone.lat + .001, testDataDrone.lon, "near", drone, 5);
+  EXPECT_NEAR(gimbaledCamera::elevation(near, 20), -atan((20 + pow(near.getDistance(), 2)/(2*6371000))/near.getDistance()), 1e-15);
+  EXPECT_NEAR(gimbaledCamera::elevation(near, 20)*180/M_PI, -10.2, .1);   // 111 m away, 20 m up
+
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<double> uniform(0., 1.);
+  for (int trial = 0; trial < 200; ++trial) {
+    const bool sector = trial%2 == 0;
+    const std::size_t n = 1 + gen()%200;
+    std::vector<gimbaledCamera::RelativeVessel> vessels;
+    for (std::size_t i = 0; i < n; ++i) {
+      const double bearing = sector ? 3*uniform(gen) : 2*M_PI*uniform(gen), dist = 150 + 5000*pow(uniform(gen), 2);
+      vessels.emplace_back(testDataDrone.lat + dist*sin(bearing)/111000, 
+          testDataDrone.lon + dist*cos(bearing)/(111000*cos(testDataDrone.lat*M_PI/180)), "t" + std::to_string(i), drone);
+    }
+    const double HFOV = 20 + 60*uniform(gen), VFOV = sector ? 180 : 5 + 20*uniform(gen), height = 30;
+    const gimbaledCamera::PanTiltPlan result = makePanTiltPictures(HFOV, VFOV, height, vessels);
+    ASSERT_EQ(result.tiltDeg.size(), result.plan.size());
+
+    std::set<std::string> seen;
+    for (std::size_t k = 0; k < result.plan.size(); ++k) {
+      const gimbaledCamera::VesselSpan &members = result.plan[k].getVessels();
+      double left = INFINITY, right = -INFINITY, low = INFINITY, high = -INFINITY;
+      for (auto & vessel : members) {
+        EXPECT_TRUE(seen.insert(vessel.getName()).second);
+        const double pan = members.front().getBearing() + remainder(vessel.getBearing() - members.front().getBearing(), 2*M_PI);
+        left  = std::min(left,  pan - vessel.getMargin());
+        right = std::max(right, pan + vessel.getMargin());
+        low   = std::min(low,   gimbaledCamera::elevation(vessel, height) - vessel.getMargin());
+        high  = std::max(high,  gimbaledCamera::elevation(vessel, height) + vessel.getMargin());
+      }
+      if (members.size() > 1) {
+        EXPECT_LT(right - left, HFOV*M_PI/180) << "trial " << trial;
+        EXPECT_LE(high - low, VFOV*M_PI/180 + 1e-12) << "trial " << trial;
+      }
+      EXPECT_NEAR(result.tiltDeg[k], (low + high)/2*180/M_PI, 1e-9);
+    }
+    EXPECT_EQ(seen.size(), n);
+    if (sector) {
+      EXPECT_LE(result.plan.size(), makeMinimalPictures(HFOV, vessels).size()) << "trial " << trial;
+    }
+  }
+
+  // a near and a far vessel on the same bearing need two tilts with a narrow VFOV
+  std::vector<gimbaledCamera::RelativeVessel> pair = {near, 
+    gimbaledCamera::RelativeVessel(testDataDrone.lat + .03, testDataDrone.lon, "far", drone, 5)};
+  EXPECT_EQ(makePanTiltPictures(80., 60., 20., pair).plan.size(), 1u);
+  EXPECT_EQ(makePanTiltPictures(80., 5., 20., pair).plan.size(), 2u);
+}
+
+/* The least time to take sorted vessels [i, n) with the camera at level
+ * current, trying every picture and level (quadratic reference for
+ * makeZoomPictures on vessels that do not wrap around).
+ */
+static double bruteForceZoom(const std::vector<gimbaledCamera::ZoomLevel> &levels, 
+    const std::vector<gimbaledCamera::RelativeVessel> &sorted, std::size_t i, std::size_t current, 
+    double picture, std::map<std::pair<std::size_t, std::size_t>, double> &memo) {
+  if (i == sorted.size())
+    return 0;
+  auto found = memo.find(std::make_pair(i, current));
+  if (found != memo.end())
+    return found->second;
+  double longest = 0, best = INFINITY;
+  for (auto & level : levels)
+    longest = std::max(longest, level.maxRange);
+  for (std::size_t l = 0; l < levels.size(); ++l) {
+    double left = INFINITY, right = -INFINITY;
+    for (std::size_t j = i; j < sorted.size(); ++j) {
+      left  = std::min(left,  sorted[j].getBearing() - sorted[j].getMargin());
+      right = std::max(right, sorted[j].getBearing() + sorted[j].getMargin());
+      if (std::min(sorted[j].getDistance(), longest) > levels[l].maxRange || (j > i && right - left >= levels[l].FOV*M_PI/180))
+        break;
+      best = std::min(best, (l == current ? 0 : levels[l].zoomTime) + picture 
+                            + bruteForceZoom(levels, sorted, j+1, l, picture, memo));
+    }
+  }
+  return memo[std::make_pair(i, current)] = best;
+}
+
+/* Test the multi-zoom pictures against the reference: every vessel is in
+ * one picture, which fits the FOV and range of its level, the time is the
+ * least possible and the trigger angles are framed with each level's FOV.
+ */
+TEST(Pictures, ZoomPictures) {
+  gimbaledCamera::Vessel drone(testDataDrone.lat, testDataDrone.lon, testDataDrone.name);
+  EXPECT_NEAR(gimbaledCamera::resolvedRange(60, 4000, 10, 40), 10/(M_PI/3/4000*40), 1e-9);
+  const std::vector<gimbaledCamera::ZoomLevel> levels = {
+    {60, .5, gimbaledCamera::resolvedRange(60, 4000, 10, 40)},
+    {20, .8, gimbaledCamera::resolvedRange(20, 4000, 10, 40)},
+    { 5, 1., gimbaledCamera::resolvedRange( 5, 4000, 10, 40)} };
+  const gimbaledCamera::SlewModel model;
+
+  std::mt19937 gen(11);
+  std::uniform_real_distribution<double> uniform(0., 1.);
+  for (int trial = 0; trial < 100; ++trial) {
+    const std::size_t n = 1 + gen()%40;
+    std::vector<gimbaledCamera::RelativeVessel> vessels;
+    for (std::size_t i = 0; i < n; ++i) {
+      const double bearing = 3*uniform(gen), dist = 150 + 14000*pow(uniform(gen), 2);
+      vessels.emplace_back(testDataDrone.lat + dist*sin(bearing)/111000, 
+          testDataDrone.lon + dist*cos(bearing)/(111000*cos(testDataDrone.lat*M_PI/180)), "z" + std::to_string(i), drone);
+    }
+    const std::size_t current = trial%3;
+    const gimbaledCamera::ZoomPlan result = makeZoomPictures(levels, vessels, current, model);
+    ASSERT_EQ(result.level.size(), result.plan.size());
+
+    std::vector<gimbaledCamera::RelativeVessel> sorted = vessels;
+    std::stable_sort(sorted.begin(), sorted.end(), gimbaledCamera::sortByBearing);
+    std::map<std::pair<std::size_t, std::size_t>, double> memo;
+    EXPECT_NEAR(result.totalTime, bruteForceZoom(levels, sorted, 0, current, model.settleTime + model.captureTime, memo), 1e-9) << "trial " << trial;
+
+    const gimbaledCamera::ZoomPlan copy = result;
+    std::size_t seen = 0, level = current;
+    double time = 0;
+    for (std::size_t k = 0; k < result.plan.size(); ++k) {
+      const gimbaledCamera::ZoomLevel &zoom = levels[result.level[k]];
+      const gimbaledCamera::VesselSpan &members = result.plan[k].getVessels();
+      for (auto & vessel : members)
+        EXPECT_TRUE(vessel.getDistance() <= zoom.maxRange || result.level[k] == 2) << "trial " << trial;
+      if (members.size() > 1) {
+        EXPECT_LT(members.back().getBearing() + members.back().getMargin() - members.front().getBearing() + members.front().getMargin(), 
+                  zoom.FOV*M_PI/180);
+      }
+      EXPECT_NEAR(result.plan[k].getCameraAngleDeg('C'), 
+                  fmod(result.plan[k].getCameraAngleDeg('N') - zoom.FOV/2 + 360, 360.), 1e-9);
+      EXPECT_DOUBLE_EQ(copy.plan[k].getCameraAngleDeg('C'), result.plan[k].getCameraAngleDeg('C'));
+      time += (result.level[k] == level ? 0 : zoom.zoomTime) + model.settleTime + model.captureTime;
+      level = result.level[k];
+      seen += members.size();
+    }
+    EXPECT_EQ(seen, n);
+    EXPECT_NEAR(time, result.totalTime, 1e-9);
+  }
+
+  EXPECT_THROW(makeZoomPictures({}, std::vector<gimbaledCamera::RelativeVessel>()), std::invalid_argument);
+}
+
+/* Test that IncrementalPlanner keeps the same pictures as makePictures
+ * through random insertions, moves and removals, and that a small move only
+ * repairs the pictures around it.
+ */
+TEST(Pictures, IncrementalPlanner) {
+  gimbaledCamera::Vessel drone(testDataDrone.lat, testDataDrone.lon, testDataDrone.name);
+  gimbaledCamera::IncrementalPlanner planner(30., drone);
+
+  std::mt19937 gen(3);
+  std::uniform_real_distribution<double> offset(-.05, .05);
+  std::map<std::string, std::pair<double, double> > fleet;
+
+  for (int step = 0; step < 600; ++step) {
+    const std::string name = "v" + std::to_string(gen()%150);
+    const int action = gen()%4;
+    if (action == 0) {
+      planner.remove(name);
+      fleet.erase(name);
+    } else {
+      const double lat = testDataDrone.lat + offset(gen), lon = testDataDrone.lon + offset(gen);
+      planner.move(name, lat, lon);
+      fleet[name] = std::make_pair(lat, lon);
+    }
+    ASSERT_EQ(planner.countVessels(), fleet.size());
+    if (fleet.empty())
+      continue;
+
+    std::list<gimbaledCamera::RelativeVessel> vessels;
+    for (auto & entry : fleet)
+      vessels.push_back(gimbaledCamera::RelativeVessel(entry.second.first, entry.second.second, entry.first, drone));
+
+    gimbaledCamera::Plan expected = makePictures(30., vessels);
+    gimbaledCamera::Plan actual   = planner.getPictures();
+    ASSERT_EQ(actual.size(), expected.size()) << "step " << step;
+    for (auto a = actual.begin(), e = expected.begin(); a != actual.end(); ++a, ++e) {
+      EXPECT_EQ(a->countVessels(), e->countVessels())                       << "step " << step;
+      EXPECT_DOUBLE_EQ(a->getCameraAngleDeg('C'), e->getCameraAngleDeg('C')) << "step " << step;
+    }
+  }
+
+  // a large fleet: nudging one vessel only touches the pictures around it
+  gimbaledCamera::IncrementalPlanner large(30., drone);
+  for (int i = 0; i < 3000; ++i)
+    large.insert("v" + std::to_string(i), testDataDrone.lat + offset(gen), testDataDrone.lon + offset(gen));
+  large.move("v0", testDataDrone.lat + .01, testDataDrone.lon + .01);
+  large.move("v0", testDataDrone.lat + .0101, testDataDrone.lon + .0101);
+  EXPECT_LT(large.getLastRepairCost(), 3000/4);
+}
+
+/* Test the batch geodesy engine against the reference values (same tolerances
+ * as RelativeVessel.BearingAndDistance) and against RelativeVessel itself, for
+ * every kernel available on this machine.
+ */
+TEST(Geodesy, BatchMatchesRelativeVessel) {
+  gimbaledCamera::Vessel drone(testDataDrone.lat, testDataDrone.lon, testDataDrone.name);
+
+  // the test vessels followed by a random fleet, from a few meters to a few thousand km away
+  std::vector<double> lat, lon;
+  for (auto & testVessel : testData) {
+    lat.push_back(testVessel.lat);
+    lon.push_back(testVessel.lon);
+  }
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> uniform(-1., 1.);
+  for (int i = 0; i < 1001; ++i) {
+    const double scale = std::pow(10., -4 + 5*(i%6)/5.);  // 1e-4 to 10 degrees
+    lat.push_back(testDataDrone.lat + scale*uniform(gen));
+    lon.push_back(testDataDrone.lon + scale*uniform(gen));
+  }
+  const std::size_t n = lat.size();
+
+  const gimbaledCamera::SimdLevel levels[] = {
+    gimbaledCamera::SimdLevel::Scalar, gimbaledCamera::SimdLevel::AVX2, gimbaledCamera::SimdLevel::AVX512 };
+
+  for (auto level : levels) {
+    if (!gimbaledCamera::isSimdLevelAvailable(level))
+      continue;
+
+    std::vector<double> bearing(n), dist(n), margin(n);
+    gimbaledCamera::computeRelativeBatch(drone, n, lat.data(), lon.data(), 
+        bearing.data(), dist.data(), margin.data(), 100, level);
+
+    for (std::size_t i = 0; i < testData.size(); ++i) {
+      EXPECT_NEAR(testData[i].bearing , bearing[i]*180/M_PI , .1);
+      EXPECT_NEAR(testData[i].dist    , dist[i]            , 10);
+    }
+
+    for (std::size_t i = 0; i < n; ++i) {
+      gimbaledCamera::RelativeVessel vessel(lat[i], lon[i], "", drone);
+      // at a few meters the bearing is ill-conditioned in both paths: compare the
+      // cross-track offset it implies instead (one micrometer)
+      EXPECT_NEAR(vessel.getBearing()  , bearing[i] , 1e-12 + 1e-6/dist[i]) << "vessel " << i;
+      EXPECT_NEAR(vessel.getDistance() , dist[i]    , 1e-6*std::max(1., dist[i]*1e-6)) << "vessel " << i;
+      if (std::isnan(vessel.getMargin())) { // closer than the margin
+        EXPECT_TRUE(std::isnan(margin[i])) << "vessel " << i;
+      } else {
+        EXPECT_NEAR(vessel.getMargin() , margin[i]  , 1e-12) << "vessel " << i;
+      }
+    }
+
+    // results must not depend on the position of a vessel within the batch
+    std::vector<double> bearing1(n-3), dist1(n-3), margin1(n-3);
+    gimbaledCamera::computeRelativeBatch(drone, n-3, lat.data()+3, lon.data()+3,
+        bearing1.data(), dist1.data(), margin1.data(), 100, level);
+    for (std::size_t i = 0; i < n-3; ++i) {
+      EXPECT_EQ(bearing[i+3] , bearing1[i]);
+      EXPECT_EQ(dist[i+3]    , dist1[i]);
+      EXPECT_EQ(std::isnan(margin[i+3]), std::isnan(margin1[i]));
+      if (!std::isnan(margin1[i])) {
+        EXPECT_EQ(margin[i+3] , margin1[i]);
+      }
+    }
+  }
+}
+
+/* Test the snapshot parser and the binary snapshot files, mapped or read */
+TEST(VesselIO, TextAndBinarySnapshots) {
+
+  // text, with the layout of test1.dat (spaces, tabs, a leading '+' and no final newline)
+  const std::string text = "Rhinheart 37.760132 -122.3264815\n"
+                           "Neo\t37.77308   -122.33451\n\n"
+                           "Morpheus +37.77728 -122.34192";
+  const gimbaledCamera::VesselSnapshot parsed = 
+    gimbaledCamera::parseSnapshot(text.data(), text.data() + text.size());
+  ASSERT_EQ(parsed.size(), 3u);
+  EXPECT_FALSE(parsed.isMapped());
+  EXPECT_EQ(parsed.getName(0), "Rhinheart");
+  EXPECT_EQ(parsed.getName(2), "Morpheus");
+  EXPECT_EQ(parsed.getLatDeg(1), 37.77308);
+  EXPECT_EQ(parsed.getLonDeg(0), -122.3264815);
+  EXPECT_EQ(parsed.getLatDeg(2), 37.77728);
+
+  // malformed input reports the line
+  const std::string bad = "Rhinheart 37.760132 -122.3264815\nNeo 37.7x -122.3\n";
+  try {
+    gimbaledCamera::parseSnapshot(bad.data(), bad.data() + bad.size());
+    FAIL() << "malformed input was accepted";
+  } catch (const std::runtime_error &e) {
+    EXPECT_NE(std::string(e.what()).find("line 2"), std::string::npos) << e.what();
+  }
+  const std::string truncated = "Neo 37.77308";
+  EXPECT_THROW(gimbaledCamera::parseSnapshot(truncated.data(), truncated.data() + truncated.size()), 
+      std::runtime_error);
+
+  // binary round trip, mapped without copying, then back to text
+  const std::string binaryPath = ::testing::TempDir() + "snapshot.bin";
+  const std::string textPath   = ::testing::TempDir() + "snapshot.dat";
+  gimbaledCamera::saveSnapshotBinary(parsed, binaryPath);
+  const gimbaledCamera::VesselSnapshot mapped = gimbaledCamera::loadSnapshot(binaryPath);
+  EXPECT_TRUE(mapped.isMapped());
+  gimbaledCamera::saveSnapshotText(mapped, textPath);
+  const gimbaledCamera::VesselSnapshot reparsed = gimbaledCamera::loadSnapshot(textPath);
+
+  for (const gimbaledCamera::VesselSnapshot *snapshot : {&mapped, &reparsed}) {
+    ASSERT_EQ(snapshot->size(), parsed.size());
+    for (std::size_t i = 0; i < parsed.size(); ++i) {
+      EXPECT_EQ(snapshot->getName(i)  , parsed.getName(i));
+      EXPECT_EQ(snapshot->getLatDeg(i), parsed.getLatDeg(i));
+      EXPECT_EQ(snapshot->getLonDeg(i), parsed.getLonDeg(i));
+    }
+  }
+
+  // name offsets out of order would make getName read out of the file
+  std::ifstream input(binaryPath, std::ios::binary);
+  std::vector<char> bytes((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+  std::size_t nameBytes = 0;
+  for (std::size_t i = 0; i < parsed.size(); ++i)
+    nameBytes += parsed.getName(i).size();
+  const std::uint32_t tooFar = 1000;
+  std::memcpy(bytes.data() + bytes.size() - nameBytes - 4*parsed.size(), &tooFar, sizeof(tooFar));   // nameOffset[1]
+  EXPECT_THROW(gimbaledCamera::loadSnapshot(std::move(bytes)), std::runtime_error);
+  std::remove(binaryPath.c_str());
+  std::remove(textPath.c_str());
+}
+
+// Writes the schedule to a file with the given buffer size, and returns the file content
+std::string writeScheduleToFile(const gimbaledCamera::Plan &plan, const gimbaledCamera::Schedule &schedule,
+    gimbaledCamera::OutputFormat format, std::size_t capacity) {
+  const std::string path = ::testing::TempDir() + "schedule.out";
+  const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  {
+    gimbaledCamera::BufferedWriter output(fd, capacity);
+    gimbaledCamera::writeSchedule(output, plan, schedule, format);
+  }
+  close(fd);
+  std::ifstream input(path, std::ios::binary);
+  const std::string content((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+  std::remove(path.c_str());
+  return content;
+}
+
+/* Test the CSV, JSON lines and binary schedule formats, over one and
+ * several frames.
+ */
+TEST(VesselIO, ScheduleWriter) {
+
+  gimbaledCamera::Vessel drone(testDataDrone.lat, testDataDrone.lon, testDataDrone.name);
+  std::vector<gimbaledCamera::RelativeVessel> vessels;
+  for (auto & tmp : testData)
+    vessels.emplace_back(tmp.lat, tmp.lon, tmp.name, drone);
+  vessels.emplace_back(37.77, -122.33, "Tank, \"the\" operator", drone);
+  const gimbaledCamera::Plan plan = makePictures(80., vessels);
+  const gimbaledCamera::Schedule schedule = gimbaledCamera::schedulePictures(plan, 0);
+  std::size_t vesselCount = 0;
+  for (auto & picture : plan)
+    vesselCount += picture.countVessels();
+
+  // the buffer size does not change the output
+  for (auto format : {gimbaledCamera::OutputFormat::CSV, gimbaledCamera::OutputFormat::JSONLines, 
+                      gimbaledCamera::OutputFormat::Binary})
+    EXPECT_EQ(writeScheduleToFile(plan, schedule, format, 7), writeScheduleToFile(plan, schedule, format, 1 << 16));
+
+  // CSV: a header and one line per vessel, names quoted when needed
+  const std::string csv = writeScheduleToFile(plan, schedule, gimbaledCamera::OutputFormat::CSV, 1 << 16);
+  EXPECT_EQ(std::size_t(std::count(csv.begin(), csv.end(), '\n')), 1 + vesselCount);
+  EXPECT_EQ(csv.compare(0, 46, "frame,capture,trigger_angle_deg,time_s,vessel\n"), 0);
+  EXPECT_EQ(csv.compare(46, 4, "0,0,"), 0);
+  EXPECT_NE(csv.find(",\"Tank, \"\"the\"\" operator\"\n"), std::string::npos) << csv;
+
+  // JSON lines: one object per picture, with exact numbers
+  const std::string jsonl = writeScheduleToFile(plan, schedule, gimbaledCamera::OutputFormat::JSONLines, 1 << 16);
+  EXPECT_EQ(std::size_t(std::count(jsonl.begin(), jsonl.end(), '\n')), schedule.captures.size());
+  EXPECT_EQ(jsonl.compare(0, 43, "{\"frame\":0,\"capture\":0,\"trigger_angle_deg\":"), 0);
+  EXPECT_EQ(std::stod(jsonl.substr(43)), schedule.captures[0].triggerAngleDeg);
+  EXPECT_NE(jsonl.find("\"Tank, \\\"the\\\" operator\""), std::string::npos) << jsonl;
+
+  // binary: read it back
+  const std::string binary = writeScheduleToFile(plan, schedule, gimbaledCamera::OutputFormat::Binary, 1 << 16);
+  ASSERT_EQ(binary.compare(0, 4, "GCSC"), 0);
+  const char *p = binary.data() + 4;
+  auto read = [&p](auto &value) { std::memcpy(&value, p, sizeof(value)); p += sizeof(value); };
+  std::uint32_t version, count, length;
+  std::uint64_t frame, captures;
+  double angle, time;
+  read(version);
+  read(frame);
+  read(captures);
+  EXPECT_EQ(version, 2u);
+  EXPECT_EQ(frame, 0u);
+  ASSERT_EQ(captures, schedule.captures.size());
+  for (auto & capture : schedule.captures) {
+    read(angle);
+    read(time);
+    read(count);
+    EXPECT_EQ(angle, capture.triggerAngleDeg);
+    EXPECT_EQ(time, capture.time);
+    ASSERT_EQ(count, plan[capture.picture].countVessels());
+    for (auto & vessel : plan[capture.picture].getVessels()) {
+      read(length);
+      EXPECT_EQ(std::string(p, length), vessel.getName());
+      p += length;
+    }
+  }
+  EXPECT_EQ(p, binary.data() + binary.size());
+  EXPECT_THROW(gimbaledCamera::outputFormat("xml"), std::invalid_argument);
+
+  // several frames: a single header, and records tagged with their frame
+  const std::string path = ::testing::TempDir() + "frames.out";
+  for (auto format : {gimbaledCamera::OutputFormat::CSV, gimbaledCamera::OutputFormat::JSONLines, 
+                      gimbaledCamera::OutputFormat::Binary}) {
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    {
+      gimbaledCamera::BufferedWriter output(fd);
+      gimbaledCamera::writeScheduleHeader(output, format);
+      gimbaledCamera::writeScheduleFrame(output, plan, schedule, format, 0);
+      gimbaledCamera::writeScheduleFrame(output, plan, schedule, format, 1);
+    }
+    close(fd);
+    std::ifstream input(path, std::ios::binary);
+    const std::string frames((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    const std::string single = writeScheduleToFile(plan, schedule, format, 1 << 16);
+    const std::size_t header = format == gimbaledCamera::OutputFormat::CSV ? 46 : 
+      format == gimbaledCamera::OutputFormat::Binary ? 8 : 0;
+    ASSERT_EQ(frames.size(), 2*single.size() - header);
+    EXPECT_EQ(frames.compare(0, single.size(), single), 0);
+    std::string second = frames.substr(single.size());
+    if (format == gimbaledCamera::OutputFormat::Binary)
+      EXPECT_EQ(second[0], 1);
+    else
+      EXPECT_EQ(second.find(format == gimbaledCamera::OutputFormat::CSV ? "1,0," : "{\"frame\":1,"), 0u) << second;
+  }
+  std::remove(path.c_str());
+}
+
+/* Test the track files (parsing, errors and round trip), the harbour
+ * generator, and the replay: static tracks never change pictures, and
+ * the frames cover the recording.
+ */
+TEST(Tracks, FileAndReplay) {
+  const std::string text = "# time name lat lon [course speed]\n"
+    "0 drone 37.760132 -122.3264815\n\n"
+    "0.5 Neo 37.77308 -122.33451 90 5\n"
+    "1 Trinity 37.75784 -122.31716\n";
+  const std::vector<gimbaledCamera::TrackPoint> parsed = gimbaledCamera::parseTracks(text.data(), text.data() + text.size());
+  ASSERT_EQ(parsed.size(), 3u);
+  EXPECT_EQ(gimbaledCamera::NameTable::global().lookup(parsed[1].name), "Neo");
+  EXPECT_TRUE(parsed[1].hasMotion);
+  EXPECT_EQ(parsed[1].course, 90);
+  EXPECT_FALSE(parsed[2].hasMotion);
+  const std::string older = "1 a 0 0\n0.5 b 0 0\n", shortLine = "1 a 0\n", badNumber = "1 a 0 x\n";
+  EXPECT_THROW(gimbaledCamera::parseTracks(older.data(), older.data() + older.size()), std::runtime_error);
+  EXPECT_THROW(gimbaledCamera::parseTracks(shortLine.data(), shortLine.data() + shortLine.size()), std::runtime_error);
+  EXPECT_THROW(gimbaledCamera::parseTracks(badNumber.data(), badNumber.data() + badNumber.size()), std::runtime_error);
+
+  gimbaledCamera::HarbourScenario scenario;
+  scenario.vessels  = 40;
+  scenario.duration = 60;
+  const std::vector<gimbaledCamera::TrackPoint> harbour = gimbaledCamera::makeHarbourTracks(scenario);
+  EXPECT_EQ(gimbaledCamera::NameTable::global().lookup(harbour.front().name), "drone");
+  std::set<std::uint32_t> names;
+  for (std::size_t i = 0; i < harbour.size(); ++i) {
+    names.insert(harbour[i].name);
+    EXPECT_TRUE(i == 0 || harbour[i-1].time <= harbour[i].time);
+    EXPECT_LT(std::abs(harbour[i].lat - scenario.lat), .1);
+    EXPECT_LT(std::abs(harbour[i].speed), 10);
+  }
+  EXPECT_EQ(names.size(), scenario.vessels + 1);
+
+  const std::string path = "unittest_tracks.trk";
+  gimbaledCamera::saveTracks(harbour, path);
+  const std::vector<gimbaledCamera::TrackPoint> loaded = gimbaledCamera::loadTracks(path);
+  std::remove(path.c_str());
+  ASSERT_EQ(loaded.size(), harbour.size());
+  for (std::size_t i = 0; i < harbour.size(); ++i) {
+    EXPECT_EQ(loaded[i].time,   harbour[i].time);
+    EXPECT_EQ(loaded[i].name,   harbour[i].name);
+    EXPECT_EQ(loaded[i].lat,    harbour[i].lat);
+    EXPECT_EQ(loaded[i].course, harbour[i].course);
+  }
+
+  gimbaledCamera::ReplayOptions options;
+  options.speedup = 0;
+  const gimbaledCamera::ReplayReport report = gimbaledCamera::replayTracks(harbour, options);
+  EXPECT_EQ(report.frames, std::size_t(std::floor((harbour.back().time - harbour.front().time)*options.frameRate + 1e-9)) + 1);
+  EXPECT_EQ(report.maxVessels, scenario.vessels);
+  EXPECT_GT(report.changedFrames, 0u);
+  EXPECT_LE(report.latencyP50, report.latencyP99);
+  EXPECT_LE(report.latencyP99, report.latencyMax);
+
+  // the test data, reported again and again without motion: the pictures never change
+  std::vector<gimbaledCamera::TrackPoint> still;
+  for (int t = 0; t < 5; ++t) {
+    still.push_back(parsed[0]);
+    still.back().time = t;
+    for (auto & testVessel : testData) {
+      gimbaledCamera::TrackPoint point;
+      point.time = t;
+      point.name = gimbaledCamera::NameTable::global().intern(testVessel.name);
+      point.lat  = testVessel.lat;
+      point.lon  = testVessel.lon;
+      still.push_back(point);
+    }
+  }
+  const gimbaledCamera::ReplayReport stillReport = gimbaledCamera::replayTracks(still, options);
+  EXPECT_EQ(stillReport.frames, 41u);
+  EXPECT_EQ(stillReport.maxVessels, testData.size());
+  EXPECT_EQ(stillReport.changedFrames, 0u);
+
+  // the report leaves the stream formatting as it was
+  std::ostringstream printed;
+  printed << std::scientific << std::setprecision(2) << stillReport;
+  EXPECT_NE(printed.str().find("Frames: ........................ 41 ("), std::string::npos) << printed.str();
+  EXPECT_EQ(printed.flags() & std::ios_base::floatfield, std::ios_base::scientific);
+  EXPECT_EQ(printed.precision(), 2);
+}
+
+/* Test that planning many observers at once gives the serial plan of each,
+ * on any number of threads, and the thread pool it runs on.
+ */
+TEST(PlanBatch, MatchesSerialPlans) {
+
+  // a shared contact set and a few observers with different cameras
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<double> offset(-.2, .2);
+  gimbaledCamera::VesselSnapshot snapshot;
+  for (int i = 0; i < 2000; ++i)
+    snapshot.push_back("V" + std::to_string(i), 37.76 + offset(gen), -122.33 + offset(gen));
+
+  std::vector<gimbaledCamera::Observer> observers;
+  for (int i = 0; i < 13; ++i) {
+    gimbaledCamera::Vessel drone(37.76 + offset(gen), -122.33 + offset(gen), "drone" + std::to_string(i));
+    observers.push_back({drone, 20. + 10*(i%7), 50. + 25*(i%3)});
+  }
+
+  for (std::size_t threads : {1, 2, 5}) {
+    const std::vector<gimbaledCamera::Plan> plans = gimbaledCamera::planBatch(observers, snapshot, threads);
+    ASSERT_EQ(plans.size(), observers.size());
+    for (std::size_t i = 0; i < observers.size(); ++i) {
+      const gimbaledCamera::Plan serial = gimbaledCamera::planObserver(observers[i], snapshot);
+      ASSERT_EQ(plans[i].size(), serial.size()) << "observer " << i;
+      for (std::size_t j = 0; j < serial.size(); ++j) {
+        EXPECT_EQ(plans[i][j].getCameraAngleDeg('C'), serial[j].getCameraAngleDeg('C'));
+        ASSERT_EQ(plans[i][j].countVessels(), serial[j].countVessels());
+        EXPECT_EQ(plans[i][j].getVessels().front().getName(), serial[j].getVessels().front().getName());
+      }
+    }
+  }
+
+  // the pool runs every index once, also with uneven tasks, and rethrows the first exception
+  gimbaledCamera::ThreadPool pool(4);
+  std::vector<int> hits(1000, 0);
+  pool.parallelFor(hits.size(), [&](std::size_t i) {
+      if (i < 10)
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      ++hits[i];
+      });
+  EXPECT_EQ(std::count(hits.begin(), hits.end(), 1), 1000);
+  EXPECT_THROW(pool.parallelFor(100, [](std::size_t i) { 
+        if (i == 42) 
+          throw std::runtime_error("task failed"); 
+        }), std::runtime_error);
+}
+
+/* Test that the parallel geometry and sort reproduce the serial plan on any
+ * number of threads.
+ */
+TEST(PlanBatch, ParallelPlanner) {
+
+  // enough vessels for several chunks, many sharing a bearing
+  std::mt19937 gen(15);
+  std::uniform_real_distribution<double> offset(-.2, .2);
+  gimbaledCamera::VesselSnapshot snapshot;
+  for (int i = 0; i < 60000; ++i) {
+    const double lat = 37.76 + offset(gen), lon = -122.33 + offset(gen);
+    for (int copy = 0; copy < 1 + (i%5 == 0); ++copy)
+      snapshot.push_back("V" + std::to_string(i) + "." + std::to_string(copy), lat, lon);
+  }
+  const gimbaledCamera::Vessel drone(37.76, -122.33, "drone");
+  std::vector<std::uint32_t> ids(snapshot.size());
+  std::iota(ids.begin(), ids.end(), 0u);
+
+  // the serial pipeline
+  std::vector<double> bearing(ids.size()), dist(ids.size()), margin(ids.size());
+  gimbaledCamera::computeRelativeBatch(drone, ids.size(), snapshot.getLats(), snapshot.getLons(),
+      bearing.data(), dist.data(), margin.data());
+  std::vector<gimbaledCamera::RelativeVessel> serial;
+  for (std::size_t i = 0; i < ids.size(); ++i)
+    if (dist[i] <= 20000)
+      serial.emplace_back(snapshot.getLatDeg(i), snapshot.getLonDeg(i), std::string(snapshot.getName(i)), 
+          bearing[i], dist[i], margin[i]);
+  ASSERT_GT(serial.size(), 50000);   // several chunks for each thread
+  std::vector<gimbaledCamera::RelativeVessel> sorted = serial;
+  std::stable_sort(sorted.begin(), sorted.end(), gimbaledCamera::sortByBearing);
+  const gimbaledCamera::Plan reference = makePictures(30., serial);
+
+  // is reproduced exactly on any number of threads
+  for (std::size_t threads : {1, 2, 3, 8}) {
+    gimbaledCamera::ThreadPool pool(threads);
+    std::vector<gimbaledCamera::RelativeVessel> vessels = makeRelativeVessels(drone, snapshot, ids, pool, 100, 20000);
+    ASSERT_EQ(vessels.size(), serial.size());
+    for (std::size_t i = 0; i < vessels.size(); ++i) {
+      EXPECT_EQ(vessels[i].getName(), serial[i].getName());
+      EXPECT_EQ(vessels[i].getBearing(), serial[i].getBearing());
+      EXPECT_EQ(vessels[i].getMargin(), serial[i].getMargin());
+    }
+
+    std::vector<gimbaledCamera::RelativeVessel> copy = vessels;
+    gimbaledCamera::parallelSortByBearing(copy, pool);
+    for (std::size_t i = 0; i < copy.size(); ++i)
+      ASSERT_EQ(copy[i].getName(), sorted[i].getName()) << threads << " threads, vessel " << i;
+
+    const gimbaledCamera::Plan plan = makePictures(30., std::move(vessels), pool);
+    ASSERT_EQ(plan.size(), reference.size());
+    for (std::size_t j = 0; j < plan.size(); ++j) {
+      EXPECT_EQ(plan[j].getCameraAngleDeg('C'), reference[j].getCameraAngleDeg('C'));
+      ASSERT_EQ(plan[j].countVessels(), reference[j].countVessels());
+      EXPECT_EQ(plan[j].getVessels().front().getName(), reference[j].getVessels().front().getName());
+    }
+  }
+}
+
+// Plans the frames of a file with streamPlans
+std::vector<gimbaledCamera::FramePlan> streamFile(const std::string &path, gimbaledCamera::ThreadPool &pool,
+    const gimbaledCamera::StreamOptions &options) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  std::vector<gimbaledCamera::FramePlan> frames;
+  try {
+    gimbaledCamera::streamPlans(fd, pool, [&](gimbaledCamera::FramePlan &frame) { 
+        frames.push_back(std::move(frame)); }, options);
+  } catch (...) {
+    close(fd);
+    throw;
+  }
+  close(fd);
+  return frames;
+}
+
+/* Test the frame pipeline: each frame is planned as main planned a single
+ * snapshot, and errors and failures stop it.
+ */
+TEST(StreamPlanner, MatchesBatchPlans) {
+
+  // a closed queue is drained, then refuses items
+  gimbaledCamera::BoundedQueue<int> queue(2);
+  EXPECT_TRUE(queue.push(1));
+  queue.close();
+  EXPECT_FALSE(queue.push(2));
+  int item = 0;
+  EXPECT_TRUE(queue.pop(item));
+  EXPECT_EQ(item, 1);
+  EXPECT_FALSE(queue.pop(item));
+
+  // three frames (the second of several chunks), an empty one, and no final newline
+  std::mt19937 gen(25);
+  std::uniform_real_distribution<double> offset(-.05, .05);
+  std::vector<std::string> texts(3);
+  texts[0] = testDataDrone.name + " " + std::to_string(testDataDrone.lat) + " " + std::to_string(testDataDrone.lon) + "\n";
+  for (auto & testVessel : testData)
+    texts[0] += testVessel.name + "\t" + std::to_string(testVessel.lat) + " " + std::to_string(testVessel.lon) + "\n";
+  for (int i = 0; i < 2000; ++i)
+    texts[1] += "s" + std::to_string(i) + " " + std::to_string(37.76 + offset(gen)) + " " 
+      + std::to_string(-122.33 + offset(gen)) + "\n";
+  texts[2] = "last 37.76 -122.33\n\nNeo 37.77308 -122.33451";
+  const std::string path = ::testing::TempDir() + "frames.dat";
+  {
+    std::ofstream output(path, std::ios::binary);
+    output << texts[0] << "---\n" << texts[1] << "---  \n\n---\n" << texts[2];
+  }
+
+  gimbaledCamera::ThreadPool pool(2);
+  gimbaledCamera::StreamOptions options;
+  options.chunkBytes = 1000;
+  options.maxRange = 4000;
+  options.keepVessels = true;
+  options.gimbalAngleDeg = 90;
+  const std::vector<gimbaledCamera::FramePlan> frames = streamFile(path, pool, options);
+
+  // each frame is planned as main planned a single snapshot
+  ASSERT_EQ(frames.size(), texts.size());
+  for (std::size_t f = 0; f < texts.size(); ++f) {
+    const gimbaledCamera::VesselSnapshot snapshot = 
+      gimbaledCamera::parseSnapshot(texts[f].data(), texts[f].data() + texts[f].size());
+    const gimbaledCamera::Vessel drone(snapshot.getLatDeg(0), snapshot.getLonDeg(0), std::string(snapshot.getName(0)));
+    std::vector<std::uint32_t> ids(snapshot.size() - 1);
+    std::iota(ids.begin(), ids.end(), 1u);
+    const std::vector<gimbaledCamera::RelativeVessel> vessels = 
+      makeRelativeVessels(drone, snapshot, ids, pool, options.margin, options.maxRange);
+    const gimbaledCamera::Plan plan = makePictures(options.FOV, vessels, pool);
+    const gimbaledCamera::Schedule schedule = schedulePictures(plan, options.gimbalAngleDeg, gimbaledCamera::SlewModel());
+
+    EXPECT_EQ(frames[f].frame, f);
+    EXPECT_EQ(frames[f].drone.getName(), drone.getName());
+    ASSERT_EQ(frames[f].vessels.size(), vessels.size());
+    for (std::size_t i = 0; i < vessels.size(); ++i) {
+      EXPECT_EQ(frames[f].vessels[i].getName(), vessels[i].getName());
+      EXPECT_EQ(frames[f].vessels[i].getBearing(), vessels[i].getBearing());
+    }
+    ASSERT_EQ(frames[f].plan.size(), plan.size());
+    for (std::size_t j = 0; j < plan.size(); ++j) {
+      EXPECT_EQ(frames[f].plan[j].getCameraAngleDeg('C'), plan[j].getCameraAngleDeg('C'));
+      EXPECT_EQ(frames[f].plan[j].countVessels(), plan[j].countVessels());
+    }
+    ASSERT_EQ(frames[f].schedule.captures.size(), schedule.captures.size());
+    for (std::size_t j = 0; j < schedule.captures.size(); ++j)
+      EXPECT_EQ(frames[f].schedule.captures[j].triggerAngleDeg, schedule.captures[j].triggerAngleDeg);
+  }
+  EXPECT_GT(frames[1].plan.size(), 1u);
+
+  // malformed input reports the line in the whole input
+  {
+    std::ofstream output(path, std::ios::binary);
+    output << texts[0] << "---\n" << texts[1] << "s 37.7x -122.3\n";
+  }
+  try {
+    streamFile(path, pool, options);
+    FAIL() << "malformed input was accepted";
+  } catch (const std::runtime_error &e) {
+    const std::size_t line = std::count(texts[0].begin(), texts[0].end(), '\n') + 2 + 2000;
+    EXPECT_NE(std::string(e.what()).find("line " + std::to_string(line) + ":"), std::string::npos) << e.what();
+  }
+
+  // a binary snapshot is a single frame
+  gimbaledCamera::saveSnapshotBinary(gimbaledCamera::parseSnapshot(texts[1].data(), texts[1].data() + texts[1].size()), path);
+  const std::vector<gimbaledCamera::FramePlan> binary = streamFile(path, pool, options);
+  ASSERT_EQ(binary.size(), 1u);
+  EXPECT_EQ(binary[0].drone.getName(), "s0");
+  ASSERT_EQ(binary[0].plan.size(), frames[1].plan.size());
+  EXPECT_EQ(binary[0].vessels.size(), frames[1].vessels.size());
+  std::remove(path.c_str());
+
+  // a failure stops the pipeline even while the input stays open with no more data
+  int input[2];
+  ASSERT_EQ(pipe(input), 0);
+  const std::string first = texts[0] + "---\n";
+  ASSERT_EQ(write(input[1], first.data(), first.size()), ssize_t(first.size()));
+  std::size_t emitted = 0;
+  EXPECT_THROW(gimbaledCamera::streamPlans(input[0], pool, [&](gimbaledCamera::FramePlan &) { 
+        ++emitted;
+        throw std::runtime_error("write failed"); 
+      }, options), std::runtime_error);
+  EXPECT_EQ(emitted, 1u);
+  close(input[0]);
+  close(input[1]);
+}
+
+/* Test the grid index: every contact within range is found, as the feed
+ * moves, grows and shrinks.
+ */
+TEST(SpatialIndex, RangeQueries) {
+
+  // a world-wide feed, denser around the observers
+  std::mt19937 gen(14);
+  std::uniform_real_distribution<double> uniform(0., 1.), offset(-.3, .3);
+  const double sites[][2] = {{37.76, -122.33}, {0.01, 179.98}, {-33.9, 18.4}, {89.95, 10.}, {-70., -179.9}};
+  std::vector<double> lat, lon;
+  for (int i = 0; i < 20000; ++i) {
+    lat.push_back(asin(2*uniform(gen) - 1)*180/M_PI);
+    lon.push_back(360*uniform(gen) - 180);
+  }
+  for (auto & site : sites)
+    for (int i = 0; i < 400; ++i) {
+      lat.push_back(std::max(-90., std::min(90., site[0] + offset(gen))));
+      lon.push_back(remainder(site[1] + offset(gen), 360.));
+    }
+
+  // every contact within range is found, for every observer, before and after the contacts move
+  gimbaledCamera::SpatialIndex index;
+  index.build(lat.size(), lat.data(), lon.data());
+  std::vector<std::uint32_t> ids;
+  for (int frame = 0; frame < 2; ++frame) {
+    for (auto & site : sites)
+      for (double range : {5e3, 3e4, 5e5}) {
+        gimbaledCamera::Vessel observer(site[0], site[1], "observer");
+        std::vector<double> bearing(lat.size()), dist(lat.size()), margin(lat.size());
+        gimbaledCamera::computeRelativeBatch(observer, lat.size(), lat.data(), lon.data(),
+            bearing.data(), dist.data(), margin.data());
+        index.query(observer, range, ids);
+        EXPECT_TRUE(std::is_sorted(ids.begin(), ids.end()));
+        std::size_t within = 0;
+        for (std::size_t i = 0; i < lat.size(); ++i)
+          if (dist[i] <= range) {
+            ++within;
+            EXPECT_TRUE(std::binary_search(ids.begin(), ids.end(), i)) << "contact " << i << " of " << site[0] << ", " << site[1];
+          }
+        EXPECT_GT(within, 0);
+        EXPECT_LT(ids.size(), lat.size()/4);
+      }
+
+    // the next frame: a third of the contacts move, about a kilometer, and a few new ones appear
+    for (std::size_t i = 0; i < lat.size(); i += 3) {
+      lat[i] = std::max(-90., std::min(90., lat[i] + offset(gen)/30));
+      lon[i] = remainder(lon[i] + offset(gen)/30, 360.);
+    }
+    lat.push_back(37.76);
+    lon.push_back(-122.33);
+    const std::size_t changed = index.update(lat.size(), lat.data(), lon.data());
+    EXPECT_GE(changed, 1);
+    EXPECT_LT(changed, lat.size()/3);
+  }
+
+  // contacts removed from the feed leave the index
+  index.update(100, lat.data(), lon.data());
+  EXPECT_EQ(index.size(), 100);
+  index.query(gimbaledCamera::Vessel(0, 0, "observer"), 2e7, ids);
+  EXPECT_EQ(ids.size(), 100);
+
+  // planning through the index is planning the contacts within range
+  gimbaledCamera::VesselSnapshot snapshot, inRange;
+  for (std::size_t i = 0; i < lat.size(); ++i)
+    snapshot.push_back("V" + std::to_string(i), lat[i], lon[i]);
+  index.build(snapshot);
+  const gimbaledCamera::Observer observer = {gimbaledCamera::Vessel(37.8, -122.3, "drone"), 60., 100.};
+  for (std::size_t i = 0; i < snapshot.size(); ++i)
+    if (gimbaledCamera::RelativeVessel(lat[i], lon[i], "", observer.drone).getDistance() <= 20000)
+      inRange.push_back(snapshot.getName(i), lat[i], lon[i]);
+  const gimbaledCamera::Plan plan = gimbaledCamera::planObserver(observer, snapshot, index, 20000),
+                             reference = gimbaledCamera::planObserver(observer, inRange);
+  ASSERT_EQ(plan.size(), reference.size());
+  for (std::size_t j = 0; j < plan.size(); ++j) {
+    EXPECT_EQ(plan[j].getCameraAngleDeg('C'), reference[j].getCameraAngleDeg('C'));
+    ASSERT_EQ(plan[j].countVessels(), reference[j].countVessels());
+    EXPECT_EQ(plan[j].getVessels().front().getName(), reference[j].getVessels().front().getName());
+  }
+}
+
+/* Test the slew scheduler against every order of the pictures: exact with
+ * a linear slew time, within its documented bound with acceleration.
+ */
+TEST(Schedule, SlewScheduler) {
+
+  // one picture per vessel: a narrow FOV, vessels spread around the drone
+  gimbaledCamera::Vessel drone(testDataDrone.lat, testDataDrone.lon, testDataDrone.name);
+  std::vector<gimbaledCamera::RelativeVessel> vessels;
+  const double bearings[] = {10, 75, 130, 200, 260, 300, 350};
+  for (double bearing : bearings)
+    vessels.emplace_back(0, 0, "V" + std::to_string(int(bearing)), bearing*M_PI/180, 2000, asin(100/2000.));
+  const gimbaledCamera::Plan plan = makePictures(5., vessels);
+  ASSERT_EQ(plan.size(), 7u);
+
+  // time of the pictures in the given order, each move in the shortest direction
+  auto timeOf = [&](const std::vector<std::size_t> &order, double gimbal, const gimbaledCamera::SlewModel &model) {
+    double time = 0, here = gimbal;
+    for (std::size_t k : order) {
+      const double angle = plan[k].getCameraAngleDeg('C');
+      time += model.slewTime(std::remainder(angle - here, 360.)) + model.captureTime;
+      here = angle;
+    }
+    return time;
+  };
+
+  // with a linear slew time the schedule is optimal: compare with every order
+  gimbaledCamera::SlewModel linear;
+  linear.acceleration = INFINITY;
+  std::vector<std::size_t> order = {0, 1, 2, 3, 4, 5, 6};
+  for (double gimbal : {0., 97., 181., 333.}) {
+    double best = INFINITY;
+    do {
+      best = std::min(best, timeOf(order, gimbal, linear));
+    } while (std::next_permutation(order.begin(), order.end()));
+
+    const gimbaledCamera::Schedule schedule = gimbaledCamera::schedulePictures(plan, gimbal, linear);
+    ASSERT_EQ(schedule.captures.size(), plan.size());
+    EXPECT_NEAR(schedule.totalTime, best, 1e-9) << "gimbal at " << gimbal;
+    EXPECT_DOUBLE_EQ(schedule.captures.back().time, schedule.totalTime);
+
+    std::vector<std::size_t> captured;
+    for (auto & capture : schedule.captures)
+      captured.push_back(capture.picture);
+    EXPECT_NEAR(timeOf(captured, gimbal, linear), schedule.totalTime, 1e-9);
+    std::sort(captured.begin(), captured.end());
+    EXPECT_EQ(captured, order);   // every picture exactly once
+  }
+
+  // with acceleration the arc orders are a heuristic: never faster than the
+  // best order, and at most maxRate/acceleration per picture slower
+  const gimbaledCamera::SlewModel model;
+  gimbaledCamera::SlewModel sluggish;
+  sluggish.acceleration = 5;
+  for (const gimbaledCamera::SlewModel &accelerating : {model, sluggish})
+    for (double gimbal : {0., 42., 181., 333.}) {
+      double best = INFINITY;
+      do {
+        best = std::min(best, timeOf(order, gimbal, accelerating));
+      } while (std::next_permutation(order.begin(), order.end()));
+
+      const double time = gimbaledCamera::schedulePictures(plan, gimbal, accelerating).totalTime;
+      EXPECT_GE(time, best - 1e-9) << "gimbal at " << gimbal;
+      EXPECT_LE(time, best + plan.size()*accelerating.maxRate/accelerating.acceleration + 1e-9) << "gimbal at " << gimbal;
+    }
+  EXPECT_LE(gimbaledCamera::schedulePictures(plan, 42, model).totalTime, timeOf(order, 42, model) + 1e-12);
+  EXPECT_DOUBLE_EQ(model.slewTime(0), 0);
+  EXPECT_DOUBLE_EQ(model.slewTime(-15), 2*sqrt(15/model.acceleration) + model.settleTime); // triangular
+  EXPECT_DOUBLE_EQ(model.slewTime(90), 90/model.maxRate + model.maxRate/model.acceleration + model.settleTime);
+}
+
+/* Test the propagation of moving vessels, and the plans of the vessels at
+ * the trigger time of their picture.
+ */
+TEST(Motion, PlanWithMotion) {
+
+  // propagation: 10 m/s North for 100 s is 1 km North; the drone's own motion is subtracted
+  const double lat0 = 37.76, lon0 = -122.33, course0 = 0, speed0 = 10, dt = 100;
+  double lat1, lon1;
+  gimbaledCamera::RelativeMotion still(gimbaledCamera::Vessel(lat0, lon0, "drone"), 1, &lat0, &course0, &speed0);
+  still.propagate(&lat0, &lon0, &dt, &lat1, &lon1);
+  EXPECT_NEAR((lat1 - lat0)*M_PI/180*6371000, 1000, 1e-6);
+  EXPECT_EQ(lon1, lon0);
+  gimbaledCamera::RelativeMotion together(gimbaledCamera::Vessel(lat0, lon0, "drone", 0, 10), 1, &lat0, &course0, &speed0);
+  together.propagate(&lat0, &lon0, &dt, &lat1, &lon1);
+  EXPECT_EQ(lat1, lat0);
+
+  // the test1.dat vessels
+  gimbaledCamera::Vessel drone(testDataDrone.lat, testDataDrone.lon, testDataDrone.name, 45, 8);
+  gimbaledCamera::VesselSnapshot snapshot;
+  for (auto & tmp : testData)
+    snapshot.push_back(tmp.name, tmp.lat, tmp.lon);
+  const std::size_t n = snapshot.size();
+  const std::vector<double> zero(n, 0.);
+
+  // no motion at all: the plan of makePictures, found again by the second plan
+  const gimbaledCamera::MotionPlan staticPlan = gimbaledCamera::planWithMotion(80, 
+      gimbaledCamera::Vessel(testDataDrone.lat, testDataDrone.lon, testDataDrone.name), 
+      snapshot, zero.data(), zero.data(), 0);
+  const gimbaledCamera::Plan reference = gimbaledCamera::planObserver(
+      {gimbaledCamera::Vessel(testDataDrone.lat, testDataDrone.lon, testDataDrone.name), 80, 100}, snapshot);
+  EXPECT_TRUE(staticPlan.converged);
+  EXPECT_EQ(staticPlan.iterations, 2);
+  ASSERT_EQ(staticPlan.plan.size(), reference.size());
+  for (std::size_t j = 0; j < reference.size(); ++j)
+    EXPECT_EQ(staticPlan.plan[j].getCameraAngleDeg(), reference[j].getCameraAngleDeg());
+
+  // fast vessels: every vessel is planned at its position at the trigger time of its picture
+  const std::vector<double> course = {0, 90, 180, 270, 45, 300};
+  const std::vector<double> speed  = {15, 20, 25, 10, 30, 12};
+  const gimbaledCamera::SlewModel slow = {10, 20, .5, .1};
+  const gimbaledCamera::MotionPlan moving = 
+    gimbaledCamera::planWithMotion(80, drone, snapshot, course.data(), speed.data(), 0, slow);
+  EXPECT_TRUE(moving.converged);
+
+  const gimbaledCamera::RelativeMotion motion(drone, n, snapshot.getLats(), course.data(), speed.data());
+  std::vector<double> lat(n), lon(n);
+  motion.propagate(snapshot.getLats(), snapshot.getLons(), moving.captureTime.data(), lat.data(), lon.data());
+  std::size_t planned = 0;
+  for (auto & capture : moving.schedule.captures)
+    for (auto & vessel : moving.plan[capture.picture].getVessels()) {
+      const std::size_t i = vessel.getRow();
+      EXPECT_EQ(vessel.getName(), snapshot.getName(i));
+      EXPECT_DOUBLE_EQ(moving.captureTime[i], capture.time - slow.captureTime);
+      EXPECT_NEAR(vessel.getLatDeg(), lat[i], 1e-3*30/111000);   // within the 1 ms tolerance at 30 m/s
+      EXPECT_NEAR(vessel.getLonDeg(), lon[i], 1e-3*30/88000);
+      EXPECT_EQ(vessel.getSpeed(), speed[i]);
+      ++planned;
+    }
+  EXPECT_EQ(planned, n);
+
+  // names do not matter, even when they repeat (as unnamed AIS contacts do)
+  gimbaledCamera::VesselSnapshot unnamed;
+  for (auto & tmp : testData)
+    unnamed.push_back("", tmp.lat, tmp.lon);
+  const gimbaledCamera::MotionPlan anonymous = 
+    gimbaledCamera::planWithMotion(80, drone, unnamed, course.data(), speed.data(), 0, slow);
+  EXPECT_TRUE(anonymous.converged);
+  EXPECT_EQ(anonymous.captureTime, moving.captureTime);
+}
+
+/* Test the contact queue: several producers with backpressure lose no
+ * update and keep their own order; DropOldest keeps the latest updates; the
+ * table plans each vessel once, at its latest position.
+ */
+TEST(ContactQueue, IngestAndCoalesce) {
+  const int producers = 4, vesselsPerProducer = 50, updatesPerVessel = 400;
+  gimbaledCamera::ContactQueue queue(64);
+  std::vector<std::uint32_t> ids;
+  for (int k = 0; k < producers*vesselsPerProducer; ++k)
+    ids.push_back(gimbaledCamera::NameTable::global().intern("contact" + std::to_string(k)));
+
+  // each producer owns its vessels, and moves them north one step at a time
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p)
+    threads.emplace_back([&, p]() {
+      for (int step = 1; step <= updatesPerVessel; ++step)
+        for (int v = 0; v < vesselsPerProducer; ++v)
+          queue.push(ids[p*vesselsPerProducer + v], testDataDrone.lat + 1e-5*step, testDataDrone.lon + 1e-4*v);
+    });
+
+  std::map<std::uint32_t, double> last;
+  std::vector<gimbaledCamera::ContactUpdate> batch;
+  std::size_t drained = 0, outOfOrder = 0;
+  const std::size_t total = producers*vesselsPerProducer*updatesPerVessel;
+  while (drained < total) {
+    batch.clear();
+    drained += queue.drain(batch, 100);
+    for (auto & update : batch) {
+      outOfOrder += update.lat <= last[update.name];
+      last[update.name] = update.lat;
+    }
+  }
+  for (auto & thread : threads)
+    thread.join();
+  EXPECT_EQ(outOfOrder, 0u);
+  EXPECT_EQ(queue.depth(), 0u);
+  gimbaledCamera::ContactQueue::Metrics metrics = queue.getMetrics();
+  EXPECT_EQ(metrics.pushed, total);
+  EXPECT_EQ(metrics.dropped, 0u);
+  EXPECT_LE(metrics.maxDepth, queue.capacity());
+
+  // DropOldest: a full queue keeps the latest updates, and tryPush fails
+  gimbaledCamera::ContactQueue small(8, gimbaledCamera::OverflowPolicy::DropOldest);
+  for (int step = 0; step < 20; ++step)
+    small.push(ids[0], step, 0);
+  EXPECT_FALSE(small.tryPush(ids[0], 20, 0));
+  metrics = small.getMetrics();
+  EXPECT_EQ(metrics.dropped, 12u);
+  EXPECT_EQ(metrics.rejected, 1u);
+  batch.clear();
+  ASSERT_EQ(small.drain(batch), 8u);
+  for (int k = 0; k < 8; ++k)
+    EXPECT_EQ(batch[k].lat, 12 + k);
+
+  // the table keeps the latest position of each vessel, and plans it once
+  gimbaledCamera::ContactTable table;
+  gimbaledCamera::Vessel drone(testDataDrone.lat, testDataDrone.lon, testDataDrone.name);
+  queue.push(drone.getName(), drone.getLatDeg(), drone.getLonDeg());
+  for (int step = 0; step < 3; ++step)
+    for (auto & tmp : testData)
+      queue.push(tmp.name, tmp.lat + 1e-3*(step - 2), tmp.lon);
+  EXPECT_EQ(table.ingest(queue, 5), 5u);
+  EXPECT_EQ(table.ingest(queue), 1 + 3*testData.size() - 5);
+  EXPECT_EQ(table.size(), 1 + testData.size());
+  EXPECT_EQ(table.countPending(), 1 + testData.size());
+  EXPECT_EQ(table.getMetrics().coalesced, 2*testData.size());
+
+  std::vector<gimbaledCamera::RelativeVessel> vessels;
+  for (auto & tmp : testData)
+    vessels.emplace_back(tmp.lat, tmp.lon, tmp.name, drone);
+  const gimbaledCamera::Plan expected = makePictures(80., vessels);
+  const gimbaledCamera::Plan plan = makePictures(80., table.relativeVessels(drone));
+  table.planned();
+  ASSERT_EQ(plan.size(), expected.size());
+  for (std::size_t k = 0; k < plan.size(); ++k) {
+    EXPECT_EQ(plan[k].countVessels(), expected[k].countVessels());
+    EXPECT_NEAR(plan[k].getCameraAngleDeg('C'), expected[k].getCameraAngleDeg('C'), 1e-9);
+  }
+  EXPECT_EQ(table.countPending(), 0u);
+  EXPECT_EQ(table.getMetrics().planned, 1 + testData.size());
+  EXPECT_GT(table.getMetrics().latencyMax, 0u);
+  EXPECT_GE(table.getMetrics().latencySum, table.getMetrics().latencyMax);
+}
+
+/* Test that a reader never sees a plan being published: each plan has as
+ * many captures as its sequence number (modulo 64), all at that angle.
+ */
+TEST(PlanDaemon, PlanBuffer) {
+  gimbaledCamera::PlanBuffer plans;
+  EXPECT_EQ(plans.read()->sequence, 0u);
+
+  std::atomic<bool> done(false);
+  std::atomic<int> torn(0);
+  std::thread reader([&]() {
+    std::uint64_t last = 0;
+    while (!done.load()) {
+      const gimbaledCamera::PlanBuffer::Reader plan = plans.read();
+      bool ok = plan->sequence >= last && plan->triggerAngleDeg.size() == plan->sequence%64 
+        && plan->time.size() == plan->sequence%64 && plan->vessels == plan->sequence;
+      for (double angle : plan->triggerAngleDeg)
+        ok = ok && angle == double(plan->sequence);
+      torn += !ok;
+      last = plan->sequence;
+    }
+  });
+
+  gimbaledCamera::Schedule schedule;
+  for (std::uint64_t sequence = 1; sequence <= 20000; ++sequence) {
+    schedule.captures.assign(sequence%64, gimbaledCamera::ScheduledCapture{0, double(sequence), 0, 0, 0});
+    plans.publish(schedule, sequence);
+  }
+  done.store(true);
+  reader.join();
+  EXPECT_EQ(torn.load(), 0);
+  EXPECT_EQ(plans.read()->sequence, 20000u);
+}
+
+// Waits up to 5 s for the daemon to publish a plan of the given number of vessels
+bool waitForPlan(const gimbaledCamera::PlanDaemon &daemon, std::size_t vessels) {
+  for (int k = 0; k < 500; ++k) {
+    {
+      const gimbaledCamera::PlanBuffer::Reader plan = daemon.getPlans().read();
+      if (plan->sequence > 0 && plan->vessels == vessels)
+        return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return false;
+}
+
+/* Test the daemon end to end: updates sent on its socket, by several
+ * clients, give the schedule main would compute.
+ */
+TEST(PlanDaemon, ServesUpdates) {
+  const std::string path = ::testing::TempDir() + "planDaemon.sock";
+  gimbaledCamera::PlanDaemon daemon(path, 100);
+  std::thread server([&]() { daemon.run(); });
+
+  gimbaledCamera::VesselSnapshot snapshot;
+  snapshot.push_back(testDataDrone.name, testDataDrone.lat, testDataDrone.lon);
+  for (auto & tmp : testData)
+    snapshot.push_back(tmp.name, tmp.lat, tmp.lon);
+  int fd = gimbaledCamera::connectDaemon(path);
+  gimbaledCamera::sendUpdates(fd, snapshot);
+  close(fd);
+  ASSERT_TRUE(waitForPlan(daemon, testData.size()));
+
+  gimbaledCamera::Vessel drone(testDataDrone.lat, testDataDrone.lon, testDataDrone.name);
+  std::vector<gimbaledCamera::RelativeVessel> vessels;
+  for (auto & tmp : testData)
+    vessels.emplace_back(tmp.lat, tmp.lon, tmp.name, drone);
+  gimbaledCamera::Schedule expected = gimbaledCamera::schedulePictures(makePictures(80., vessels), 0);
+  {
+    const gimbaledCamera::PlanBuffer::Reader plan = daemon.getPlans().read();
+    ASSERT_EQ(plan->triggerAngleDeg.size(), expected.captures.size());
+    for (std::size_t k = 0; k < expected.captures.size(); ++k)
+      EXPECT_NEAR(plan->triggerAngleDeg[k], expected.captures[k].triggerAngleDeg, 1e-9);
+  }
+
+  // a second client removes a vessel, with a malformed line, an overlong
+  // one (most likely read in two parts) and no final line break
+  fd = gimbaledCamera::connectDaemon(path);
+  const std::string overlong = "Smith 37.7 north\n" + std::string(gimbaledCamera::PlanDaemon::maxLineLength + 1, 'x');
+  const std::string updates = " 37.7 -122.3\n" + testData[0].name;
+  ASSERT_EQ(write(fd, overlong.data(), overlong.size()), ssize_t(overlong.size()));
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  ASSERT_EQ(write(fd, updates.data(), updates.size()), ssize_t(updates.size()));
+  close(fd);
+  EXPECT_TRUE(waitForPlan(daemon, testData.size() - 1));
+  EXPECT_EQ(daemon.countMalformed(), 2u);
+  EXPECT_EQ(daemon.countUpdates(), snapshot.size() + 1);
+
+  daemon.stop();
+  server.join();
+
+  // names are never freed, so a daemon adds a bounded number of them
+  gimbaledCamera::PlanDaemon capped(path, 100, 80, 100, 0, gimbaledCamera::SlewModel(), 2);
+  std::thread cappedServer([&]() { capped.run(); });
+  fd = gimbaledCamera::connectDaemon(path);
+  const std::string fresh = testDataDrone.name + " 37.76 -122.33\n" + testData[0].name + " 37.77 -122.33\n"
+    "cappedA 37.75 -122.33\ncappedB 37.76 -122.32\ncappedC 37.76 -122.34\ncappedA 37.75 -122.34\n";
+  ASSERT_EQ(write(fd, fresh.data(), fresh.size()), ssize_t(fresh.size()));
+  close(fd);
+  EXPECT_TRUE(waitForPlan(capped, 3));
+  EXPECT_EQ(capped.countRejected(), 1u);
+  EXPECT_TRUE(gimbaledCamera::NameTable::global().contains("cappedB"));
+  EXPECT_FALSE(gimbaledCamera::NameTable::global().contains("cappedC"));
+  capped.stop();
+  cappedServer.join();
+}
+
+/* Test the counters and timers, and their JSON and Prometheus exports */
+TEST(Stats, CountersAndExport) {
+
+  namespace stats = gimbaledCamera::stats;
+  stats::reset();
+
+  // the planners count what they do only if built with STATS=1
+  gimbaledCamera::Vessel drone(testDataDrone.lat, testDataDrone.lon, testDataDrone.name);
+  std::vector<gimbaledCamera::RelativeVessel> vessels;
+  for (auto & tmp : testData)
+    vessels.emplace_back(tmp.lat, tmp.lon, tmp.name, drone);
+  const gimbaledCamera::Plan plan = makePictures(80., vessels);
+  const std::uint64_t expected = stats::enabled ? 1 : 0;
+  EXPECT_EQ(stats::get(stats::Counter::Vessels), expected*testData.size());
+  EXPECT_EQ(stats::get(stats::Counter::Pictures), expected*plan.size());
+  EXPECT_EQ(stats::get(stats::Counter::Merges), expected);
+  EXPECT_EQ(stats::get(stats::Counter::Allocations) > 0, stats::enabled);   // the picture offsets and the pictures, at least
+  EXPECT_EQ(stats::count(stats::Timer::RelativeVessel), expected*testData.size());
+  EXPECT_EQ(stats::count(stats::Timer::Sort), expected);
+
+  // the exporters work either way
+  stats::reset();
+  stats::add(stats::Counter::Pictures, 3);
+  stats::add(stats::Counter::Allocations, 2);
+  stats::record(stats::Timer::Sort, 1000);   // bucket [512, 1024) ns
+  stats::record(stats::Timer::Sort, 1500);   // bucket [1024, 2048) ns
+  const std::string json = stats::toJson(), prometheus = stats::toPrometheus();
+  EXPECT_NE(json.find("\"pictures\": 3"), std::string::npos) << json;
+  EXPECT_NE(json.find("\"allocations\": 2"), std::string::npos) << json;
+  EXPECT_NE(json.find("\"sort\": {\"count\": 2, \"sum_ns\": 2500, \"buckets\": [[1024, 1], [2048, 1]]}"), std::string::npos) << json;
+  EXPECT_NE(prometheus.find("gimbaledcamera_pictures_total 3\n"), std::string::npos) << prometheus;
+  EXPECT_NE(prometheus.find("gimbaledcamera_allocations_total 2\n"), std::string::npos) << prometheus;
+  EXPECT_NE(prometheus.find("gimbaledcamera_sort_seconds_bucket{le=\"2.048e-06\"} 2\n"), std::string::npos) << prometheus;
+  EXPECT_NE(prometheus.find("gimbaledcamera_sort_seconds_count 2\n"), std::string::npos) << prometheus;
+
+  // the last bucket has no upper bound
+  stats::record(stats::Timer::Merge, UINT64_MAX);
+  EXPECT_NE(stats::toJson().find("\"merge\": {\"count\": 1, \"sum_ns\": 18446744073709551615, \"buckets\": [[18446744073709551615, 1]]}"), 
+      std::string::npos) << stats::toJson();
+  const std::string merge = stats::toPrometheus();
+  EXPECT_EQ(merge.find("gimbaledcamera_merge_seconds_bucket{le=\"0\"}"), std::string::npos) << merge;
+  EXPECT_NE(merge.find("gimbaledcamera_merge_seconds_bucket{le=\"9.22337e+09\"} 0\ngimbaledcamera_merge_seconds_bucket{le=\"+Inf\"} 1\n"), 
+      std::string::npos) << merge;
+  stats::reset();
+}
+
 /*********************
  * THE MAIN FUNCTION *
  *********************/
@@ -0,0 +1,360 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "vesselIO.h"
+
+namespace gimbaledCamera {
+
+  /** The whole content of a file descriptor: memory mapped if it is a
+   *  regular file, read into a buffer otherwise (e.g. a pipe).
+   */
+  class MappedFile {
+
+    public:
+
+      explicit MappedFile(std::vector<char> &&bytes) : map(nullptr), length(0), buffer(std::move(bytes)) {}
+
+      explicit MappedFile(int fd) : map(nullptr), length(0) {
+        struct stat info;
+        if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+          void *ptr = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+          if (ptr != MAP_FAILED) {
+            map    = ptr;
+            length = info.st_size;
+            return;
+          }
+        }
+
+        char chunk[1 << 16];
+        ssize_t got;
+        while ((got = read(fd, chunk, sizeof(chunk))) > 0)
+          buffer.insert(buffer.end(), chunk, chunk + got);
+        if (got < 0)
+          throw std::runtime_error(std::string("cannot read input: ") + strerror(errno));
+      }
+
+      ~MappedFile() {
+        if (map)
+          munmap(map, length);
+      }
+
+      MappedFile(const MappedFile &) = delete;
+      MappedFile &operator=(const MappedFile &) = delete;
+
+      const char *data() const { return map ? static_cast<const char *>(map) : buffer.data(); }
+      std::size_t size() const { return map ? length : buffer.size(); }
+
+    private:
+
+      void *map;                ///< The mapping, or nullptr if the file was read
+      std::size_t length;       ///< Length of the mapping
+      std::vector<char> buffer; ///< The content, if it could not be mapped
+
+  };
+
+  namespace {
+
+    const char magic[4] = {'G', 'C', 'V', 'S'};
+    const std::uint32_t version = 1;
+    const std::size_t headerBytes = 32;
+
+    inline bool isSpace(char c) {
+      return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    // Parse a double at p, which must be followed by whitespace or end
+    double parseDouble(const char *&p, const char *end, std::size_t line, const char *what) {
+      if (p == end)
+        throw std::runtime_error("line " + std::to_string(line) + ": missing " + what);
+
+      const char *begin = p;
+      if (begin < end && *begin == '+')
+        ++begin;
+
+      double value = 0;
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+      const std::from_chars_result result = std::from_chars(begin, end, value);
+      const bool ok = result.ec == std::errc() && (result.ptr == end || isSpace(*result.ptr));
+      const char *next = result.ptr;
+#else
+      // no floating point from_chars in this standard library: strtod on a copy of the token
+      char token[64];
+      std::size_t length = 0;
+      while (begin+length < end && !isSpace(begin[length]) && length+1 < sizeof(token)) {
+        token[length] = begin[length];
+        ++length;
+      }
+      token[length] = '\0';
+      char *stop;
+      value = strtod(token, &stop);
+      const bool ok = length > 0 && stop == token + length && (begin+length == end || isSpace(begin[length]));
+      const char *next = begin + length;
+#endif
+      if (!ok)
+        throw std::runtime_error("line " + std::to_string(line) + ": invalid " + what);
+      p = next;
+      return value;
+    }
+
+    // Write a double with the shortest representation that reads back exactly
+    void writeDouble(std::ostream &output, double value) {
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+      char buffer[32];
+      const std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+      output.write(buffer, result.ptr - buffer);
+#else
+      char buffer[32];
+      output.write(buffer, snprintf(buffer, sizeof(buffer), "%.17g", value));
+#endif
+    }
+
+  }
+
+  // Class constructor for VesselSnapshot
+  VesselSnapshot::VesselSnapshot() : count(0), ownNameOffset(1, 0) {
+    repoint();
+  }
+
+  VesselSnapshot::VesselSnapshot(VesselSnapshot &&other) : VesselSnapshot() {
+    swap(other);
+  }
+
+  VesselSnapshot &VesselSnapshot::operator=(VesselSnapshot &&other) {
+    VesselSnapshot tmp(std::move(other));
+    swap(tmp);
+    return *this;
+  }
+
+  VesselSnapshot::~VesselSnapshot() {
+  }
+
+  // Exchange two snapshots.  The pointers follow the storage they point to.
+  void VesselSnapshot::swap(VesselSnapshot &other) {
+    std::swap(count,      other.count);
+    std::swap(lat,        other.lat);
+    std::swap(lon,        other.lon);
+    std::swap(nameOffset, other.nameOffset);
+    std::swap(names,      other.names);
+    ownLat.swap(other.ownLat);
+    ownLon.swap(other.ownLon);
+    ownNameOffset.swap(other.ownNameOffset);
+    ownNames.swap(other.ownNames);
+    file.swap(other.file);
+  }
+
+  // Point the arrays to the owned storage
+  void VesselSnapshot::repoint() {
+    lat        = ownLat.data();
+    lon        = ownLon.data();
+    nameOffset = ownNameOffset.data();
+    names      = ownNames.data();
+  }
+
+  // Append a vessel
+  void VesselSnapshot::push_back(std::string_view name, double latin, double lonin) {
+    if (file)
+      throw std::logic_error("cannot append to a mapped snapshot");
+    if (ownNames.size() + name.size() > UINT32_MAX)
+      throw std::length_error("name table larger than 4 GB");
+
+    ownLat.push_back(latin);
+    ownLon.push_back(lonin);
+    ownNames.insert(ownNames.end(), name.begin(), name.end());
+    ownNameOffset.push_back(ownNames.size());
+    ++count;
+    repoint();
+  }
+
+  // Reserve room for n vessels and nameBytes characters of names
+  void VesselSnapshot::reserve(std::size_t n, std::size_t nameBytes) {
+    if (file)
+      return;
+    ownLat.reserve(n);
+    ownLon.reserve(n);
+    ownNameOffset.reserve(n+1);
+    ownNames.reserve(nameBytes);
+    repoint();
+  }
+
+  // Parse a text snapshot: name, latitude and longitude for each vessel
+  VesselSnapshot parseSnapshot(const char *begin, const char *end) {
+    VesselSnapshot snapshot;
+    snapshot.reserve((end - begin)/32, (end - begin)/4); // test1.dat has ~32 characters per line
+
+    const char *p = begin;
+    std::size_t line = 1;
+    auto skipSpace = [&]() {
+      for (; p < end && isSpace(*p); ++p)
+        if (*p == '\n')
+          ++line;
+    };
+
+    while (true) {
+      skipSpace();
+      if (p == end)
+        break;
+
+      const char *name = p;
+      while (p < end && !isSpace(*p))
+        ++p;
+      const std::string_view nameView(name, p - name);
+
+      skipSpace();
+      const double lat = parseDouble(p, end, line, "latitude");
+      skipSpace();
+      const double lon = parseDouble(p, end, line, "longitude");
+
+      snapshot.push_back(nameView, lat, lon);
+    }
+    return snapshot;
+  }
+
+  // Check the magic number of a binary snapshot
+  bool isBinarySnapshot(const char *data, std::size_t size) {
+    return size >= sizeof(magic) && memcmp(data, magic, sizeof(magic)) == 0;
+  }
+
+  // Load a snapshot from a file descriptor, mapping it if possible
+  VesselSnapshot loadSnapshot(int fd) {
+    return VesselSnapshot::fromFile(std::unique_ptr<MappedFile>(new MappedFile(fd)));
+  }
+
+  // Load a snapshot from bytes in memory, which it keeps
+  VesselSnapshot loadSnapshot(std::vector<char> &&bytes) {
+    return VesselSnapshot::fromFile(std::unique_ptr<MappedFile>(new MappedFile(std::move(bytes))));
+  }
+
+  // Parse the content of a file, text or binary (pointing into it)
+  VesselSnapshot VesselSnapshot::fromFile(std::unique_ptr<MappedFile> file) {
+    const char *data = file->data();
+    const std::size_t size = file->size();
+
+    if (size < headerBytes || memcmp(data, magic, sizeof(magic)) != 0)
+      return parseSnapshot(data, data + size);
+
+    // binary snapshot: check the header and point into the mapping
+    std::uint32_t fileVersion;
+    std::uint64_t count, nameBytes;
+    memcpy(&fileVersion, data + 4,  sizeof(fileVersion));
+    memcpy(&count,       data + 8,  sizeof(count));
+    memcpy(&nameBytes,   data + 16, sizeof(nameBytes));
+    if (fileVersion != version)
+      throw std::runtime_error("unsupported snapshot version " + std::to_string(fileVersion));
+    if (count > (size - headerBytes)/20 || headerBytes + 20*count + 4 + nameBytes != size)
+      throw std::runtime_error("truncated or corrupted snapshot");
+
+    VesselSnapshot snapshot;
+    snapshot.count      = count;
+    snapshot.lat        = reinterpret_cast<const double *>(data + headerBytes);
+    snapshot.lon        = snapshot.lat + count;
+    snapshot.nameOffset = reinterpret_cast<const std::uint32_t *>(snapshot.lon + count);
+    snapshot.names      = reinterpret_cast<const char *>(snapshot.nameOffset + count + 1);
+    // every name must lie in the name table, or getName would read out of it
+    bool ordered = snapshot.nameOffset[0] == 0 && snapshot.nameOffset[count] == nameBytes;
+    for (std::size_t i = 0; ordered && i < count; ++i)
+      ordered = snapshot.nameOffset[i] <= snapshot.nameOffset[i+1];
+    if (!ordered)
+      throw std::runtime_error("corrupted snapshot name table");
+    snapshot.file = std::move(file);
+    return snapshot;
+  }
+
+  // Load a snapshot from a file
+  VesselSnapshot loadSnapshot(const std::string &path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw std::runtime_error("cannot open " + path + ": " + strerror(errno));
+    try {
+      VesselSnapshot snapshot = loadSnapshot(fd);
+      close(fd);
+      return snapshot;
+    } catch (...) {
+      close(fd);
+      throw;
+    }
+  }
+
+  // Write a snapshot in the binary format
+  void saveSnapshotBinary(const VesselSnapshot &snapshot, const std::string &path) {
+    const std::uint64_t count = snapshot.size();
+    std::uint64_t nameBytes = 0;
+    for (std::size_t i = 0; i < count; ++i)
+      nameBytes += snapshot.getName(i).size();
+    if (nameBytes > UINT32_MAX)
+      throw std::length_error("name table larger than 4 GB");
+
+    std::ofstream output(path, std::ios::binary);
+    if (!output)
+      throw std::runtime_error("cannot write " + path);
+
+    const std::uint64_t reserved = 0;
+    output.write(magic, sizeof(magic));
+    output.write(reinterpret_cast<const char *>(&version),   sizeof(version));
+    output.write(reinterpret_cast<const char *>(&count),     sizeof(count));
+    output.write(reinterpret_cast<const char *>(&nameBytes), sizeof(nameBytes));
+    output.write(reinterpret_cast<const char *>(&reserved),  sizeof(reserved));
+    output.write(reinterpret_cast<const char *>(snapshot.getLats()), count*sizeof(double));
+    output.write(reinterpret_cast<const char *>(snapshot.getLons()), count*sizeof(double));
+
+    std::uint32_t offset = 0;
+    output.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+    for (std::size_t i = 0; i < count; ++i) {
+      offset += snapshot.getName(i).size();
+      output.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+    }
+    for (std::size_t i = 0; i < count; ++i)
+      output.write(snapshot.getName(i).data(), snapshot.getName(i).size());
+
+    if (!output)
+      throw std::runtime_error("cannot write " + path);
+  }
+
+  // Write a snapshot as text
+  void saveSnapshotText(const VesselSnapshot &snapshot, const std::string &path) {
+    std::ofstream output(path);
+    if (!output)
+      throw std::runtime_error("cannot write " + path);
+
+    for (std::size_t i = 0; i < snapshot.size(); ++i) {
+      output << snapshot.getName(i) << ' ';
+      writeDouble(output, snapshot.getLatDeg(i));
+      output << ' ';
+      writeDouble(output, snapshot.getLonDeg(i));
+      output << '\n';
+    }
+
+    if (!output)
+      throw std::runtime_error("cannot write " + path);
+  }
+
+}
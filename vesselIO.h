@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef VESSELIO_H
+#define VESSELIO_H
+
+/** @file 
+ *  Loading and saving vessel snapshots.
+ *
+ *  A snapshot is the input of main: one vessel per line, with name, latitude
+ *  and longitude (in degrees), the first vessel being the drone.  It can be
+ *  stored as text (test1.dat) or in a compact binary format that loads
+ *  without copying.  The binary format is little-endian, and made of a 32 byte
+ *  header followed by fixed-size columns, so that the latitudes and
+ *  longitudes can be fed to computeRelativeBatch directly from the mapped
+ *  file:
+ *
+ *      char     magic[4]         "GCVS"
+ *      uint32   version          1
+ *      uint64   count            number of vessels (n)
+ *      uint64   nameBytes        size of the name table
+ *      uint64   reserved         0
+ *      double   lat[n]           latitudes, in degrees
+ *      double   lon[n]           longitudes, in degrees
+ *      uint32   nameOffset[n+1]  name i is nameTable[nameOffset[i], nameOffset[i+1])
+ *      char     nameTable[nameBytes]
+ */
+
+namespace gimbaledCamera {
+
+  class MappedFile;
+
+  /** A snapshot of vessel names and positions in structure-of-arrays layout.
+   *  Either owns its arrays (parsed text) or points into a memory-mapped
+   *  binary file.
+   */
+  class VesselSnapshot {
+
+    public:
+
+      /// Class constructor (an empty snapshot).
+      VesselSnapshot();
+
+      VesselSnapshot(VesselSnapshot &&);
+      VesselSnapshot &operator=(VesselSnapshot &&);
+      VesselSnapshot(const VesselSnapshot &) = delete;
+      VesselSnapshot &operator=(const VesselSnapshot &) = delete;
+      ~VesselSnapshot();
+
+      /// Returns the number of vessels.
+      inline std::size_t size() const { 
+        return count; 
+      };
+
+      /// Returns the latitudes, in degrees.
+      inline const double *getLats() const { 
+        return lat; 
+      };
+
+      /// Returns the longitudes, in degrees.
+      inline const double *getLons() const { 
+        return lon; 
+      };
+
+      /// Returns the latitude of vessel i, in degrees.
+      inline double getLatDeg(std::size_t i) const { 
+        return lat[i]; 
+      };
+
+      /// Returns the longitude of vessel i, in degrees.
+      inline double getLonDeg(std::size_t i) const { 
+        return lon[i]; 
+      };
+
+      /// Returns the name of vessel i.
+      inline std::string_view getName(std::size_t i) const { 
+        return std::string_view(names + nameOffset[i], nameOffset[i+1] - nameOffset[i]); 
+      };
+
+      /// Returns true if the snapshot points into a mapped binary file.
+      inline bool isMapped() const {
+        return file != nullptr;
+      };
+
+      /// Appends a vessel (not allowed on a mapped snapshot).
+      void push_back(
+          std::string_view name /** vessel name */, 
+          double latin          /** vessel latitude, in degrees */, 
+          double lonin          /** vessel longitude, in degrees */
+          );
+
+      /// Reserves room for n vessels and nameBytes characters of names.
+      void reserve(std::size_t n, std::size_t nameBytes);
+
+    private:
+
+      void repoint();                       ///< Points the arrays to the owned storage
+      void swap(VesselSnapshot &other);     ///< Exchanges two snapshots
+
+      std::size_t count;               ///< Number of vessels
+      const double *lat;               ///< Latitudes, in degrees
+      const double *lon;               ///< Longitudes, in degrees
+      const std::uint32_t *nameOffset; ///< Offsets of the names in the name table (count+1)
+      const char *names;               ///< The name table
+
+      std::vector<double> ownLat, ownLon;        ///< Storage of a parsed snapshot
+      std::vector<std::uint32_t> ownNameOffset;  ///< Storage of a parsed snapshot
+      std::vector<char> ownNames;                ///< Storage of a parsed snapshot
+      std::unique_ptr<MappedFile> file;          ///< The mapping of a binary snapshot
+
+      /// Loads the content of a file, text or binary (which it then points into).
+      static VesselSnapshot fromFile(std::unique_ptr<MappedFile> file);
+
+      friend VesselSnapshot loadSnapshot(int);
+      friend VesselSnapshot loadSnapshot(std::vector<char> &&);
+
+  };
+
+  /** Parses a text snapshot: whitespace separated name, latitude and
+   *  longitude (in degrees) for each vessel.  Throws std::runtime_error on
+   *  malformed input.
+   */
+  VesselSnapshot parseSnapshot(
+      const char *begin /** first character */, 
+      const char *end   /** one past the last character */
+      );
+
+  /** Loads a snapshot from a file descriptor (e.g. 0 for standard input).
+   *  The input is memory mapped if possible (and read otherwise); binary
+   *  snapshots are recognized by their magic number and not copied.
+   */
+  VesselSnapshot loadSnapshot(int fd);
+
+  /// Loads a snapshot, text or binary, from bytes in memory (kept by the snapshot).
+  VesselSnapshot loadSnapshot(std::vector<char> &&bytes);
+
+  /// Returns true if the bytes start with the magic number of a binary snapshot.
+  bool isBinarySnapshot(const char *data, std::size_t size);
+
+  /// Loads a snapshot from a file, text or binary.
+  VesselSnapshot loadSnapshot(const std::string &path);
+
+  /// Writes a snapshot in the binary format.
+  void saveSnapshotBinary(const VesselSnapshot &snapshot, const std::string &path);
+
+  /// Writes a snapshot as text, one vessel per line (coordinates round-trip exactly).
+  void saveSnapshotText(const VesselSnapshot &snapshot, const std::string &path);
+
+}
+
+#endif
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include "zoomPlanner.h"
+#include "stats.h"
+
+namespace gimbaledCamera {
+
+  // Choose the pictures and their zoom levels with a dynamic program over the
+  // bearings, swept from the widest gap
+  ZoomPlan makeZoomPictures(
+      const std::vector<ZoomLevel> &levels, 
+      std::vector<RelativeVessel> vessels, 
+      std::size_t currentLevel, 
+      const SlewModel &model) {
+
+    if (levels.empty())
+      throw std::invalid_argument("makeZoomPictures: at least one zoom level is needed");
+    GIMBALEDCAMERA_COUNT(Vessels, vessels.size());
+    {
+      GIMBALEDCAMERA_TIME(Sort);
+      std::stable_sort(vessels.begin(), vessels.end(), gimbaledCamera::sortByBearing); // sort the vessels by bearing
+    }
+
+    ZoomPlan result;
+    const std::size_t n = vessels.size(), L = levels.size();
+    if (n == 0) {
+      result.plan = Plan::Builder(levels[0].FOV*M_PI/180, std::move(vessels)).build();
+      return result;
+    }
+
+    GIMBALEDCAMERA_TIME(Partition);
+
+    // sweep from the widest gap between two vessels: the buffer starts there,
+    // with the bearings unwrapped
+    std::size_t cut = 0;
+    double widest = vessels[0].getBearing() + 2*M_PI - vessels[n-1].getBearing();
+    for (std::size_t i = 1; i < n; ++i)
+      if (vessels[i].getBearing() - vessels[i-1].getBearing() > widest) {
+        widest = vessels[i].getBearing() - vessels[i-1].getBearing();
+        cut = i;
+      }
+    std::rotate(vessels.begin(), vessels.begin() + cut, vessels.end());
+    double longest = 0;
+    for (auto & level : levels)
+      longest = std::max(longest, level.maxRange);
+    std::vector<double> left(n), right(n), need(n);
+    for (std::size_t p = 0; p < n; ++p) {
+      const double pan = vessels[p].getBearing() + (p + cut >= n ? 2*M_PI : 0);
+      left[p]  = pan - vessels[p].getMargin();
+      right[p] = pan + vessels[p].getMargin();
+      need[p]  = std::min(vessels[p].getDistance(), longest);       // out of every range: the longest will do
+    }
+
+    // cost[i*L+l] is the least time to take vessels [0, i) with the last
+    // picture at level l, and from[i*L+l] the first vessel of that picture;
+    // best[i] is the least over the levels.  Before the first picture the
+    // camera is at currentLevel.
+    const double inf = std::numeric_limits<double>::infinity(), picture = model.settleTime + model.captureTime;
+    std::vector<double> cost((n+1)*L, inf), best(n+1, inf);
+    std::vector<std::size_t> from((n+1)*L, 0);
+    if (currentLevel < L)
+      cost[currentLevel] = 0;
+    best[0] = 0;
+    auto enter = [&](std::size_t j, std::size_t l) {          // least time to start a picture at j, at level l
+      return std::min(cost[j*L+l], best[j] + levels[l].zoomTime);
+    };
+
+    // for each level, the pictures ending before vessel i start in a window
+    // [start[l], i) that only moves forward: three monotonic queues (flat
+    // buffers, each vessel enters once) keep its leftmost left edge,
+    // rightmost right edge and cheapest start
+    std::vector<std::size_t> start(L, 0), queues(3*n*L), head(3*L, 0), tail(3*L, 0);
+    for (std::size_t i = 1; i <= n; ++i) {
+      const std::size_t p = i-1;
+      for (std::size_t l = 0; l < L; ++l) {
+        std::size_t *minLeft = &queues[3*l*n], *maxRight = minLeft + n, *cheapest = maxRight + n;
+        std::size_t &minHead = head[3*l], &maxHead = head[3*l+1], &cheapHead = head[3*l+2];
+        std::size_t &minTail = tail[3*l], &maxTail = tail[3*l+1], &cheapTail = tail[3*l+2];
+
+        if (need[p] > levels[l].maxRange) {                     // no picture at this level holds vessel p
+          start[l] = i;
+          minHead = minTail;
+          maxHead = maxTail;
+          cheapHead = cheapTail;
+          continue;
+        }
+        while (minHead < minTail && left[minLeft[minTail-1]] >= left[p]) --minTail;
+        while (maxHead < maxTail && right[maxRight[maxTail-1]] <= right[p]) --maxTail;
+        while (cheapHead < cheapTail && enter(cheapest[cheapTail-1], l) >= enter(p, l)) --cheapTail;
+        minLeft[minTail++]    = p;
+        maxRight[maxTail++]   = p;
+        cheapest[cheapTail++] = p;
+
+        // shrink the window until it fits in the FOV (a single vessel always does)
+        const double FOV = levels[l].FOV*M_PI/180;
+        while (start[l] < p && right[maxRight[maxHead]] - left[minLeft[minHead]] >= FOV) {
+          ++start[l];
+          while (minLeft[minHead]     < start[l]) ++minHead;
+          while (maxRight[maxHead]    < start[l]) ++maxHead;
+          while (cheapest[cheapHead]  < start[l]) ++cheapHead;
+        }
+        from[i*L+l] = cheapest[cheapHead];
+        cost[i*L+l] = enter(from[i*L+l], l) + picture;
+        best[i] = std::min(best[i], cost[i*L+l]);
+      }
+    }
+
+    // walk the choices back from the cheapest last level
+    std::vector<std::pair<std::size_t, std::size_t>> pictures;  // (first vessel, level), last picture first
+    std::size_t level = std::min_element(cost.begin() + n*L, cost.end()) - (cost.begin() + n*L);
+    for (std::size_t i = n; i > 0; ) {
+      const std::size_t j = from[i*L+level];
+      pictures.push_back(std::make_pair(j, level));
+      if (j > 0 && cost[j*L+level] > best[j] + levels[level].zoomTime)  // the camera zoomed before this picture
+        level = std::min_element(cost.begin() + j*L, cost.begin() + (j+1)*L) - (cost.begin() + j*L);
+      i = j;
+    }
+    std::reverse(pictures.begin(), pictures.end());
+
+    GIMBALEDCAMERA_COUNT(Pictures, pictures.size());
+    result.totalTime = best[n];
+    Plan::Builder builder(levels[0].FOV*M_PI/180, std::move(vessels));
+    builder.reserve(pictures.size());
+    result.level.reserve(pictures.size());
+    for (std::size_t k = 0; k < pictures.size(); ++k) {
+      const std::size_t l = pictures[k].second;
+      builder.addPicture(pictures[k].first, k+1 < pictures.size() ? pictures[k+1].first : n, levels[l].FOV*M_PI/180);
+      result.level.push_back(l);
+    }
+    result.plan = builder.build();
+    return result;
+  }
+
+}
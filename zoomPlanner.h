@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2021 Gianluca Meneghello (gianluca.meneghello@gmail.com)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+#include "gimbaledCamera.h"
+#include "slewScheduler.h"
+
+#ifndef ZOOMPLANNER_H
+#define ZOOMPLANNER_H
+
+/** @file */
+
+namespace gimbaledCamera {
+
+  /// A zoom level of the camera.
+  struct ZoomLevel {
+    double FOV      = 80;     ///< Horizontal field of view, in degrees
+    double zoomTime = 0;      ///< Time to change to this level from another one, in seconds
+    double maxRange = 1e300;  ///< Farthest distance at which a vessel is seen with enough pixels, in meters (see resolvedRange)
+  };
+
+  /** Returns the farthest distance (in meters) at which a target of the
+   *  given size covers at least minPixels pixels of a sensor sensorPixels
+   *  wide, with the given field of view (small-angle approximation):
+   *
+   *      range = targetSize/(FOV/sensorPixels * minPixels)
+   */
+  inline double resolvedRange(
+      double FOV          /** the horizontal field of view, in degrees */,
+      double sensorPixels /** the width of the sensor, in pixels */,
+      double targetSize   /** the size of the target, in meters */,
+      double minPixels    /** the minimum size of the target in the picture, in pixels */
+      ) {
+    return targetSize*sensorPixels/(minPixels*FOV*M_PI/180);
+  }
+
+  /// Pictures taken at several zoom levels.
+  struct ZoomPlan {
+    Plan plan;                        ///< The pictures, in capture order; each is framed with the FOV of its level
+    std::vector<std::size_t> level;   ///< The zoom level of each picture
+    double totalTime = 0;             ///< Time spent settling, capturing and zooming, in seconds (slews not included)
+  };
+
+  /** Groups vessels into pictures, choosing the zoom level of each picture
+   *  to minimize the time to take them all while seeing every vessel with
+   *  enough pixels.
+   *
+   *  A picture taken at a level holds vessels whose bearings, margins
+   *  included, span less than the FOV of the level (or a single vessel),
+   *  all within its maxRange; a vessel beyond the range of every level
+   *  needs the level with the longest range.  Each picture costs the
+   *  settle and capture time of the model, and each change of level the
+   *  zoomTime of the new level, starting from currentLevel.
+   *
+   *  The pictures are taken in one sweep, clockwise from the widest gap
+   *  between two bearings (the slew of a sweep hardly depends on how the
+   *  vessels are grouped, so it is left out), and are runs of consecutive
+   *  bearings.  Over that order, a dynamic program finds the best grouping
+   *  and levels: for each level, the pictures ending at a vessel may start
+   *  anywhere in a window that only moves forward, so two pointers and
+   *  monotonic queues give the whole program in O(n*L) time and memory for
+   *  n vessels and L levels (after the O(n log n) sort).
+   */
+  ZoomPlan makeZoomPictures(
+      const std::vector<ZoomLevel> &levels /** the zoom levels (at least one, or std::invalid_argument is thrown) */,
+      std::vector<RelativeVessel> vessels  /** the vessels to be grouped into pictures */,
+      std::size_t currentLevel=0           /** the level the camera is at */,
+      const SlewModel &model=SlewModel()   /** the settle and capture time of a picture */
+      );
+
+}
+
+#endif